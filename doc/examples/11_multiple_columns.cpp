@@ -33,4 +33,8 @@ int main()
 
   cout << cosmology.at("3", "3").at(2) << " == 1.0...E-04" << endl;
   cout << cosmology.at("3", "3").at(3) << " == 4.0...E-00" << endl;
+
+  Block aligned(cosmology);
+  aligned.align_columns();
+  cout << aligned;
 }
@@ -0,0 +1,17 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// This file is compiled into libslhaea, which provides the definitions
+// of the functions that slhaea.h declares with SLHAEA_INLINE and
+// (with C++11) explicit instantiations of the most commonly used
+// conversions. The header itself and its includes are unchanged.
+// Translation units that link against libslhaea must define
+// SLHAEA_USE_LIBRARY before including slhaea.h, so that these
+// functions are not compiled in each of them again.
+
+#define SLHAEA_COMPILING_LIBRARY
+#include "slhaea.h"
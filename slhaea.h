@@ -10,13 +10,19 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -26,7 +32,38 @@
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/core/no_exceptions_support.hpp>
+#include <boost/function.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/permutation_iterator.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#if __cplusplus >= 201103L
+#define SLHAEA_HAS_CXX11
+#include <atomic>
+#include <mutex>
+#endif
+
+// The optional components in slhaea_archive.h, slhaea_concurrent.h,
+// and slhaea_shared.h use POSIX functions if they are available.
+#if defined(__unix__) || defined(__APPLE__)
+#define SLHAEA_HAS_POSIX
+#endif
+
+// Functions that are declared with SLHAEA_INLINE are defined at the end
+// of this header. If SLHAEA_USE_LIBRARY is defined, their definitions
+// are taken from libslhaea instead. All translation units of a program
+// must agree on whether SLHAEA_USE_LIBRARY is defined.
+#if defined(SLHAEA_USE_LIBRARY) || defined(SLHAEA_COMPILING_LIBRARY)
+#define SLHAEA_INLINE
+#else
+#define SLHAEA_INLINE inline
+#endif
 
 namespace SLHAea {
 
@@ -40,10 +77,25 @@ namespace SLHAea {
  * This function is a wrapper for
  * \c boost::lexical_cast<Target>().
  */
-template<class Target, class Source> inline Target
+template<class Target, class Source> Target
 to(const Source& arg)
 { return boost::lexical_cast<Target>(arg); }
 
+/**
+ * \brief Tries to convert an object of type \c Source to an object of
+ *   type \c Target.
+ * \param arg Object that will be converted.
+ * \param result Object that holds the result of the conversion.
+ * \return \c true if the conversion succeeded, \c false otherwise.
+ *
+ * This function is equivalent to \c to() except that it does not
+ * throw if \p arg cannot be converted. If the conversion fails, the
+ * value of \p result is unspecified.
+ */
+template<class Target, class Source> inline bool
+try_to(const Source& arg, Target& result)
+{ return boost::conversion::try_lexical_convert(arg, result); }
+
 /**
  * \brief Converts an object of type \c Source to a string.
  * \param arg Object that will be converted.
@@ -52,7 +104,7 @@ to(const Source& arg)
  * This function is a wrapper for
  * \c boost::lexical_cast<std::string>().
  */
-template<class Source> inline std::string
+template<class Source> std::string
 to_string(const Source& arg)
 { return boost::lexical_cast<std::string>(arg); }
 
@@ -67,7 +119,7 @@ to_string(const Source& arg)
  * floating-point numbers are written in scientific notation with the
  * given precision.
  */
-template<class Source> inline std::string
+template<class Source> std::string
 to_string(const Source& arg, int precision)
 {
   std::ostringstream output;
@@ -75,9 +127,41 @@ to_string(const Source& arg, int precision)
   return output.str();
 }
 
+/**
+ * \brief Marks a string as pattern for the lookup of Lines and Blocks.
+ * \param str String that will be interpreted as pattern.
+ * \return \p str prefixed with \c "(pattern)".
+ *
+ * Keys and block names are compared literally unless they are marked
+ * with this function. In a pattern \c "*" matches any sequence of
+ * characters, \c "?" makes the preceding character optional and
+ * <tt>{a,b,c}</tt> (or <tt>{a|b|c}</tt>) matches any of the
+ * alternatives, e.g. <tt>pattern("NMIX*")</tt> or
+ * <tt>pattern("{U,V}MIX")</tt>.
+ */
+inline std::string
+pattern(const std::string& str)
+{ return "(pattern)" + str; }
+
 
 namespace detail {
 
+// All exceptions are thrown via boost::throw_exception(), so that
+// SLHAea can be used if exceptions are disabled (in which case
+// BOOST_NO_EXCEPTIONS is defined and the user has to provide
+// boost::throw_exception(), which must not return).
+BOOST_NORETURN inline void
+throw_out_of_range(const std::string& what)
+{ boost::throw_exception(std::out_of_range(what)); }
+
+BOOST_NORETURN inline void
+throw_invalid_argument(const std::string& what)
+{ boost::throw_exception(std::invalid_argument(what)); }
+
+BOOST_NORETURN inline void
+throw_runtime_error(const std::string& what)
+{ boost::throw_exception(std::runtime_error(what)); }
+
 inline bool
 is_all_whitespace(const std::string& str)
 { return str.find_first_not_of(" \t\n\v\f\r") == std::string::npos; }
@@ -107,630 +191,1015 @@ trim_right(std::string& str)
   else str.clear();
 }
 
-} // namespace detail
+inline bool
+is_whitespace(char c)
+{ return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r'; }
 
+inline bool
+is_all_whitespace(const char* first, const char* last)
+{
+  for (; first != last; ++first) { if (!is_whitespace(*first)) return false; }
+  return true;
+}
 
-// forward declarations
-class Line;
-class Block;
-class Coll;
-struct Key;
+// Counts the fields that Line::str() finds in the line [first, last)
+// and checks if they form a block definition.
+inline std::size_t
+count_fields(const char* first, const char* last, bool& block_def)
+{
+  const char* const comment = std::find(first, last, '#');
+  const char* token = 0;
+  std::size_t data_fields = 0;
+  bool in_token = false;
 
-inline std::ostream& operator<<(std::ostream& os, const Line& line);
-inline std::ostream& operator<<(std::ostream& os, const Block& block);
-inline std::ostream& operator<<(std::ostream& os, const Coll& coll);
-inline std::ostream& operator<<(std::ostream& os, const Key& key);
+  for (const char* it = first; it != comment; ++it)
+  {
+    if (is_whitespace(*it)) in_token = false;
+    else if (!in_token)
+    {
+      in_token = true;
+      if (++data_fields == 1) token = it;
+    }
+  }
 
+  block_def = false;
+  if (data_fields > 1 &&
+      std::find_if(token, comment, is_whitespace) - token == 5)
+  {
+    char specifier[5];
+    std::transform(token, token + 5, specifier,
+      static_cast<int (*)(int)>(std::toupper));
+    block_def = std::equal(specifier, specifier + 5, "BLOCK") ||
+      std::equal(specifier, specifier + 5, "DECAY");
+  }
+  return data_fields + (comment != last ? 1 : 0);
+}
 
-/**
- * Container of strings that represents a line in a SLHA structure.
- * This class is a container of strings that represents a line in a
- * SLHA structure. The elements of a %Line are the so called fields of
- * an ordinary SLHA line, which are its whitespace-separated
- * substrings and the comment. For example, if a %Line is constructed
- * from the string <tt>" 1 2 0.123 # a comment"</tt> its elements
- * would be \c "1", \c "2", \c "0.123", and \c "# a comment".
- * Array-style access to the elements with integer indices is provided
- * by the operator[]() and at() functions. %Line also provides
- * introspective functions to find out whether it is a comment or data
- * line for example. Introspective functions that check if an element
- * is a block specifier (\c "BLOCK" or \c "DECAY") always perform
- * case-insensitive comparisons.
- *
- * In addition to storing the fields of a SLHA line, a %Line also
- * stores its formatting (the exact position of the fields in the
- * line). A formatted representation of a %Line can be produced with
- * str() const. The reformat() function clears the previous formatting
- * and indents all elements with an appropriate number of spaces.
- */
-class Line
+inline unsigned long
+next_generation()
+{
+#ifdef SLHAEA_HAS_CXX11
+  static std::atomic<unsigned long> generation(0);
+#else
+  static unsigned long generation = 0;
+#endif
+  return ++generation;
+}
+
+// Mutex whose copies are new, unlocked mutexes, so that classes
+// holding one keep their compiler-generated copy operations. Without
+// C++11 there are no standard threads and locking does nothing.
+class copyable_mutex
+{
+public:
+  copyable_mutex() {}
+  copyable_mutex(const copyable_mutex&) {}
+
+  copyable_mutex&
+  operator=(const copyable_mutex&)
+  { return *this; }
+
+#ifdef SLHAEA_HAS_CXX11
+  void lock() { mutex_.lock(); }
+  void unlock() { mutex_.unlock(); }
+
+private:
+  std::mutex mutex_;
+#else
+  void lock() {}
+  void unlock() {}
+#endif
+};
+
+class scoped_lock
 {
+public:
+  explicit
+  scoped_lock(copyable_mutex& mutex) : mutex_(mutex)
+  { mutex_.lock(); }
+
+  ~scoped_lock()
+  { mutex_.unlock(); }
+
 private:
-  typedef std::vector<std::string> impl_type;
+  scoped_lock(const scoped_lock&);
+  scoped_lock& operator=(const scoped_lock&);
+
+  copyable_mutex& mutex_;
+};
 
+// Sets a flag for the lifetime of the object.
+class scoped_flag
+{
 public:
-  typedef std::string                       value_type;
-  typedef std::string&                      reference;
-  typedef const std::string&                const_reference;
-  typedef impl_type::iterator               iterator;
-  typedef impl_type::const_iterator         const_iterator;
-  typedef impl_type::reverse_iterator       reverse_iterator;
-  typedef impl_type::const_reverse_iterator const_reverse_iterator;
-  typedef impl_type::pointer                pointer;
-  typedef impl_type::const_pointer          const_pointer;
-  typedef impl_type::difference_type        difference_type;
-  typedef impl_type::size_type              size_type;
+  explicit
+  scoped_flag(bool& flag) : flag_(flag)
+  { flag_ = true; }
 
-  // NOTE: The compiler-generated copy constructor and assignment
-  //   operator for this class are just fine, so we don't need to
-  //   write our own.
+  ~scoped_flag()
+  { flag_ = false; }
 
-  /** Constructs an empty %Line. */
-  Line() : impl_(), columns_() {}
+private:
+  scoped_flag(const scoped_flag&);
+  scoped_flag& operator=(const scoped_flag&);
 
-  /**
-   * \brief Constructs a %Line from a string.
-   * \param line String whose fields are used as content of the %Line.
-   * \sa str()
-   */
-  Line(const std::string& line) : impl_(), columns_()
-  { str(line); }
+  bool& flag_;
+};
 
-  /**
-   * \brief Assigns content from a string to the %Line.
-   * \param line String whose fields are used as content of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function is an alias for str().
-   */
-  Line&
-  operator=(const std::string& line)
+// Maps slots to the indices of elements in a sequence. Every slot has
+// a generation that changes when the element it refers to is erased,
+// so that handles to erased elements can be detected. Generations are
+// drawn from next_generation() and are therefore never reused. As
+// long as no slot was acquired, all bookkeeping is skipped.
+class slot_map
+{
+public:
+  static const std::size_t npos = static_cast<std::size_t>(-1);
+
+  slot_map()
+    : slot_index_(), slot_generation_(), index_slot_(), free_slots_() {}
+
+  std::size_t
+  acquire(std::size_t index, std::size_t size, unsigned long& generation)
   {
-    str(line);
-    return *this;
+    if (slot_index_.empty()) index_slot_.assign(size, std::size_t(npos));
+
+    std::size_t slot = index_slot_[index];
+    if (slot == npos)
+    {
+      if (free_slots_.empty())
+      {
+        slot = slot_index_.size();
+        slot_index_.push_back(index);
+        slot_generation_.push_back(next_generation());
+      }
+      else
+      {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slot_index_[slot] = index;
+        slot_generation_[slot] = next_generation();
+      }
+      index_slot_[index] = slot;
+    }
+    generation = slot_generation_[slot];
+    return slot;
   }
 
-  /**
-   * \brief Appends a string to the end of the %Line.
-   * \param arg String that is appended to the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function is an alias for append().
-   */
-  Line&
-  operator+=(const std::string& arg)
+  std::size_t
+  resolve(std::size_t slot, unsigned long generation) const
   {
-    append(arg);
-    return *this;
+    return (slot < slot_index_.size() &&
+            slot_generation_[slot] == generation) ? slot_index_[slot] : npos;
   }
 
-  /**
-   * \brief Inserts an element at the end of the %Line.
-   * \param field Element that is inserted at the end of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function inserts an element at the end of the %Line. If the
-   * the %Line contains a comment, \p field is only appended to the
-   * last element and thus size() remains unchanged.
-   */
-  template<class T> Line&
-  operator<<(const T& field)
+  void
+  did_insert(std::size_t index, std::size_t count)
   {
-    std::string field_str = to_string(field);
-    detail::trim_right(field_str);
-    if (field_str.empty()) return *this;
+    if (slot_index_.empty() || count == 0) return;
 
-    if (contains_comment())
-    { back() += field_str; }
-    else
+    index_slot_.insert(index_slot_.begin() + index, count, std::size_t(npos));
+    update_tail(index + count);
+  }
+
+  void
+  will_erase(std::size_t index, std::size_t count)
+  {
+    if (slot_index_.empty() || count == 0) return;
+
+    for (std::size_t i = index; i < index + count; ++i)
     {
-      detail::trim_left(field_str);
-      impl_.push_back(field_str);
-      reformat();
+      const std::size_t slot = index_slot_[i];
+      if (slot == npos) continue;
+
+      slot_index_[slot] = npos;
+      slot_generation_[slot] = 0;
+      free_slots_.push_back(slot);
     }
-    return *this;
+    index_slot_.erase(index_slot_.begin() + index,
+                      index_slot_.begin() + index + count);
+    update_tail(index);
   }
 
-  /**
-   * \brief Appends a string to the end of the %Line.
-   * \param arg String that is appended to the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function appends \p arg to the output of str() const and
-   * uses this temporary string as input for str(). Based on the
-   * temporary string, size() is increased or remains unchanged.
-   */
-  Line&
-  append(const std::string& arg)
+  void
+  reset()
   {
-    str(str() + arg);
-    return *this;
+    slot_index_.clear();
+    slot_generation_.clear();
+    index_slot_.clear();
+    free_slots_.clear();
   }
 
-  /**
-   * \brief Assigns content to the %Line based on a string.
-   * \param line String whose fields are used as content of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function parses \p line and sets the found fields as content
-   * of the %Line. If \p line contains newlines, everything after the
-   * first newline is ignored.
-   *
-   * The exact formatting of \p line is stored internally and can be
-   * reproduced with str() const.
-   */
-  Line&
-  str(const std::string& line)
+private:
+  void
+  update_tail(std::size_t index)
   {
-    clear();
-    static const std::string whitespace = " \t\v\f\r";
-    const std::size_t last_non_ws =
-      line.substr(0, line.find('\n')).find_last_not_of(whitespace);
-    if (last_non_ws == std::string::npos) return *this;
+    for (; index < index_slot_.size(); ++index)
+    { if (index_slot_[index] != npos) slot_index_[index_slot_[index]] = index; }
+  }
+
+private:
+  std::vector<std::size_t> slot_index_;
+  std::vector<unsigned long> slot_generation_;
+  std::vector<std::size_t> index_slot_;
+  std::vector<std::size_t> free_slots_;
+};
+
+inline bool
+parse_integer(const std::string& str, long& result)
+{
+  if (str.empty() || is_whitespace(str[0])) return false;
+
+  char* last = 0;
+  errno = 0;
+  result = std::strtol(str.c_str(), &last, 10);
+  return *last == '\0' && errno == 0;
+}
+
+// Parses a number with std::strtod(), which also accepts Fortran's 'D'
+// exponent after it has been replaced by 'E'.
+inline bool
+parse_number(const std::string& str, double& result)
+{
+  const char* first = str.c_str();
+  char* last = 0;
+  result = std::strtod(first, &last);
+  if (last != first && *last == '\0') return true;
+  if (str.find_first_of("Dd") == std::string::npos) return false;
+
+  std::string exponent = str;
+  std::replace(exponent.begin(), exponent.end(), 'D', 'E');
+  std::replace(exponent.begin(), exponent.end(), 'd', 'e');
+  first = exponent.c_str();
+  result = std::strtod(first, &last);
+  return last != first && *last == '\0';
+}
+
+// Matcher for one part of a key. It is compiled once from a pattern
+// and then compared case-insensitively against many fields. "(any)"
+// matches every field. Strings that start with marker() are patterns,
+// in which "*" matches any sequence of characters, "?" makes the
+// preceding character optional and "{a,b,c}" (or "{a|b|c}") matches
+// any of the alternatives. All other strings are compared literally
+// and patterns that expand only to literals are looked up in a sorted
+// set.
+class key_pattern
+{
+public:
+  explicit
+  key_pattern(const std::string& pattern = "")
+    : kind_(literal), literal_(pattern), prefix_(), words_(), globs_()
+  { compile(pattern); }
+
+  // Returns the prefix that marks a string as pattern.
+  static const std::string&
+  marker()
+  {
+    static const std::string marker_ = pattern("");
+    return marker_;
+  }
+
+  // Returns true if pattern can match fields that differ from it.
+  static bool
+  is_pattern(const std::string& pattern)
+  { return pattern == "(any)" || boost::starts_with(pattern, marker()); }
 
-    const std::string trimmed_line = line.substr(0, last_non_ws + 1);
-    const std::size_t comment_pos = trimmed_line.find('#');
-    const std::string data = trimmed_line.substr(0, comment_pos);
+  // Returns the upper-case prefix that all matching fields start with.
+  const std::string&
+  prefix() const
+  { return prefix_; }
+
+  template<class String> bool
+  operator()(const String& field) const
+  {
+    if (kind_ == any) return true;
+    if (kind_ == literal) return boost::iequals(literal_, field);
 
-    std::size_t pos1 = data.find_first_not_of(whitespace, 0);
-    std::size_t pos2 = data.find_first_of(whitespace, pos1);
+    std::string upper(field.begin(), field.end());
+    std::transform(upper.begin(), upper.end(), upper.begin(), to_upper);
+    if (std::binary_search(words_.begin(), words_.end(), upper)) return true;
 
-    while (pos1 != std::string::npos)
+    for (std::vector<glob>::const_iterator g = globs_.begin();
+         g != globs_.end(); ++g)
     {
-      impl_.push_back(data.substr(pos1, pos2 - pos1));
-      columns_.push_back(pos1);
+      if (g->matches(upper)) return true;
+    }
+    return false;
+  }
+
+private:
+  typedef unsigned long word_type;
+  static const std::size_t word_bits = sizeof(word_type) * CHAR_BIT;
 
-      pos1 = data.find_first_not_of(whitespace, pos2);
-      pos2 = data.find_first_of(whitespace, pos1);
+  enum kind_type { any, literal, set };
+
+  // Bit-parallel automaton of a pattern without braces. State i is
+  // reached after the first i characters of the pattern were matched.
+  struct glob
+  {
+    glob() : stars(0), skips(0), accept(0), chars() {}
+
+    bool
+    matches(const std::string& upper) const
+    {
+      word_type states = closure(1);
+      for (std::string::const_iterator c = upper.begin();
+           c != upper.end() && states; ++c)
+      {
+        word_type advance = 0;
+        for (std::vector<std::pair<char, word_type> >::const_iterator
+               ch = chars.begin(); ch != chars.end(); ++ch)
+        { if (ch->first == *c) advance |= ch->second; }
+        states = closure(((states & advance) << 1) | (states & stars));
+      }
+      return states & (word_type(1) << accept);
     }
 
-    if (comment_pos != std::string::npos)
+    word_type
+    closure(word_type states) const
     {
-      impl_.push_back(trimmed_line.substr(comment_pos));
-      columns_.push_back(comment_pos);
+      word_type previous;
+      do
+      {
+        previous = states;
+        states |= (states & skips) << 1;
+      } while (states != previous);
+      return states;
     }
-    return *this;
-  }
 
-  /** Returns a formatted string representation of the %Line. */
-  std::string
-  str() const
+    word_type stars;  // states that consume any character
+    word_type skips;  // states that can be left without a character
+    std::size_t accept;
+    std::vector<std::pair<char, word_type> > chars;
+  };
+
+  static char
+  to_upper(char c)
+  { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); }
+
+  void
+  compile(const std::string& str)
   {
-    if (empty()) return "";
+    if (str == "(any)")
+    {
+      kind_ = any;
+      return;
+    }
+    if (!is_pattern(str))
+    {
+      prefix_ = to_upper_copy(str);
+      return;
+    }
 
-    std::ostringstream output;
-    int length = 0, spaces = 0;
+    const std::string pattern = str.substr(marker().size());
+    if (pattern == "*")
+    {
+      kind_ = any;
+      return;
+    }
 
-    const_iterator field = begin();
-    std::vector<std::size_t>::const_iterator column = columns_.begin();
-    for (; field != end() && column != columns_.end(); ++field, ++column)
+    std::vector<std::string> alternatives;
+    expand(pattern, alternatives);
+
+    for (std::vector<std::string>::const_iterator alt =
+           alternatives.begin(); alt != alternatives.end(); ++alt)
     {
-      spaces = std::max(0, static_cast<int>(*column) - length + 1);
-      length += spaces + field->length();
+      std::string prefix;
+      const glob g = compile_glob(*alt, prefix);
+      if (g.stars || g.skips) globs_.push_back(g);
+      else words_.push_back(prefix);
+
+      if (alt == alternatives.begin()) prefix_ = prefix;
+      std::size_t common = 0;
+      while (common < prefix_.size() && common < prefix.size() &&
+             prefix_[common] == prefix[common]) ++common;
+      prefix_.erase(common);
+    }
 
-      output << std::setw(spaces) << " " << *field;
+    if (globs_.empty() && words_.size() == 1)
+    {
+      literal_ = words_.front();
+      words_.clear();
+      return;
     }
-    return output.str().substr(1);
+
+    kind_ = set;
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
   }
 
-  // element access
-  /**
-   * \brief Subscript access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read/write reference to the accessed string.
-   *
-   * This operator allows for easy, array-style, data access. Note
-   * that data access with this operator is unchecked and out_of_range
-   * lookups are not defined. (For checked lookups see at().)
-   */
-  reference
-  operator[](size_type n)
-  { return impl_[n]; }
+  // Expands the braces in pattern into the list of alternatives.
+  static void
+  expand(const std::string& pattern, std::vector<std::string>& result)
+  {
+    result.assign(1, std::string());
+    std::size_t pos = 0;
+    while (pos < pattern.size())
+    {
+      const std::size_t open = pattern.find('{', pos);
+      const std::size_t close = open == std::string::npos ?
+        std::string::npos : pattern.find('}', open);
+      const std::string head = pattern.substr(pos, close ==
+        std::string::npos ? std::string::npos : open - pos);
+
+      std::vector<std::string> choices(1);
+      if (close != std::string::npos)
+      {
+        const std::string inner = pattern.substr(open + 1, close - open - 1);
+        boost::split(choices, inner, boost::is_any_of(",|"));
+      }
 
-  /**
-   * \brief Subscript access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read-only (constant) reference to the accessed string.
-   *
-   * This operator allows for easy, array-style, data access. Note
-   * that data access with this operator is unchecked and out_of_range
-   * lookups are not defined. (For checked lookups see at().)
-   */
-  const_reference
-  operator[](size_type n) const
-  { return impl_[n]; }
+      std::vector<std::string> expanded;
+      expanded.reserve(result.size() * choices.size());
+      for (std::vector<std::string>::const_iterator r = result.begin();
+           r != result.end(); ++r)
+      {
+        for (std::vector<std::string>::const_iterator c = choices.begin();
+             c != choices.end(); ++c)
+        { expanded.push_back(*r + head + *c); }
+      }
+      result.swap(expanded);
 
-  /**
-   * \brief Provides access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read/write reference to the accessed string.
-   * \throw std::out_of_range If \p n is an invalid index.
-   */
-  reference
-  at(size_type n)
-  { return impl_.at(n); }
+      if (close == std::string::npos) break;
+      pos = close + 1;
+    }
+  }
 
-  /**
-   * \brief Provides access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read-only (constant) reference to the accessed string.
-   * \throw std::out_of_range If \p n is an invalid index.
-   */
-  const_reference
-  at(size_type n) const
-  { return impl_.at(n); }
+  // Compiles a pattern without braces. prefix is set to the upper-case
+  // characters that precede the first '*' or optional character.
+  static glob
+  compile_glob(const std::string& pattern, std::string& prefix)
+  {
+    glob g;
+    bool in_prefix = true;
 
-  /**
-   * Returns a read/write reference to the first element of the %Line.
-   */
-  reference
-  front()
-  { return impl_.front(); }
+    for (std::size_t i = 0; i < pattern.size(); ++i, ++g.accept)
+    {
+      if (g.accept + 1 >= word_bits)
+      { throw_invalid_argument("SLHAea::key_pattern: too long: " + pattern); }
 
-  /**
-   * Returns a read-only (constant) reference to the first element of
-   * the %Line.
-   */
-  const_reference
-  front() const
-  { return impl_.front(); }
+      const word_type state = word_type(1) << g.accept;
+      if (pattern[i] == '*')
+      {
+        g.stars |= state;
+        g.skips |= state;
+        in_prefix = false;
+        continue;
+      }
 
-  /**
-   * Returns a read/write reference to the last element of the %Line.
-   */
-  reference
-  back()
-  { return impl_.back(); }
+      const char c = to_upper(pattern[i]);
+      if (i + 1 < pattern.size() && pattern[i+1] == '?')
+      {
+        g.skips |= state;
+        in_prefix = false;
+        ++i;
+      }
+      else if (in_prefix) prefix += c;
 
-  /**
-   * Returns a read-only (constant) reference to the last element of
-   * the %Line.
-   */
-  const_reference
-  back() const
-  { return impl_.back(); }
+      std::vector<std::pair<char, word_type> >::iterator ch = g.chars.begin();
+      while (ch != g.chars.end() && ch->first != c) ++ch;
+      if (ch != g.chars.end()) ch->second |= state;
+      else g.chars.push_back(std::make_pair(c, state));
+    }
+    return g;
+  }
 
-  // iterators
-  /**
-   * Returns a read/write iterator that points to the first element in
-   * the %Line. Iteration is done in ordinary element order.
-   */
-  iterator
-  begin()
-  { return impl_.begin(); }
+private:
+  kind_type kind_;
+  std::string literal_;
+  std::string prefix_;
+  std::vector<std::string> words_;
+  std::vector<glob> globs_;
+};
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  begin() const
-  { return impl_.begin(); }
+// Lookup structures over the keys of the elements of a sequence: a
+// Bloom filter over case-insensitive keys, which tells if a key is
+// definitely absent, a sorted index of the upper-case keys, which
+// answers exact and prefix queries, and for every column that was
+// queried by range() a sorted index of its integer fields. Copies
+// start out disabled.
+//
+// The structures are built by the first lookup after enable() and are
+// then kept up to date: did_insert() adds new elements, and touch()
+// and touch_all() mark elements that were made accessible for
+// modification, whose keys and fields are compared with the indexed
+// ones by the next lookup. Only erasing or replacing elements requires
+// invalidate(), which makes the next lookup rebuild the structures.
+// Lookups are made under a lock, so that concurrent const lookups are
+// safe.
+//
+// The Traits of a sequence provide key(element), which returns a
+// pointer to the key of an element or a null pointer if it has none,
+// and field(element, column), which does the same for a field.
+class key_index
+{
+public:
+  // Sequences with fewer elements are always scanned: for them a
+  // linear scan that compares the keys directly is about as fast as
+  // hashing the key and probing the filter, and the structures would
+  // cost more memory than the elements themselves.
+  static const std::size_t min_size = 16;
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cbegin() const
-  { return impl_.begin(); }
+  enum lookup_type { scan, absent, found };
 
-  /**
-   * Returns a read/write iterator that points one past the last
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  iterator
-  end()
-  { return impl_.end(); }
+  key_index() : enabled_(false), data_(0), mutex_() {}
+  key_index(const key_index&) : enabled_(false), data_(0), mutex_() {}
+  ~key_index() { delete data_; }
 
-  /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  end() const
-  { return impl_.end(); }
+  key_index&
+  operator=(const key_index&)
+  {
+    invalidate();
+    return *this;
+  }
 
-  /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cend() const
-  { return impl_.end(); }
+  void
+  enable()
+  { enabled_ = true; }
 
-  /**
-   * Returns a read/write reverse iterator that points to the last
-   * element in the %Line. Iteration is done in reverse element order.
-   */
-  reverse_iterator
-  rbegin()
-  { return impl_.rbegin(); }
+  void
+  disable()
+  {
+    enabled_ = false;
+    invalidate();
+  }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  const_reverse_iterator
-  rbegin() const
-  { return impl_.rbegin(); }
+  bool
+  enabled() const
+  { return enabled_; }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  const_reverse_iterator
-  crbegin() const
-  { return impl_.rbegin(); }
+  // Drops the structures after elements were erased or replaced.
+  void
+  invalidate()
+  {
+    delete data_;
+    data_ = 0;
+  }
 
-  /**
-   * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  reverse_iterator
-  rend()
-  { return impl_.rend(); }
+  // Marks the element at position pos as possibly changed.
+  void
+  touch(std::size_t pos)
+  {
+    if (!data_ || data_->all_dirty) return;
+    if (data_->dirty.size() < data_->key_at.size() / 8 + 8)
+    { data_->dirty.push_back(pos); }
+    else data_->all_dirty = true;
+  }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Line. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  rend() const
-  { return impl_.rend(); }
+  // Marks all elements as possibly changed.
+  void
+  touch_all()
+  { if (data_) data_->all_dirty = true; }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Line. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  crend() const
-  { return impl_.rend(); }
+  // Shifts the indexed positions after count elements were inserted
+  // at position pos. The new elements are indexed by the next lookup.
+  void
+  did_insert(std::size_t pos, std::size_t count)
+  { if (data_ && count != 0) data_->insert(pos, count); }
+
+  // Looks up the elements in [first, last) whose key can match key,
+  // which may be a pattern (see key_pattern). Returns scan if the
+  // elements have to be scanned, absent if no element matches, and
+  // found otherwise. In the latter case positions holds the
+  // candidates in no particular order.
+  template<class Traits, class RandomAccessIterator> lookup_type
+  lookup(RandomAccessIterator first, RandomAccessIterator last,
+         const std::string& key, std::vector<std::size_t>& positions) const
+  {
+    if (!enabled_ || static_cast<std::size_t>(last - first) < min_size)
+    { return scan; }
+
+    const bool pattern = key_pattern::is_pattern(key);
+    const std::string prefix =
+      pattern ? key_pattern(key).prefix() : to_upper_copy(key);
+    if (prefix.empty()) return scan;
+
+    scoped_lock lock(mutex_);
+    sync<Traits>(first, last);
+    if (!pattern && !data_->test(hash(prefix))) return absent;
+
+    std::vector<key_entry_type>::const_iterator entry =
+      std::lower_bound(data_->keys.begin(), data_->keys.end(),
+                       key_entry_type(prefix, 0));
+    for (; entry != data_->keys.end() &&
+           entry->first.compare(0, pattern ? prefix.size() :
+                                std::string::npos, prefix) == 0; ++entry)
+    { positions.push_back(entry->second); }
+    return positions.empty() ? absent : found;
+  }
 
-  // introspection
-  /**
-   * Returns true if the %Line begins with \c "BLOCK" or \c "DECAY"
-   * followed by a block name.
-   */
-  bool
-  is_block_def() const
+  // Returns the positions of the elements in [first, last) whose
+  // field in column is an integer in [lo, hi], ordered by value and
+  // position. Unless the index is enabled, the elements are scanned
+  // and only the matches are sorted.
+  template<class Traits, class RandomAccessIterator>
+  std::vector<std::size_t>
+  range(RandomAccessIterator first, RandomAccessIterator last,
+        std::size_t column, long lo, long hi) const
   {
-    if (size() < 2) return false;
+    const std::size_t size = last - first;
+    std::vector<std::size_t> positions;
+    if (lo > hi) return positions;
 
-    const_iterator field = begin();
-    return is_block_specifier(*field) && !is_comment(*++field);
+    if (!enabled_ || size < min_size)
+    {
+      std::vector<entry_type> entries;
+      long value = 0;
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        if (field_value<Traits>(first[i], column, value) &&
+            lo <= value && value <= hi)
+        { entries.push_back(entry_type(value, i)); }
+      }
+      std::sort(entries.begin(), entries.end());
+      for (std::size_t i = 0; i < entries.size(); ++i)
+      { positions.push_back(entries[i].second); }
+      return positions;
+    }
+
+    scoped_lock lock(mutex_);
+    sync<Traits>(first, last);
+    columns_type::iterator col = data_->columns.find(column);
+    if (col == data_->columns.end())
+    {
+      col = data_->columns.insert(
+        std::make_pair(column, column_type())).first;
+      col->second.build<Traits>(first, size, column);
+    }
+
+    const std::vector<entry_type>& entries = col->second.entries;
+    std::vector<entry_type>::const_iterator entry =
+      std::lower_bound(entries.begin(), entries.end(), entry_type(lo, 0));
+    for (; entry != entries.end() && entry->first <= hi; ++entry)
+    { positions.push_back(entry->second); }
+    return positions;
   }
 
-  /** Returns true if the %Line begins with \c "#". */
-  bool
-  is_comment_line() const
-  { return !empty() && is_comment(front()); }
+private:
+  typedef unsigned long word_type;
+  typedef std::pair<long, std::size_t> entry_type;
+  typedef std::pair<std::string, std::size_t> key_entry_type;
 
-  /**
-   * Returns true if the %Line is not empty and if it does not begin
-   * with \c "#", \c "BLOCK" or \c "DECAY".
-   */
-  bool
-  is_data_line() const
-  { return !empty() && !is_comment(front()) && !is_block_specifier(front()); }
+  static const std::size_t word_bits = sizeof(word_type) * CHAR_BIT;
+  static const std::size_t bits_per_key = 8;
+  static const std::size_t hash_count = 3;
 
-  // capacity
-  /** Returns the number of elements in the %Line. */
-  size_type
-  size() const
-  { return impl_.size(); }
+  // Changed keys or fields up to this number are patched into a sorted
+  // index, more changes rebuild it.
+  static const std::size_t max_patches = 16;
 
-  /**
-   * Returns the number of elements without the comment in the %Line.
-   */
-  size_type
-  data_size() const
-  { return std::distance(begin(), std::find_if(begin(), end(), is_comment)); }
+  // Sorted index of the integer fields in one column.
+  struct column_type
+  {
+    column_type() : entries(), values(), has_value() {}
 
-  /** Returns the size() of the largest possible %Line. */
-  size_type
-  max_size() const
-  { return impl_.max_size(); }
+    template<class Traits, class RandomAccessIterator> void
+    build(RandomAccessIterator first, std::size_t size, std::size_t column)
+    {
+      values.assign(size, 0);
+      has_value.assign(size, false);
+      for (std::size_t i = 0; i < size; ++i)
+      { has_value[i] = field_value<Traits>(first[i], column, values[i]); }
+      rebuild();
+    }
 
-  /** Returns true if the %Line is empty. */
-  bool
-  empty() const
-  { return impl_.empty(); }
+    void
+    rebuild()
+    {
+      entries.clear();
+      for (std::size_t i = 0; i < values.size(); ++i)
+      { if (has_value[i]) entries.push_back(entry_type(values[i], i)); }
+      std::sort(entries.begin(), entries.end());
+    }
 
-  // modifiers
-  /**
-   * \brief Swaps data with another %Line.
-   * \param line %Line to be swapped with.
-   */
-  void
-  swap(Line& line)
-  {
-    impl_.swap(line.impl_);
-    columns_.swap(line.columns_);
-  }
+    void
+    insert(std::size_t pos, std::size_t count)
+    {
+      for (std::vector<entry_type>::iterator entry = entries.begin();
+           entry != entries.end(); ++entry)
+      { if (entry->second >= pos) entry->second += count; }
+      values.insert(values.begin() + pos, count, 0);
+      has_value.insert(has_value.begin() + pos, count, false);
+    }
 
-  /** Erases all the elements in the %Line. */
-  void
-  clear()
-  {
-    impl_.clear();
-    columns_.clear();
-  }
+    template<class Traits, class RandomAccessIterator> void
+    update(RandomAccessIterator first, std::size_t column,
+           const std::vector<std::size_t>& positions)
+    {
+      std::size_t changes = 0;
+      long value = 0;
+      for (std::vector<std::size_t>::const_iterator i = positions.begin();
+           i != positions.end(); ++i)
+      {
+        const bool has = field_value<Traits>(first[*i], column, value);
+        if (has == has_value[*i] && (!has || value == values[*i])) continue;
 
-  /** Reformats the string representation of the %Line. */
-  void
-  reformat()
+        if (++changes <= max_patches && has_value[*i])
+        {
+          entries.erase(std::lower_bound(entries.begin(), entries.end(),
+                                         entry_type(values[*i], *i)));
+        }
+        has_value[*i] = has;
+        values[*i] = has ? value : 0;
+        if (changes <= max_patches && has)
+        {
+          const entry_type entry(value, *i);
+          entries.insert(std::lower_bound(entries.begin(), entries.end(),
+                                          entry), entry);
+        }
+      }
+      if (changes > max_patches) rebuild();
+    }
+
+    std::vector<entry_type> entries;
+    std::vector<long> values;      // field of every element
+    std::vector<bool> has_value;   // true if the field is an integer
+  };
+
+  typedef std::map<std::size_t, column_type> columns_type;
+
+  struct data_type
   {
-    if (empty()) return;
+    data_type()
+      : bits(), filter_keys(0), keys(), key_at(), dirty(),
+        all_dirty(false), columns() {}
 
-    columns_.clear();
-    const_iterator field = begin();
-    std::size_t pos1 = 0, pos2 = 0;
+    template<class Traits, class RandomAccessIterator> void
+    build(RandomAccessIterator first, std::size_t size)
+    {
+      key_at.resize(size);
+      for (std::size_t i = 0; i < size; ++i)
+      { upper_key<Traits>(first[i], key_at[i]); }
+      rebuild_keys();
+      rebuild_filter();
+    }
 
-    if (is_block_specifier(*field))
+    void
+    insert(std::size_t pos, std::size_t count)
     {
-      pos1 = 0;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      for (std::vector<key_entry_type>::iterator entry = keys.begin();
+           entry != keys.end(); ++entry)
+      { if (entry->second >= pos) entry->second += count; }
+      for (std::vector<std::size_t>::iterator i = dirty.begin();
+           i != dirty.end(); ++i)
+      { if (*i >= pos) *i += count; }
+
+      key_at.insert(key_at.begin() + pos, count, std::string());
+      for (columns_type::iterator col = columns.begin();
+           col != columns.end(); ++col)
+      { col->second.insert(pos, count); }
+
+      if (!all_dirty)
+      { for (std::size_t i = 0; i < count; ++i) dirty.push_back(pos + i); }
+    }
 
-      if (++field == end()) return;
+    // Compares the keys and fields of all elements that were marked as
+    // changed with the indexed ones and updates the structures.
+    template<class Traits, class RandomAccessIterator> void
+    update(RandomAccessIterator first)
+    {
+      std::vector<std::size_t> positions;
+      if (all_dirty)
+      {
+        positions.resize(key_at.size());
+        for (std::size_t i = 0; i < positions.size(); ++i) positions[i] = i;
+      }
+      else
+      {
+        positions.swap(dirty);
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()),
+                        positions.end());
+      }
+      dirty.clear();
+      all_dirty = false;
+      if (positions.empty()) return;
+
+      update_keys<Traits>(first, positions);
+      for (columns_type::iterator col = columns.begin();
+           col != columns.end(); ++col)
+      { col->second.update<Traits>(first, col->first, positions); }
+    }
 
-      pos1 = pos2 + 1;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+    template<class Traits, class RandomAccessIterator> void
+    update_keys(RandomAccessIterator first,
+                const std::vector<std::size_t>& positions)
+    {
+      std::vector<std::pair<std::size_t, std::string> > changed;
+      std::string key;
+      for (std::vector<std::size_t>::const_iterator i = positions.begin();
+           i != positions.end(); ++i)
+      {
+        upper_key<Traits>(first[*i], key);
+        if (key == key_at[*i]) continue;
+        changed.push_back(std::make_pair(*i, std::string()));
+        changed.back().second.swap(key);
+      }
+
+      if (changed.size() > max_patches)
+      {
+        for (std::size_t i = 0; i < changed.size(); ++i)
+        { key_at[changed[i].first].swap(changed[i].second); }
+        rebuild_keys();
+        rebuild_filter();
+        return;
+      }
+
+      for (std::size_t i = 0; i < changed.size(); ++i)
+      {
+        const std::size_t pos = changed[i].first;
+        std::string& current = key_at[pos];
+        if (!current.empty())
+        {
+          keys.erase(std::lower_bound(keys.begin(), keys.end(),
+                                      key_entry_type(current, pos)));
+        }
+        current.swap(changed[i].second);
+        if (current.empty()) continue;
+
+        const key_entry_type entry(current, pos);
+        keys.insert(std::lower_bound(keys.begin(), keys.end(), entry),
+                    entry);
+        add_to_filter(current);
+      }
     }
-    else if (is_comment(*field))
+
+    void
+    rebuild_keys()
     {
-      pos1 = 0;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      keys.clear();
+      for (std::size_t i = 0; i < key_at.size(); ++i)
+      { if (!key_at[i].empty()) keys.push_back(key_entry_type(key_at[i], i)); }
+      std::sort(keys.begin(), keys.end());
     }
-    else
+
+    // Sizes the filter for twice the current number of keys, so that
+    // keys can be added without rebuilding it every time.
+    void
+    rebuild_filter()
     {
-      pos1 = shift_width_;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      filter_keys = keys.size();
+      std::size_t words = 1;
+      while (words * word_bits < 2 * filter_keys * bits_per_key) words *= 2;
+      bits.assign(words, 0);
+
+      for (std::vector<key_entry_type>::const_iterator entry = keys.begin();
+           entry != keys.end(); ++entry)
+      { set(hash(entry->first)); }
     }
 
-    while (++field != end())
+    void
+    add_to_filter(const std::string& key)
     {
-      pos1 = pos2 + calc_spaces_for_indent(pos2);
-      if (starts_with_sign(*field)) --pos1;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      if ((++filter_keys) * bits_per_key > bits.size() * word_bits)
+      { rebuild_filter(); }
+      else set(hash(key));
     }
-  }
 
-  /**
-   * Comments the %Line. This function prefixes the %Line with a
-   * \c "#" and packetizes all its elements into one.
-   */
-  void
-  comment()
-  { if (!empty()) str("#" + str()); }
+    void
+    set(std::size_t h)
+    {
+      const std::size_t step = (h >> 16) | 1;
+      const std::size_t mask = bits.size() * word_bits - 1;
+      for (std::size_t i = 0; i < hash_count; ++i, h += step)
+      { bits[(h & mask) / word_bits] |= word_type(1) << (h % word_bits); }
+    }
 
-  /**
-   * Uncomments the %Line. This function removes the first character
-   * of the %Line if it is a \c "#" and splits the former comment into
-   * the corresponding number of fields.
-   */
-  void
-  uncomment()
-  {
-    if (!empty() && is_comment(front()))
+    bool
+    test(std::size_t h) const
     {
-      front().erase(0, 1);
-      str(str());
+      const std::size_t step = (h >> 16) | 1;
+      const std::size_t mask = bits.size() * word_bits - 1;
+      for (std::size_t i = 0; i < hash_count; ++i, h += step)
+      {
+        if (!(bits[(h & mask) / word_bits] & (word_type(1) << (h % word_bits))))
+        { return false; }
+      }
+      return true;
     }
-  }
 
-private:
-  bool
-  contains_comment() const
-  { return std::find_if(rbegin(), rend(), is_comment) != rend(); }
+    std::vector<word_type> bits;
+    std::size_t filter_keys;
+    std::vector<key_entry_type> keys;
+    std::vector<std::string> key_at; // upper-case key of every element
+    std::vector<std::size_t> dirty;
+    bool all_dirty;
+    columns_type columns;
+  };
 
-  static std::size_t
-  calc_spaces_for_indent(const std::size_t& pos)
+  // Brings the structures up to date with the elements in [first,
+  // last). Must be called with the lock held.
+  template<class Traits, class RandomAccessIterator> void
+  sync(RandomAccessIterator first, RandomAccessIterator last) const
   {
-    std::size_t width = shift_width_ - (pos % shift_width_);
-    if (width < min_width_) width += shift_width_;
-    return width;
+    const std::size_t size = last - first;
+    if (data_ && data_->key_at.size() != size)
+    {
+      delete data_;
+      data_ = 0;
+    }
+    if (data_) data_->update<Traits>(first);
+    else
+    {
+      data_ = new data_type;
+      data_->build<Traits>(first, size);
+    }
   }
 
-  static bool
-  is_block_specifier(const value_type& field)
+  template<class Traits, class Element> static void
+  upper_key(const Element& element, std::string& key)
   {
-    static const std::size_t specifier_length = 5;
-    if (field.length() != specifier_length) return false;
-
-    const value_type field_upper = detail::to_upper_copy(field);
-    return (field_upper == "BLOCK") || (field_upper == "DECAY");
+    const std::string* const k = Traits::key(element);
+    if (!k)
+    {
+      key.clear();
+      return;
+    }
+    key.assign(*k);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   static_cast<int (*)(int)>(std::toupper));
   }
 
-  static bool
-  is_comment(const value_type& field)
-  { return !field.empty() && field[0] == '#'; }
-
-  template<class T> Line&
-  insert_fundamental_type(const T& arg)
+  template<class Traits, class Element> static bool
+  field_value(const Element& element, std::size_t column, long& value)
   {
-    static const int digits = std::numeric_limits<T>::digits10;
-    return *this << to_string(arg, digits);
+    const std::string* const field = Traits::field(element, column);
+    return field && parse_integer(*field, value);
   }
 
-  static bool
-  starts_with_sign(const value_type& field)
-  { return !field.empty() && (field[0] == '-' || field[0] == '+'); }
+  // FNV-1a hash of the upper-case characters of str.
+  static std::size_t
+  hash(const std::string& str)
+  {
+    std::size_t h = 2166136261u;
+    for (std::string::const_iterator c = str.begin(); c != str.end(); ++c)
+    {
+      h ^= static_cast<unsigned char>(std::toupper(*c));
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
 
 private:
-  impl_type impl_;
-  std::vector<std::size_t> columns_;
-
-  static const std::size_t shift_width_ = 4;
-  static const std::size_t min_width_   = 2;
+  bool enabled_;
+  mutable data_type* data_;
+  mutable copyable_mutex mutex_;
 };
 
-template<> inline Line&
-Line::operator<< <float>(const float& number)
-{
-  insert_fundamental_type(number);
-  return *this;
-}
+} // namespace detail
 
-template<> inline Line&
-Line::operator<< <double>(const double& number)
-{
-  insert_fundamental_type(number);
-  return *this;
-}
 
-template<> inline Line&
-Line::operator<< <long double>(const long double& number)
-{
-  insert_fundamental_type(number);
-  return *this;
-}
+// forward declarations
+class Line;
+class Block;
+class Coll;
+struct Change;
+struct Key;
+class InternedKey;
+class BlockView;
+class CollView;
+class Projection;
+class SharedColl;
+class Writer;
+class NumericBlock;
+struct BlockDifference;
+
+inline std::ostream& operator<<(std::ostream& os, const Line& line);
+inline std::ostream& operator<<(std::ostream& os, const Block& block);
+inline std::ostream& operator<<(std::ostream& os, const Coll& coll);
+inline std::ostream& operator<<(std::ostream& os, const Key& key);
 
 
 /**
- * Container of Lines that resembles a block in a SLHA structure.
- * This class is a named container of Lines that resembles a block in
- * a SLHA structure. Unlike a block in a SLHA structure, a %Block can
- * contain any number of block definitions or it can be completely
- * empty.
+ * Container of strings that represents a line in a SLHA structure.
+ * This class is a container of strings that represents a line in a
+ * SLHA structure. The elements of a %Line are the so called fields of
+ * an ordinary SLHA line, which are its whitespace-separated
+ * substrings and the comment. For example, if a %Line is constructed
+ * from the string <tt>" 1 2 0.123 # a comment"</tt> its elements
+ * would be \c "1", \c "2", \c "0.123", and \c "# a comment".
+ * Array-style access to the elements with integer indices is provided
+ * by the operator[]() and at() functions. %Line also provides
+ * introspective functions to find out whether it is a comment or data
+ * line for example. Introspective functions that check if an element
+ * is a block specifier (\c "BLOCK" or \c "DECAY") always perform
+ * case-insensitive comparisons.
  *
- * Access to the elements of the %Block is provided by the
- * operator[]() and at() functions. These take one or more strings
- * resp. ints as argument(s) and compare them against the first
- * strings of the contained Lines (the ints are converted to strings
- * before comparison). The first Line that matches the provided
- * arguments is then returned, or if no matching Line is found, an
- * empty Line is appended to the %Block (operator[]()) or
- * \c std::out_of_range is thrown (at()). The special argument
- * \c "(any)" will be considered equal to all strings in the Lines.
- * For example, <tt>at("(any)", "2")</tt> returns the first Line whose
- * second element is \c "2".
+ * In addition to storing the fields of a SLHA line, a %Line also
+ * stores its formatting (the exact position of the fields in the
+ * line). A formatted representation of a %Line can be produced with
+ * str() const. The reformat() function clears the previous formatting
+ * and indents all elements with an appropriate number of spaces.
  */
-class Block
+class Line
 {
 private:
-  typedef std::vector<Line> impl_type;
+  typedef std::vector<std::string> impl_type;
 
 public:
-  typedef std::vector<std::string>          key_type;
-  typedef Line                              value_type;
-  typedef Line&                             reference;
-  typedef const Line&                       const_reference;
+  typedef std::string                       value_type;
+  typedef std::string&                      reference;
+  typedef const std::string&                const_reference;
   typedef impl_type::iterator               iterator;
   typedef impl_type::const_iterator         const_iterator;
   typedef impl_type::reverse_iterator       reverse_iterator;
@@ -740,368 +1209,299 @@ public:
   typedef impl_type::difference_type        difference_type;
   typedef impl_type::size_type              size_type;
 
-  // NOTE: The compiler-generated copy constructor and assignment
-  //   operator for this class are just fine, so we don't need to
-  //   write our own.
+  /** Constructs an empty %Line. */
+  Line() : impl_(), columns_(), owner_(0) {}
 
   /**
-   * \brief Constructs an empty %Block.
-   * \param name Name of the %Block.
+   * \brief Constructs a %Line from a string.
+   * \param line String whose fields are used as content of the %Line.
+   * \sa str()
    */
-  explicit
-  Block(const std::string& name = "") : name_(name), impl_() {}
+  Line(const std::string& line) : impl_(), columns_(), owner_(0)
+  { str(line); }
 
   /**
-   * \brief Constructs a %Block with content from an input stream.
-   * \param is Input stream to read content from.
-   * \sa read()
+   * \brief Constructs a %Line with the fields of another %Line.
+   * \param line %Line whose fields are copied.
    */
-  explicit
-  Block(std::istream& is) : name_(), impl_()
-  { read(is); }
+  Line(const Line& line)
+    : impl_(line.impl_), columns_(line.columns_), owner_(0) {}
 
   /**
-   * \brief Constructs a %Block with content from a string.
-   * \param block String to read content from.
+   * \brief Replaces the fields of the %Line with those of another
+   *   %Line.
+   * \param line %Line whose fields are copied.
+   * \return Reference to \c *this.
    */
-  static Block
-  from_str(const std::string& block)
+  Line&
+  operator=(const Line& line)
   {
-    std::istringstream input(block);
-    return Block(input);
+    will_change();
+    impl_ = line.impl_;
+    columns_ = line.columns_;
+    return *this;
   }
 
+#ifdef SLHAEA_HAS_CXX11
   /**
-   * \brief Sets the name of the %Block.
-   * \param newName New name of the %Block.
-   *
-   * Notice that this function only changes a property of the %Block.
-   * No contained Line (in particular no block definition) is changed.
+   * \brief Constructs a %Line with the fields of another %Line.
+   * \param line %Line whose fields are moved.
    */
-  void
-  name(const std::string& newName)
-  { name_ = newName; }
+  Line(Line&& line) noexcept
+    : impl_(std::move(line.impl_)), columns_(std::move(line.columns_)),
+      owner_(0) {}
 
-  /** Returns the name of the %Block. */
-  const std::string&
-  name() const
-  { return name_; }
+  /**
+   * \brief Replaces the fields of the %Line with those of another
+   *   %Line.
+   * \param line %Line whose fields are moved.
+   * \return Reference to \c *this.
+   */
+  Line&
+  operator=(Line&& line)
+  {
+    will_change();
+    impl_.swap(line.impl_);
+    columns_.swap(line.columns_);
+    return *this;
+  }
+#endif
 
   /**
-   * \brief Changes the name and definition of the %Block.
-   * \param newName New name of the %Block.
+   * \brief Assigns content from a string to the %Line.
+   * \param line String whose fields are used as content of the %Line.
+   * \return Reference to \c *this.
    *
-   * In contrast to name() this function changes the name of the
-   * %Block and its first block definition (if it exists).
+   * This function is an alias for str().
    */
-  void
-  rename(const std::string& newName)
+  Line&
+  operator=(const std::string& line)
   {
-    name(newName);
-    iterator block_def = find_block_def();
-    if (block_def != end()) (*block_def)[1] = newName;
+    str(line);
+    return *this;
   }
 
   /**
-   * \brief Assigns content from an input stream to the %Block.
-   * \param is Input stream to read content from.
+   * \brief Appends a string to the end of the %Line.
+   * \param arg String that is appended to the %Line.
    * \return Reference to \c *this.
    *
-   * This function reads non-empty lines from \p is, transforms them
-   * into Lines and adds them to the end of the %Block. Lines from
-   * \p is are read until the second block definition is encountered
-   * or until the end of the stream, whatever comes first. If \p is
-   * contains a block definition and the current name of the %Block is
-   * empty, it is changed accordingly.
+   * This function is an alias for append().
    */
-  Block&
-  read(std::istream& is)
+  Line&
+  operator+=(const std::string& arg)
   {
-    std::string line_str;
-    value_type line;
+    append(arg);
+    return *this;
+  }
 
-    std::size_t def_count = 0;
-    bool nameless = name().empty();
+  /**
+   * \brief Inserts an element at the end of the %Line.
+   * \param field Element that is inserted at the end of the %Line.
+   * \return Reference to \c *this.
+   *
+   * This function inserts an element at the end of the %Line. If the
+   * the %Line contains a comment, \p field is only appended to the
+   * last element and thus size() remains unchanged.
+   */
+  template<class T> Line&
+  operator<<(const T& field)
+  {
+    std::string field_str = to_string(field);
+    detail::trim_right(field_str);
+    if (field_str.empty()) return *this;
 
-    while (std::getline(is, line_str))
+    if (contains_comment())
+    { back() += field_str; }
+    else
     {
-      if (detail::is_all_whitespace(line_str)) continue;
-
-      line.str(line_str);
-      if (line.is_block_def())
-      {
-        if (++def_count > 1)
-        {
-          is.seekg(-line_str.length()-1, std::ios_base::cur);
-          break;
-        }
-        if (nameless)
-        {
-          name(line[1]);
-          nameless = false;
-        }
-      }
-      push_back(line);
+      detail::trim_left(field_str);
+      impl_.push_back(field_str);
+      reformat();
     }
     return *this;
   }
 
   /**
-   * \brief Assigns content from a string to the %Block.
-   * \param block String that is used as content for the %Block.
+   * \brief Appends a string to the end of the %Line.
+   * \param arg String that is appended to the %Line.
    * \return Reference to \c *this.
    *
-   * This function clears the name and content of the %Block and adds
-   * every non-empty line found in \p block as Line to the end of the
-   * %Block. If \p block contains a block definition, the name of the
-   * %Block is set accordingly. If \p block contains more than two
-   * block definitions, only the lines before the second block
-   * definition are added to the %Block.
+   * This function appends \p arg to the output of str() const and
+   * uses this temporary string as input for str(). Based on the
+   * temporary string, size() is increased or remains unchanged.
    */
-  Block&
-  str(const std::string& block)
+  Line&
+  append(const std::string& arg)
   {
-    std::istringstream input(block);
-    clear();
-    read(input);
+    str(str() + arg);
     return *this;
   }
 
-  /** Returns a string representation of the %Block. */
-  std::string
-  str() const
+  /**
+   * \brief Assigns content to the %Line based on a string.
+   * \param line String whose fields are used as content of the %Line.
+   * \return Reference to \c *this.
+   *
+   * This function parses \p line and sets the found fields as content
+   * of the %Line. If \p line contains newlines, everything after the
+   * first newline is ignored.
+   *
+   * The exact formatting of \p line is stored internally and can be
+   * reproduced with str() const.
+   */
+  Line&
+  str(const std::string& line)
   {
-    std::ostringstream output;
-    output << *this;
-    return output.str();
+    const char* first = line.data();
+    parse(first, first + std::min(line.find('\n'), line.length()));
+    return *this;
   }
 
-  // element access
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write reference to sought-after Line.
+   * \brief Assigns selected fields of a string to the %Line.
+   * \param line String whose fields are used as content of the %Line.
+   * \param fields Selection of fields: the field with index \c i is
+   *   stored if \c fields[i] is true.
+   * \return Reference to \c *this.
    *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, this function creates an empty
-   * Line at the end of the %Block and returns a reference to it.
+   * This function parses \p line like str(const std::string&), but
+   * stores only the selected fields. Fields that are not selected but
+   * precede a selected field are stored as empty strings, so that the
+   * selected fields keep their indices. Parsing stops after the last
+   * selected field. As with str(const std::string&), a comment counts
+   * as a single field. If \p line is a block definition, all its
+   * fields are stored.
    */
-  reference
-  operator[](const key_type& key)
+  Line&
+  str(const std::string& line, const std::vector<bool>& fields)
   {
-    iterator line = find(key);
-    if (line != end()) return *line;
+    clear();
+    static const std::string whitespace = " \t\v\f\r";
+    static const std::string delimiters = " \t\v\f\r#";
+    const std::size_t line_end = std::min(line.find('\n'), line.length());
 
-    push_back(value_type());
-    return back();
+    std::size_t pos1 = line.find_first_not_of(whitespace);
+    std::size_t selected_size = 0;
+
+    for (std::size_t i = 0; i < fields.size() && pos1 < line_end; ++i)
+    {
+      std::size_t pos2 = line_end;
+      if (line[pos1] != '#')
+      { pos2 = std::min(line.find_first_of(delimiters, pos1), line_end); }
+      else pos2 = line.find_last_not_of(whitespace, line_end - 1) + 1;
+
+      if (i == 0 && is_block_specifier(line.substr(pos1, pos2 - pos1)))
+      { return str(line); }
+
+      impl_.push_back(fields[i] ? line.substr(pos1, pos2 - pos1)
+                                : value_type());
+      columns_.push_back(pos1);
+      if (fields[i]) selected_size = impl_.size();
+
+      pos1 = line.find_first_not_of(whitespace, pos2);
+    }
+
+    impl_.resize(selected_size);
+    columns_.resize(selected_size);
+    return *this;
   }
 
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read/write reference to sought-after Line.
-   *
-   * This function takes a key (which is a vector of ints) and locates
-   * the Line whose first strings are equal to the to strings
-   * converted ints in \p key. If no such Line exists, this function
-   * creates an empty Line at the end of the %Block and returns a
-   * reference to it.
-   */
-  reference
-  operator[](const std::vector<int>& key)
-  { return (*this)[cont_to_key(key)]; }
+  /** Returns a formatted string representation of the %Line. */
+  std::string
+  str() const
+  { return format(0); }
 
+  // element access
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key String that is used to locate the Line.
-   * \return Read/write reference to sought-after Line.
+   * \brief Subscript access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read/write reference to the accessed string.
    *
-   * This function locates the Line whose first string is equal to
-   * \p key. If no such Line exists, this function creates an empty
-   * Line at the end of the %Block and returns a reference to it.
+   * This operator allows for easy, array-style, data access. Note
+   * that data access with this operator is unchecked and out_of_range
+   * lookups are not defined. (For checked lookups see at().)
    */
   reference
-  operator[](const std::string& key)
-  { return (*this)[key_type(1, key)]; }
+  operator[](size_type n)
+  {
+    will_change();
+    return impl_[n];
+  }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integer that is used to locate the Line.
-   * \return Read/write reference to sought-after Line.
+   * \brief Subscript access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read-only (constant) reference to the accessed string.
    *
-   * This function locates the Line whose first string is equal to the
-   * to string converted \p key. If no such Line exists, this function
-   * creates an empty Line at the end of the %Block and returns a
-   * reference to it.
+   * This operator allows for easy, array-style, data access. Note
+   * that data access with this operator is unchecked and out_of_range
+   * lookups are not defined. (For checked lookups see at().)
    */
-  reference
-  operator[](int key)
-  { return (*this)[key_type(1, to_string(key))]; }
+  const_reference
+  operator[](size_type n) const
+  { return impl_[n]; }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * \brief Provides access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read/write reference to the accessed string.
+   * \throw std::out_of_range If \p n is an invalid index.
    */
   reference
-  at(const key_type& key)
+  at(size_type n)
   {
-    iterator line = find(key);
-    if (line != end()) return *line;
-
-    throw std::out_of_range(
-      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
+    if (n >= size())
+    { detail::throw_out_of_range("SLHAea::Line::at(" + to_string(n) + ")"); }
+    will_change();
+    return impl_[n];
   }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * \brief Provides access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read-only (constant) reference to the accessed string.
+   * \throw std::out_of_range If \p n is an invalid index.
    */
   const_reference
-  at(const key_type& key) const
+  at(size_type n) const
   {
-    const_iterator line = find(key);
-    if (line != end()) return *line;
-
-    throw std::out_of_range(
-      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
+    if (n >= size())
+    { detail::throw_out_of_range("SLHAea::Line::at(" + to_string(n) + ")"); }
+    return impl_[n];
   }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
-   *
-   * This function takes a vector of ints and locates the Line whose
-   * first strings are equal to the to strings converted ints in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * Returns a read/write reference to the first element of the %Line.
    */
   reference
-  at(const std::vector<int>& key)
-  { return at(cont_to_key(key)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
-   *
-   * This function takes a vector of ints and locates the Line whose
-   * first strings are equal to the to strings converted ints in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
-   */
-  const_reference
-  at(const std::vector<int>& key) const
-  { return at(cont_to_key(key)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param s0, s1, s2, s3, s4 First strings of the Line to be
-   *   located.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If provided strings do not match any
-   *   Line.
-   *
-   * This function takes up to five strings and locates the Line whose
-   * first strings are equal to all provided non-empty strings. If no
-   * such Line exists, \c std::out_of_range is thrown.
-   */
-  reference
-  at(const std::string& s0,      const std::string& s1 = "",
-     const std::string& s2 = "", const std::string& s3 = "",
-     const std::string& s4 = "")
-  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param s0, s1, s2, s3, s4 First strings of the Line to be
-   *   located.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If provided strings do not match any
-   *   Line.
-   *
-   * This function takes up to five strings and locates the Line whose
-   * first strings are equal to all provided non-empty strings. If no
-   * such Line exists, \c std::out_of_range is thrown.
-   */
-  const_reference
-  at(const std::string& s0,      const std::string& s1 = "",
-     const std::string& s2 = "", const std::string& s3 = "",
-     const std::string& s4 = "") const
-  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
-   *   Line.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If provided ints do not match any
-   *   Line.
-   *
-   * This function takes up to five ints and locates the Line whose
-   * first strings are equal to all provided to string converted ints.
-   * If no such Line exists, \c std::out_of_range is thrown.
-   */
-  reference
-  at(int i0, int i1 = no_index_, int i2 = no_index_,
-             int i3 = no_index_, int i4 = no_index_)
-  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
-   *   Line.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If provided ints do not match any Line.
-   *
-   * This function takes up to five ints and locates the Line whose
-   * first strings are equal to all provided to string converted ints.
-   * If no such Line exists, \c std::out_of_range is thrown.
-   */
-  const_reference
-  at(int i0, int i1 = no_index_, int i2 = no_index_,
-             int i3 = no_index_, int i4 = no_index_) const
-  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
-
-  /**
-   * Returns a read/write reference to the first element of the
-   * %Block.
-   */
-  reference
-  front()
-  { return impl_.front(); }
+  front()
+  {
+    will_change();
+    return impl_.front();
+  }
 
   /**
    * Returns a read-only (constant) reference to the first element of
-   * the %Block.
+   * the %Line.
    */
   const_reference
   front() const
   { return impl_.front(); }
 
   /**
-   * Returns a read/write reference to the last element of the %Block.
+   * Returns a read/write reference to the last element of the %Line.
    */
   reference
   back()
-  { return impl_.back(); }
+  {
+    will_change();
+    return impl_.back();
+  }
 
   /**
    * Returns a read-only (constant) reference to the last element of
-   * the %Block.
+   * the %Line.
    */
   const_reference
   back() const
@@ -1110,15 +1510,18 @@ public:
   // iterators
   /**
    * Returns a read/write iterator that points to the first element in
-   * the %Block. Iteration is done in ordinary element order.
+   * the %Line. Iteration is done in ordinary element order.
    */
   iterator
   begin()
-  { return impl_.begin(); }
+  {
+    will_change();
+    return impl_.begin();
+  }
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
@@ -1127,7 +1530,7 @@ public:
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
@@ -1136,16 +1539,19 @@ public:
 
   /**
    * Returns a read/write iterator that points one past the last
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   iterator
   end()
-  { return impl_.end(); }
+  {
+    will_change();
+    return impl_.end();
+  }
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Block. Iteration is done in ordinary element
+   * last element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
@@ -1154,7 +1560,7 @@ public:
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Block. Iteration is done in ordinary element
+   * last element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
@@ -1163,16 +1569,18 @@ public:
 
   /**
    * Returns a read/write reverse iterator that points to the last
-   * element in the %Block. Iteration is done in reverse element
-   * order.
+   * element in the %Line. Iteration is done in reverse element order.
    */
   reverse_iterator
   rbegin()
-  { return impl_.rbegin(); }
+  {
+    will_change();
+    return impl_.rbegin();
+  }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Block. Iteration is done in reverse
+   * the last element in the %Line. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
@@ -1181,7 +1589,7 @@ public:
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Block. Iteration is done in reverse
+   * the last element in the %Line. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
@@ -1190,17 +1598,20 @@ public:
 
   /**
    * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Block. Iteration is done in reverse
+   * the first element in the %Line. Iteration is done in reverse
    * element order.
    */
   reverse_iterator
   rend()
-  { return impl_.rend(); }
+  {
+    will_change();
+    return impl_.rend();
+  }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Block. Iteration is done
-   * in reverse element order.
+   * one before the first element in the %Line. Iteration is done in
+   * reverse element order.
    */
   const_reverse_iterator
   rend() const
@@ -1208,412 +1619,368 @@ public:
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Block. Iteration is done
-   * in reverse element order.
+   * one before the first element in the %Line. Iteration is done in
+   * reverse element order.
    */
   const_reverse_iterator
   crend() const
   { return impl_.rend(); }
 
-  // lookup
-  /**
-   * \brief Tries to locate a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write iterator pointing to sought-after element, or
-   *   end() if not found.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * tries to locate the Line whose first strings are equal to the
-   * strings in \p key. If successful the function returns a
-   * read/write iterator pointing to the sought after Line. If
-   * unsuccessful it returns end().
-   */
-  iterator
-  find(const key_type& key)
-  { return std::find_if(begin(), end(), key_matches(key)); }
-
-  /**
-   * \brief Tries to locate a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read-only (constant) iterator pointing to sought-after
-   *   element, or end() const if not found.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * tries to locate the Line whose first strings are equal to the
-   * strings in \p key. If successful the function returns a read-only
-   * (constant) iterator pointing to the sought after Line. If
-   * unsuccessful it returns end() const.
-   */
-  const_iterator
-  find(const key_type& key) const
-  { return std::find_if(begin(), end(), key_matches(key)); }
-
-  /**
-   * \brief Tries to locate a Line in a range.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   * \param key First strings of the Line to be located.
-   * \return Iterator pointing to sought-after element, or \p last if
-   *   not found.
-   *
-   * This function tries to locate in the range [\p first, \p last)
-   * the Line whose first strings are equal to the strings in \p key.
-   * If successful the function returns an iterator pointing to the
-   * sought after Line. If unsuccessful it returns \p last.
-   */
-  template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last, const key_type& key)
-  { return std::find_if(first, last, key_matches(key)); }
-
+  // introspection
   /**
-   * Returns a read/write iterator that points to the first Line in
-   * the %Block which is a block definition. If the %Block does not
-   * contain a block definition, end() is returned.
+   * Returns true if the %Line begins with \c "BLOCK" or \c "DECAY"
+   * followed by a block name.
    */
-  iterator
-  find_block_def()
+  bool
+  is_block_def() const
   {
-    return std::find_if(begin(), end(),
-      std::mem_fun_ref(&value_type::is_block_def));
-  }
+    if (size() < 2) return false;
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * Line in the %Block which is a block definition. If the %Block
-   * does not contain a block definition, end() const is returned.
-   */
-  const_iterator
-  find_block_def() const
-  {
-    return std::find_if(begin(), end(),
-      std::mem_fun_ref(&value_type::is_block_def));
+    const_iterator field = begin();
+    return is_block_specifier(*field) && !is_comment(*++field);
   }
 
-  // introspection
+  /** Returns true if the %Line begins with \c "#". */
+  bool
+  is_comment_line() const
+  { return !empty() && is_comment(front()); }
+
   /**
-   * \brief Counts all Lines that match a given key.
-   * \param key First strings of the Lines that will be counted.
-   * \return Number of lines whose first strings equal \p key.
+   * Returns true if the %Line is not empty and if it does not begin
+   * with \c "#", \c "BLOCK" or \c "DECAY".
    */
-  size_type
-  count(const key_type& key) const
-  { return std::count_if(begin(), end(), key_matches(key)); }
+  bool
+  is_data_line() const
+  { return !empty() && !is_comment(front()) && !is_block_specifier(front()); }
 
   // capacity
-  /** Returns the number of elements in the %Block. */
+  /** Returns the number of elements in the %Line. */
   size_type
   size() const
   { return impl_.size(); }
 
-  /** Returns the number of data Lines in the %Block. */
+  /**
+   * Returns the number of elements without the comment in the %Line.
+   */
   size_type
   data_size() const
-  {
-    return std::count_if(begin(), end(),
-      std::mem_fun_ref(&value_type::is_data_line));
-  }
+  { return std::distance(begin(), std::find_if(begin(), end(), is_comment)); }
 
-  /** Returns the size() of the largest possible %Block. */
+  /** Returns the size() of the largest possible %Line. */
   size_type
   max_size() const
   { return impl_.max_size(); }
 
-  /** Returns true if the %Block is empty. */
+  /** Returns true if the %Line is empty. */
   bool
   empty() const
   { return impl_.empty(); }
 
   // modifiers
   /**
-   * \brief Adds a Line to the end of the %Block.
-   * \param line Line to be added.
-   *
-   * This function creates an element at the end of the %Block and
-   * assigns the given \p line to it.
+   * \brief Swaps data with another %Line.
+   * \param line %Line to be swapped with.
    */
   void
-  push_back(const value_type& line)
-  { impl_.push_back(line); }
-
-  /**
-   * \brief Adds a Line to the end of the %Block.
-   * \param line String that is used to construct the Line that will
-   *   be added.
-   *
-   * This function creates an element at the end of the %Block and
-   * assigns the Line that is constructed from \p line to it.
-   */
+  swap(Line& line)
+  {
+    will_change();
+    line.will_change();
+    impl_.swap(line.impl_);
+    columns_.swap(line.columns_);
+  }
+
+  /** Erases all the elements in the %Line. */
   void
-  push_back(const std::string& line)
-  { impl_.push_back(value_type(line)); }
+  clear()
+  {
+    will_change();
+    impl_.clear();
+    columns_.clear();
+  }
 
-  /**
-   * Removes the last element. This function shrinks the size() of the
-   * %Block by one.
-   */
+  /** Reformats the string representation of the %Line. */
   void
-  pop_back()
-  { impl_.pop_back(); }
+  reformat()
+  {
+    if (empty()) return;
 
-  /**
-   * \brief Inserts a Line before given \p position.
-   * \param position Iterator into the %Block.
-   * \param line Line to be inserted.
-   * \return Iterator pointing to the inserted element.
-   *
-   * This function inserts a copy of \p line before the specified
-   * \p position and thus enlarges the %Block by one.
-   */
-  iterator
-  insert(iterator position, const value_type& line)
-  { return impl_.insert(position, line); }
+    will_change();
+    columns_.clear();
+    const_iterator field = begin();
+    std::size_t pos1 = 0, pos2 = 0;
 
-  /**
-   * \brief Inserts a range into the %Block.
-   * \param position Iterator into the %Block.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   *
-   * This function inserts copies of the Lines in the range
-   * [\p first, \p last) into the %Block before the specified
-   * \p position and thus enlarges the %Block accordingly.
-   */
-  template<class InputIterator> void
-  insert(iterator position, InputIterator first, InputIterator last)
-  { impl_.insert(position, first, last); }
+    if (is_block_specifier(*field))
+    {
+      pos1 = 0;
+      pos2 = pos1 + field->length();
+      columns_.push_back(pos1);
 
-  /**
-   * \brief Erases element at given \p position.
-   * \param position Iterator pointing to the element to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function erases the element at the given \p position and
-   * thus shortens the %Block by one.
-   */
-  iterator
-  erase(iterator position)
-  { return impl_.erase(position); }
+      if (++field == end()) return;
 
-  /**
-   * \brief Erases a range of elements.
-   * \param first Iterator pointing to the first element to be erased.
-   * \param last Iterator pointing to one past the last element to be
-   *   erased.
-   * \return Iterator pointing to the element pointed to by \p last
-   *   prior to erasing (or end()).
-   *
-   * This function erases the elements in the range [\p first,
-   * \p last) and shortens the %Block accordingly.
-   */
-  iterator
-  erase(iterator first, iterator last)
-  { return impl_.erase(first, last); }
+      pos1 = pos2 + 1;
+      pos2 = pos1 + field->length();
+      columns_.push_back(pos1);
+    }
+    else if (is_comment(*field))
+    {
+      pos1 = 0;
+      pos2 = pos1 + field->length();
+      columns_.push_back(pos1);
+    }
+    else
+    {
+      pos1 = shift_width_;
+      pos2 = pos1 + field->length();
+      columns_.push_back(pos1);
+    }
+
+    while (++field != end())
+    {
+      pos1 = pos2 + calc_spaces_for_indent(pos2);
+      if (starts_with_sign(*field)) --pos1;
+      pos2 = pos1 + field->length();
+      columns_.push_back(pos1);
+    }
+  }
 
   /**
-   * \brief Erases first Line that matches the provided key.
-   * \param key First strings of the Line to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases the first Line whose first strings are equal to the strings
-   * in \p key. If the %Block contains such Line, the function returns
-   * an iterator pointing to the next element (or end()). If no such
-   * Line exists, end() is returned.
+   * Comments the %Line. This function prefixes the %Line with a
+   * \c "#" and packetizes all its elements into one.
    */
-  iterator
-  erase_first(const key_type& key)
-  {
-    iterator line = find(key);
-    return (line != end()) ? erase(line) : line;
-  }
+  void
+  comment()
+  { if (!empty()) str("#" + str()); }
 
   /**
-   * \brief Erases last Line that matches the provided key.
-   * \param key First strings of the Line to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases the last Line whose first strings are equal to the strings
-   * in \p key. If the %Block contains such Line, the function returns
-   * an iterator pointing to the next element (or end()). If no such
-   * Line exists, end() is returned.
+   * Uncomments the %Line. This function removes the first character
+   * of the %Line if it is a \c "#" and splits the former comment into
+   * the corresponding number of fields.
    */
-  iterator
-  erase_last(const key_type& key)
+  void
+  uncomment()
   {
-    reverse_iterator line = find(rbegin(), rend(), key);
-    return (line != rend()) ? erase((++line).base()) : end();
+    if (!empty() && is_comment(front()))
+    {
+      front().erase(0, 1);
+      str(str());
+    }
   }
 
-  /**
-   * \brief Erases all Lines that match the provided key.
-   * \param key First strings of the Lines to be erased.
-   * \return The number of Lines erased.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases all Lines whose first strings are equal to the strings
-   * in \p key.
-   */
-  size_type
-  erase(const key_type& key)
+private:
+  std::string
+  format(std::vector<std::size_t>* positions) const
   {
-    const key_matches pred(key);
-    size_type erased_count = 0;
+    if (empty()) return "";
 
-    for (iterator line = begin(); line != end();)
+    std::string output;
+    int length = 0, spaces = 0;
+
+    const_iterator field = begin();
+    std::vector<std::size_t>::const_iterator column = columns_.begin();
+    for (; field != end() && column != columns_.end(); ++field, ++column)
     {
-      if (pred(*line))
-      {
-        line = erase(line);
-        ++erased_count;
-      }
-      else ++line;
+      spaces = std::max(0, static_cast<int>(*column) - length + 1);
+      length += spaces + field->length();
+
+      output.append(std::max(spaces, 1), ' ');
+      if (positions) positions->push_back(output.length() - 1);
+      output += *field;
     }
-    return erased_count;
+    return output.substr(1);
   }
 
-  /**
-   * \brief Swaps data with another %Block.
-   * \param block %Block to be swapped with.
-   */
-  void
-  swap(Block& block)
+  bool
+  contains_comment() const
+  { return std::find_if(rbegin(), rend(), is_comment) != rend(); }
+
+  static std::size_t
+  calc_spaces_for_indent(const std::size_t& pos)
   {
-    name_.swap(block.name_);
-    impl_.swap(block.impl_);
+    std::size_t width = shift_width_ - (pos % shift_width_);
+    if (width < min_width_) width += shift_width_;
+    return width;
   }
 
-  /**
-   * Erases all the elements in the %Block and set its name to an
-   * empty string.
-   */
-  void
-  clear()
+  static bool
+  is_block_specifier(const value_type& field)
   {
-    name_.clear();
-    impl_.clear();
+    static const std::size_t specifier_length = 5;
+    if (field.length() != specifier_length) return false;
+
+    const value_type field_upper = detail::to_upper_copy(field);
+    return (field_upper == "BLOCK") || (field_upper == "DECAY");
   }
 
-  /**
-   * \brief Reformats all Lines in the %Block.
-   * \sa Line::reformat()
-   */
-  void
-  reformat()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::reformat)); }
+  static bool
+  is_comment(const value_type& field)
+  { return !field.empty() && field[0] == '#'; }
 
-  /**
-   * \brief Comments all Lines in the %Block.
-   * \sa Line::comment()
-   */
   void
-  comment()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::comment)); }
+  parse(const char* first, const char* last);
 
-  /**
-   * \brief Uncomments all Lines in the %Block.
-   * \sa Line::uncomment()
-   */
+  // Reports to the Block that owns the %Line that it is about to be
+  // changed. Blocks own their Lines only while a Coll records their
+  // changes. Defined after Coll.
   void
-  uncomment()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::uncomment)); }
+  will_change();
 
-  /** Unary predicate that checks if a provided key matches a Line. */
-  struct key_matches : public std::unary_function<value_type, bool>
+  template<class T> Line&
+  insert_fundamental_type(const T& arg)
   {
-    explicit
-    key_matches(const key_type& key) : key_(key) {}
+    static const int digits = std::numeric_limits<T>::digits10;
+    return *this << to_string(arg, digits);
+  }
 
-    bool
-    operator()(const value_type& line) const
+  static bool
+  starts_with_sign(const value_type& field)
+  { return !field.empty() && (field[0] == '-' || field[0] == '+'); }
+
+  // Replaces a field without reformatting the %Line. Like reformat(),
+  // a sign of all but the first field is placed in front of its
+  // column, and the following fields are shifted by the change of the
+  // end of the field.
+  void
+  replace_field(size_type index, const char* field, std::size_t length)
+  {
+    will_change();
+    value_type& old = impl_[index];
+    if (index >= columns_.size())
     {
-      return (key_.empty() || key_.size() > line.size()) ? false :
-        std::equal(key_.begin(), key_.end(), line.begin(), parts_equal);
+      old.assign(field, length);
+      return;
     }
 
-    void
-    set_key(const key_type& key)
-    { key_ = key; }
+    const std::ptrdiff_t old_end = columns_[index] + old.length();
+    if (index > 0)
+    {
+      columns_[index] += starts_with_sign(old);
+      old.assign(field, length);
+      columns_[index] -= std::min(columns_[index],
+                                  std::size_t(starts_with_sign(old)));
+    }
+    else old.assign(field, length);
 
-  private:
-    static bool
-    parts_equal(const std::string& key_part, const std::string& field)
-    { return (key_part == "(any)") || boost::iequals(key_part, field); }
-
-  private:
-    key_type key_;
-  };
+    const std::ptrdiff_t shift =
+      std::ptrdiff_t(columns_[index] + length) - old_end;
+    for (size_type i = index + 1; i < columns_.size(); ++i)
+    {
+      columns_[i] = std::max<std::ptrdiff_t>(
+        std::ptrdiff_t(columns_[i]) + shift, 0);
+    }
+  }
 
 private:
-  template<class Container> static key_type
-  cont_to_key(const Container& cont)
-  {
-    key_type key;
-    key.reserve(cont.size());
-    std::string (*to_string)(const typename Container::value_type&) =
-      boost::lexical_cast<std::string, typename Container::value_type>;
-    std::transform(cont.begin(), cont.end(), std::back_inserter(key),
-      to_string);
-    return key;
-  }
+  impl_type impl_;
+  std::vector<std::size_t> columns_;
+  Block* owner_;
 
-  static key_type
-  strings_to_key(const std::string& s0, const std::string& s1,
-                 const std::string& s2, const std::string& s3,
-                 const std::string& s4)
-  {
-    key_type key;
-    key.reserve(5);
-    if (s0.empty()) return key; key.push_back(s0);
-    if (s1.empty()) return key; key.push_back(s1);
-    if (s2.empty()) return key; key.push_back(s2);
-    if (s3.empty()) return key; key.push_back(s3);
-    if (s4.empty()) return key; key.push_back(s4);
-    return key;
-  }
+  static const std::size_t shift_width_ = 4;
+  static const std::size_t min_width_   = 2;
 
-  static key_type
-  ints_to_key(int i0, int i1, int i2, int i3, int i4)
-  {
-    key_type key;
-    key.reserve(5);
-    if (i0 == no_index_) return key; key.push_back(to_string(i0));
-    if (i1 == no_index_) return key; key.push_back(to_string(i1));
-    if (i2 == no_index_) return key; key.push_back(to_string(i2));
-    if (i3 == no_index_) return key; key.push_back(to_string(i3));
-    if (i4 == no_index_) return key; key.push_back(to_string(i4));
-    return key;
-  }
+  friend class Block;
+  friend class Coll;
+  friend class SharedColl;
+  friend class Writer;
+};
 
-private:
-  std::string name_;
-  impl_type impl_;
-  static const int no_index_ = -32768;
+template<> SLHAEA_INLINE Line&
+Line::operator<< <float>(const float& number);
+template<> SLHAEA_INLINE Line&
+Line::operator<< <double>(const double& number);
+template<> SLHAEA_INLINE Line&
+Line::operator<< <long double>(const long double& number);
+
+
+
+/**
+ * Stable handle to an element of a Block or Coll.
+ * A %Handle refers to a Line in a Block (Block::handle_type) or to a
+ * Block in a Coll (Coll::handle_type). In contrast to iterators,
+ * pointers, and references, a %Handle stays valid when other elements
+ * are inserted into or erased from the container. It consists of a
+ * slot index and a generation. When the element it refers to is
+ * erased, the generation of its slot changes, so that the %Handle is
+ * detected as stale instead of referring to another element. Handles
+ * are resolved in constant time by Block::resolve() and
+ * Coll::resolve().
+ */
+template<class T>
+struct Handle
+{
+  /** Constructs a %Handle that does not refer to any element. */
+  Handle() : slot(detail::slot_map::npos), generation(0) {}
+
+  /**
+   * \brief Constructs a %Handle from explicit values.
+   * \param _slot Index of the slot the %Handle refers to.
+   * \param _generation Generation of the slot.
+   */
+  Handle(std::size_t _slot, unsigned long _generation)
+    : slot(_slot), generation(_generation) {}
+
+  /** Index of the slot the %Handle refers to. */
+  std::size_t slot;
+
+  /** Generation of the slot when the %Handle was created. */
+  unsigned long generation;
 };
 
+/** Returns true if both Handles refer to the same element. */
+template<class T> inline bool
+operator==(const Handle<T>& a, const Handle<T>& b)
+{ return a.slot == b.slot && a.generation == b.generation; }
+
+/** Returns true if the Handles refer to different elements. */
+template<class T> inline bool
+operator!=(const Handle<T>& a, const Handle<T>& b)
+{ return !(a == b); }
 
 /**
- * Container of Blocks that resembles a complete SLHA structure.
- * This class is a container of Blocks that resembles a complete SLHA
- * structure. Its name is an abbreviation of "collection" since it is
- * a collection of Blocks. The elements of %Coll objects can be
- * accessed via their names (which are always compared
- * case-insensitive) with the operator[]() and at() functions and
- * access to single fields, Lines and Blocks via the Key type is
- * provided by the field(), line() and block() functions. To fill this
- * container, the functions read() or str() can be used which read
- * data from an input stream or a string, respectively.
+ * Container of Lines that resembles a block in a SLHA structure.
+ * This class is a named container of Lines that resembles a block in
+ * a SLHA structure. Unlike a block in a SLHA structure, a %Block can
+ * contain any number of block definitions or it can be completely
+ * empty.
+ *
+ * Access to the elements of the %Block is provided by the
+ * operator[]() and at() functions. These take one or more strings
+ * resp. ints as argument(s) and compare them against the first
+ * strings of the contained Lines (the ints are converted to strings
+ * before comparison). The first Line that matches the provided
+ * arguments is then returned, or if no matching Line is found, an
+ * empty Line is appended to the %Block (operator[]()) or
+ * \c std::out_of_range is thrown (at()). The special argument
+ * \c "(any)" will be considered equal to all strings in the Lines.
+ * For example, <tt>at("(any)", "2")</tt> returns the first Line whose
+ * second element is \c "2".
+ *
+ * All other arguments are compared literally unless they are marked
+ * as patterns with SLHAea::pattern(): \c "*" then matches any sequence
+ * of characters, \c "?" makes the preceding character optional and
+ * <tt>{a,b,c}</tt> (or <tt>{a|b|c}</tt>, e.g. in Key strings)
+ * matches any of the alternatives. For example,
+ * <tt>count(pattern("1000*"))</tt> counts the Lines whose first
+ * element starts with \c "1000" and
+ * <tt>at("(any)", pattern("-?{11,13,15}"))</tt> returns the first
+ * Line whose second element is a charged lepton. Each pattern is compiled once
+ * per lookup. If the %Block is frozen (see freeze()) and the first
+ * argument is a pattern with a literal prefix, only the Lines whose
+ * first element starts with this prefix are examined.
  */
-class Coll
+class Block
 {
 private:
-  typedef std::deque<Block> impl_type;
+  friend class BlockView;
+  friend class Coll;
+  friend class Line;
+  typedef std::vector<Line> impl_type;
 
 public:
-  typedef std::string                       key_type;
-  typedef Block                             value_type;
-  typedef Block&                            reference;
-  typedef const Block&                      const_reference;
+  typedef std::vector<std::string>          key_type;
+  typedef Line                              value_type;
+  typedef Line&                             reference;
+  typedef const Line&                       const_reference;
   typedef impl_type::iterator               iterator;
   typedef impl_type::const_iterator         const_iterator;
   typedef impl_type::reverse_iterator       reverse_iterator;
@@ -1622,80 +1989,170 @@ public:
   typedef impl_type::const_pointer          const_pointer;
   typedef impl_type::difference_type        difference_type;
   typedef impl_type::size_type              size_type;
+  typedef Handle<value_type>                handle_type;
 
-  // NOTE: The compiler-generated copy constructor and assignment
-  //   operator for this class are just fine, so we don't need to
-  //   write our own.
+  /**
+   * \brief Constructs an empty %Block.
+   * \param name Name of the %Block.
+   */
+  explicit
+  Block(const std::string& name = "")
+    : name_(name), impl_(), index_(), slots_(), link_() {}
 
-  /** Constructs an empty %Coll. */
-  Coll() : impl_() {}
+  /**
+   * \brief Constructs a %Block with the name and Lines of another
+   *   %Block.
+   * \param block %Block whose name and Lines are copied.
+   *
+   * The copy is not frozen and does not belong to any Coll, i.e. its
+   * changes are not recorded by the checkpoints of a Coll.
+   */
+  Block(const Block& block)
+    : name_(block.name_), impl_(block.impl_), index_(),
+      slots_(block.slots_), link_() {}
 
   /**
-   * \brief Constructs a %Coll with content from an input stream.
+   * \brief Replaces the name and Lines of the %Block with those of
+   *   another %Block.
+   * \param block %Block whose name and Lines are copied.
+   * \return Reference to \c *this.
+   */
+  Block&
+  operator=(const Block& block)
+  {
+    if (this == &block) return *this;
+
+    will_replace_all();
+    name_ = block.name_;
+    impl_ = block.impl_;
+    slots_ = block.slots_;
+    if (link_.coll) link_lines();
+    return *this;
+  }
+
+#ifdef SLHAEA_HAS_CXX11
+  /**
+   * \brief Constructs a %Block with the name and Lines of another
+   *   %Block.
+   * \param block %Block whose name and Lines are moved.
+   */
+  Block(Block&& block)
+    : name_(), impl_(), index_(), slots_(), link_()
+  {
+    block.log_replace();
+    swap_content(block);
+  }
+
+  /**
+   * \brief Replaces the name and Lines of the %Block with those of
+   *   another %Block.
+   * \param block %Block whose name and Lines are moved.
+   * \return Reference to \c *this.
+   */
+  Block&
+  operator=(Block&& block)
+  {
+    if (this == &block) return *this;
+
+    will_replace_all();
+    block.log_replace();
+    swap_content(block);
+    return *this;
+  }
+#endif
+
+  /**
+   * \brief Constructs a %Block with content from an input stream.
    * \param is Input stream to read content from.
    * \sa read()
    */
   explicit
-  Coll(std::istream& is) : impl_()
+  Block(std::istream& is)
+    : name_(), impl_(), index_(), slots_(), link_()
   { read(is); }
 
   /**
-   * \brief Constructs a %Coll with content from a string.
-   * \param coll String to read content from.
+   * \brief Constructs a %Block with content from a string.
+   * \param block String to read content from.
    */
-  static Coll
-  from_str(const std::string& coll)
+  static Block
+  from_str(const std::string& block)
   {
-    std::istringstream input(coll);
-    return Coll(input);
+    std::istringstream input(block);
+    return Block(input);
   }
 
   /**
-   * \brief Assigns content from an input stream to the %Coll.
-   * \param is Input stream to read content from.
-   * \returns Reference to \c *this.
+   * \brief Sets the name of the %Block.
+   * \param newName New name of the %Block.
    *
-   * This function reads non-empty lines from \p is, transforms them
-   * into Lines, which are collected into the corresponding Blocks
-   * that are added to the %Coll.
+   * Notice that this function only changes a property of the %Block.
+   * No contained Line (in particular no block definition) is changed.
    */
-  Coll&
-  read(std::istream& is)
+  void
+  name(const std::string& newName)
   {
-    std::string line_str;
-    Line line;
-
-    const size_type orig_size = size();
-    pointer block = push_back_named_block("");
-
-    while (std::getline(is, line_str))
-    {
-      if (detail::is_all_whitespace(line_str)) continue;
+    log_rename();
+    name_ = newName;
+  }
 
-      line.str(line_str);
-      if (line.is_block_def()) block = push_back_named_block(line[1]);
-      block->push_back(line);
-    }
+  /** Returns the name of the %Block. */
+  const std::string&
+  name() const
+  { return name_; }
 
-    erase_if_empty("", orig_size);
-    return *this;
+  /**
+   * \brief Changes the name and definition of the %Block.
+   * \param newName New name of the %Block.
+   *
+   * In contrast to name() this function changes the name of the
+   * %Block and its first block definition (if it exists).
+   */
+  void
+  rename(const std::string& newName)
+  {
+    name(newName);
+    iterator block_def = find_block_def();
+    if (block_def != impl_.end()) (*block_def)[1] = newName;
   }
 
   /**
-   * \brief Assigns content from a string to the %Coll.
-   * \param coll String that is used as content for the %Coll.
-   * \returns Reference to \c *this.
+   * \brief Assigns content from an input stream to the %Block.
+   * \param is Input stream to read content from.
+   * \return Reference to \c *this.
+   *
+   * This function reads non-empty lines from \p is, transforms them
+   * into Lines and adds them to the end of the %Block. Lines from
+   * \p is are read until the second block definition is encountered
+   * or until the end of the stream, whatever comes first. If \p is
+   * contains a block definition and the current name of the %Block is
+   * empty, it is changed accordingly.
    */
-  Coll&
-  str(const std::string& coll)
+  Block&
+  read(std::istream& is);
+
+  /**
+   * \brief Assigns content from a string to the %Block.
+   * \param block String that is used as content for the %Block.
+   * \return Reference to \c *this.
+   *
+   * This function clears the name and content of the %Block and adds
+   * every non-empty line found in \p block as Line to the end of the
+   * %Block. If \p block contains a block definition, the name of the
+   * %Block is set accordingly. If \p block contains more than two
+   * block definitions, only the lines before the second block
+   * definition are added to the %Block.
+   */
+  Block&
+  str(const std::string& block)
   {
-    std::istringstream input(coll);
+    std::istringstream input(block);
     clear();
     read(input);
     return *this;
   }
 
-  /** Returns a string representation of the %Coll. */
+  /** Returns a string representation of the %Block. */
   std::string
   str() const
   {
@@ -1706,957 +2163,5862 @@ public:
 
   // element access
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read/write reference to sought-after Block.
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read/write reference to sought-after Line.
    *
-   * This function locates the first Block whose name equals
-   * \p blockName. If no such Block is present, an empty Block with
-   * this name is added to the end of the %Coll and a reference to it
-   * is then returned.
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, this function creates an empty
+   * Line at the end of the %Block and returns a reference to it.
    */
   reference
-  operator[](const key_type& blockName)
+  operator[](const key_type& key)
   {
-    iterator block = find(blockName);
-    if (block != end()) return *block;
+    const size_type position = find_position(key);
+    if (position != size()) return touch(position);
 
-    push_back(value_type(blockName));
-    return back();
+    push_back(value_type());
+    return impl_.back();
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read/write reference to sought-after Block.
-   * \throw std::out_of_range If no Block with the name \p blockName
-   *   exists.
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   *
+   * This function takes a key (which is a vector of ints) and locates
+   * the Line whose first strings are equal to the to strings
+   * converted ints in \p key. If no such Line exists, this function
+   * creates an empty Line at the end of the %Block and returns a
+   * reference to it.
    */
   reference
-  at(const key_type& blockName)
+  operator[](const std::vector<int>& key)
+  { return (*this)[cont_to_key(key)]; }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key String that is used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   *
+   * This function locates the Line whose first string is equal to
+   * \p key. If no such Line exists, this function creates an empty
+   * Line at the end of the %Block and returns a reference to it.
+   */
+  reference
+  operator[](const std::string& key)
+  { return (*this)[key_type(1, key)]; }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key Integer that is used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   *
+   * This function locates the Line whose first string is equal to the
+   * to string converted \p key. If no such Line exists, this function
+   * creates an empty Line at the end of the %Block and returns a
+   * reference to it.
+   */
+  reference
+  operator[](int key)
+  { return (*this)[key_type(1, to_string(key))]; }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   */
+  reference
+  at(const key_type& key)
   {
-    iterator block = find(blockName);
-    if (block != end()) return *block;
+    const size_type position = find_position(key);
+    if (position != size()) return touch(position);
 
-    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+    detail::throw_out_of_range(
+      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read-only (constant) reference to sought-after Block.
-   * \throw std::out_of_range If no Block with the name \p blockName
-   *   exists.
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  at(const key_type& blockName) const
+  at(const key_type& key) const
   {
-    const_iterator block = find(blockName);
-    if (block != end()) return *block;
+    const_iterator line = find(key);
+    if (line != end()) return *line;
 
-    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+    detail::throw_out_of_range(
+      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read/write reference to sought-after Block.
-   * \throw std::out_of_range If \p key does not match any block
-   *   definition.
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
    *
-   * This functions takes a vector of strings and locates the Block
-   * whose first strings of the block definition are equal to the
-   * strings in \p key. If no such Block exists, \c std::out_of_range
-   * is thrown.
+   * This function takes a vector of ints and locates the Line whose
+   * first strings are equal to the to strings converted ints in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
    */
   reference
-  at(const value_type::key_type& key)
-  {
-    iterator block = find(key);
-    if (block != end()) return *block;
+  at(const std::vector<int>& key)
+  { return at(cont_to_key(key)); }
 
-    throw std::out_of_range(
-      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
-  }
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a vector of ints and locates the Line whose
+   * first strings are equal to the to strings converted ints in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   */
+  const_reference
+  at(const std::vector<int>& key) const
+  { return at(cont_to_key(key)); }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read-only (constant) reference to sought-after Block.
-   * \throw std::out_of_range If \p key does not match any block
-   *   definition.
+   * \brief Locates a Line in the %Block.
+   * \param s0, s1, s2, s3, s4 First strings of the Line to be
+   *   located.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If provided strings do not match any
+   *   Line.
    *
-   * This functions takes a vector of strings and locates the Block
-   * whose first strings of the block definition are equal to the
-   * strings in \p key. If no such Block exists, \c std::out_of_range
-   * is thrown.
+   * This function takes up to five strings and locates the Line whose
+   * first strings are equal to all provided non-empty strings. If no
+   * such Line exists, \c std::out_of_range is thrown.
+   */
+  reference
+  at(const std::string& s0,      const std::string& s1 = "",
+     const std::string& s2 = "", const std::string& s3 = "",
+     const std::string& s4 = "")
+  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param s0, s1, s2, s3, s4 First strings of the Line to be
+   *   located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided strings do not match any
+   *   Line.
+   *
+   * This function takes up to five strings and locates the Line whose
+   * first strings are equal to all provided non-empty strings. If no
+   * such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  at(const value_type::key_type& key) const
-  {
-    const_iterator block = find(key);
-    if (block != end()) return *block;
+  at(const std::string& s0,      const std::string& s1 = "",
+     const std::string& s2 = "", const std::string& s3 = "",
+     const std::string& s4 = "") const
+  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
 
-    throw std::out_of_range(
-      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
-  }
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
+   *   Line.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If provided ints do not match any
+   *   Line.
+   *
+   * This function takes up to five ints and locates the Line whose
+   * first strings are equal to all provided to string converted ints.
+   * If no such Line exists, \c std::out_of_range is thrown.
+   */
+  reference
+  at(int i0, int i1 = no_index_, int i2 = no_index_,
+             int i3 = no_index_, int i4 = no_index_)
+  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
 
   /**
-   * Returns a read/write reference to the first element of the %Coll.
+   * \brief Locates a Line in the %Block.
+   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
+   *   Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided ints do not match any Line.
+   *
+   * This function takes up to five ints and locates the Line whose
+   * first strings are equal to all provided to string converted ints.
+   * If no such Line exists, \c std::out_of_range is thrown.
+   */
+  const_reference
+  at(int i0, int i1 = no_index_, int i2 = no_index_,
+             int i3 = no_index_, int i4 = no_index_) const
+  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
+
+  /**
+   * Returns a read/write reference to the first element of the
+   * %Block.
    */
   reference
   front()
-  { return impl_.front(); }
+  { return touch(0); }
 
   /**
    * Returns a read-only (constant) reference to the first element of
-   * the %Coll.
+   * the %Block.
    */
   const_reference
   front() const
   { return impl_.front(); }
 
-  /**
-   * Returns a read/write reference to the last element of the %Coll.
-   */
-  reference
-  back()
-  { return impl_.back(); }
+  /**
+   * Returns a read/write reference to the last element of the %Block.
+   */
+  reference
+  back()
+  { return touch(size() - 1); }
+
+  /**
+   * Returns a read-only (constant) reference to the last element of
+   * the %Block.
+   */
+  const_reference
+  back() const
+  { return impl_.back(); }
+
+  // iterators
+  /**
+   * Returns a read/write iterator that points to the first element in
+   * the %Block. Iteration is done in ordinary element order.
+   */
+  iterator
+  begin()
+  {
+    index_.touch_all();
+    return impl_.begin();
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Block. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  begin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Block. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cbegin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read/write iterator that points one past the last
+   * element in the %Block. Iteration is done in ordinary element
+   * order.
+   */
+  iterator
+  end()
+  {
+    index_.touch_all();
+    return impl_.end();
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Block. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  end() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Block. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cend() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to the last
+   * element in the %Block. Iteration is done in reverse element
+   * order.
+   */
+  reverse_iterator
+  rbegin()
+  {
+    index_.touch_all();
+    return impl_.rbegin();
+  }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Block. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  rbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Block. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  crbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to one before
+   * the first element in the %Block. Iteration is done in reverse
+   * element order.
+   */
+  reverse_iterator
+  rend()
+  {
+    index_.touch_all();
+    return impl_.rend();
+  }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Block. Iteration is done
+   * in reverse element order.
+   */
+  const_reverse_iterator
+  rend() const
+  { return impl_.rend(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Block. Iteration is done
+   * in reverse element order.
+   */
+  const_reverse_iterator
+  crend() const
+  { return impl_.rend(); }
+
+  // lookup
+  /**
+   * \brief Tries to locate a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read/write iterator pointing to sought-after element, or
+   *   end() if not found.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * tries to locate the Line whose first strings are equal to the
+   * strings in \p key. If successful the function returns a
+   * read/write iterator pointing to the sought after Line. If
+   * unsuccessful it returns end().
+   *
+   * If the %Block is frozen() and the first string of \p key does
+   * not occur as first string of any Line, this is detected with a
+   * Bloom filter without searching the %Block.
+   */
+  iterator
+  find(const key_type& key)
+  {
+    const size_type position = find_position(key);
+    if (position != size()) touch(position);
+    return impl_.begin() + position;
+  }
+
+  /**
+   * \brief Tries to locate a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read-only (constant) iterator pointing to sought-after
+   *   element, or end() const if not found.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * tries to locate the Line whose first strings are equal to the
+   * strings in \p key. If successful the function returns a read-only
+   * (constant) iterator pointing to the sought after Line. If
+   * unsuccessful it returns end() const.
+   * \sa find(const key_type&)
+   */
+  const_iterator
+  find(const key_type& key) const
+  { return begin() + find_position(key); }
+
+  /**
+   * \brief Tries to locate a Line in a range.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   * \param key First strings of the Line to be located.
+   * \return Iterator pointing to sought-after element, or \p last if
+   *   not found.
+   *
+   * This function tries to locate in the range [\p first, \p last)
+   * the Line whose first strings are equal to the strings in \p key.
+   * If successful the function returns an iterator pointing to the
+   * sought after Line. If unsuccessful it returns \p last.
+   */
+  template<class InputIterator> static InputIterator
+  find(InputIterator first, InputIterator last, const key_type& key)
+  { return std::find_if(first, last, key_matches(key)); }
+
+  /**
+   * Returns a read/write iterator that points to the first Line in
+   * the %Block which is a block definition. If the %Block does not
+   * contain a block definition, end() is returned.
+   */
+  iterator
+  find_block_def()
+  {
+    iterator block_def = std::find_if(impl_.begin(), impl_.end(),
+      std::mem_fun_ref(&value_type::is_block_def));
+    if (block_def != impl_.end()) touch(block_def - impl_.begin());
+    return block_def;
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * Line in the %Block which is a block definition. If the %Block
+   * does not contain a block definition, end() const is returned.
+   */
+  const_iterator
+  find_block_def() const
+  {
+    return std::find_if(begin(), end(),
+      std::mem_fun_ref(&value_type::is_block_def));
+  }
+
+  // introspection
+  /**
+   * \brief Counts all Lines that match a given key.
+   * \param key First strings of the Lines that will be counted.
+   * \return Number of lines whose first strings equal \p key.
+   */
+  size_type
+  count(const key_type& key) const
+  {
+    const key_matches pred(key);
+    std::vector<size_type> candidates;
+    switch (lookup(key, candidates))
+    {
+    case detail::key_index::scan:
+      return std::count_if(begin(), end(), pred);
+    case detail::key_index::absent:
+      return 0;
+    case detail::key_index::found:
+      break;
+    }
+
+    size_type matches = 0;
+    for (std::vector<size_type>::const_iterator i = candidates.begin();
+         i != candidates.end(); ++i)
+    { matches += pred(impl_[*i]); }
+    return matches;
+  }
+
+  /**
+   * \brief Locates all Lines whose field in a given column is an
+   *   integer in a given range.
+   * \param column Index of the field that is compared.
+   * \param lo, hi Bounds of the closed interval [\p lo, \p hi].
+   * \return BlockView of the matching Lines, ordered by the value of
+   *   their field and then by their position.
+   *
+   * Fields that are not integers are ignored. If the %Block is
+   * frozen(), the first call for a \p column builds a sorted index of
+   * its fields, which is kept up to date like the other lookup
+   * structures (see freeze()), so that later queries on any of the
+   * queried columns take logarithmic time. Otherwise every call scans
+   * the %Block.
+   */
+  BlockView
+  range(size_type column, long lo, long hi) const;
+
+  /**
+   * \brief Enables lookup structures for the Lines of the %Block.
+   *
+   * While the %Block is frozen, find(), count(), at() and range()
+   * consult a Bloom filter and sorted indices of its Lines instead of
+   * scanning it. Lookups of absent keys then take constant time and
+   * other lookups logarithmic time. The structures are built by the
+   * first lookup and kept up to date afterwards: inserted Lines are
+   * added to them, and Lines that a non-const member function made
+   * accessible for modification (e.g. at(), operator[](), back(), or
+   * a mutable iterator) are compared with the indexed keys by the
+   * next lookup. Only erasing or replacing Lines makes the next lookup
+   * rebuild them. Blocks with less than 16 Lines are always scanned,
+   * since for them a scan is about as fast as a lookup and needs no
+   * additional memory.
+   *
+   * Freezing is not the default because changes through references,
+   * pointers or iterators to Lines are only detected if they are made
+   * before the next lookup in the %Block. Such references must
+   * therefore not be kept across lookups to change the first strings
+   * of Lines while the %Block is frozen.
+   */
+  void
+  freeze()
+  { index_.enable(); }
+
+  /**
+   * \brief Removes the lookup structures of the %Block.
+   * \sa freeze()
+   */
+  void
+  thaw()
+  { index_.disable(); }
+
+  /** Returns true if the %Block is frozen. \sa freeze() */
+  bool
+  frozen() const
+  { return index_.enabled(); }
+
+  // capacity
+  /** Returns the number of elements in the %Block. */
+  size_type
+  size() const
+  { return impl_.size(); }
+
+  /** Returns the number of data Lines in the %Block. */
+  size_type
+  data_size() const
+  {
+    return std::count_if(begin(), end(),
+      std::mem_fun_ref(&value_type::is_data_line));
+  }
+
+  /** Returns the size() of the largest possible %Block. */
+  size_type
+  max_size() const
+  { return impl_.max_size(); }
+
+  /** Returns true if the %Block is empty. */
+  bool
+  empty() const
+  { return impl_.empty(); }
+
+  // stable handles
+  /**
+   * \brief Returns a stable handle to a Line in the %Block.
+   * \param line Iterator pointing to a Line in the %Block.
+   * \return Handle that refers to the Line.
+   *
+   * The returned Handle stays valid while Lines are inserted into or
+   * erased from the %Block with its modifiers, and becomes stale when
+   * the Line it refers to is erased, or when the %Block is cleared or
+   * swapped. Notice that reordering Lines through iterators is not
+   * detected.
+   */
+  handle_type
+  handle(const_iterator line)
+  {
+    handle_type result;
+    result.slot = slots_.acquire(line - impl_.begin(), size(),
+                                 result.generation);
+    return result;
+  }
+
+  /**
+   * \brief Resolves a Handle to a Line in the %Block.
+   * \param handle Handle that was returned by handle().
+   * \return Pointer to the Line \p handle refers to or a null pointer
+   *   if \p handle is stale.
+   */
+  pointer
+  resolve(const handle_type& handle)
+  {
+    const size_type index = slots_.resolve(handle.slot, handle.generation);
+    return index != detail::slot_map::npos ? &touch(index) : 0;
+  }
+
+  /**
+   * \brief Resolves a Handle to a Line in the %Block.
+   * \param handle Handle that was returned by handle().
+   * \return Pointer to the (constant) Line \p handle refers to or a
+   *   null pointer if \p handle is stale.
+   */
+  const_pointer
+  resolve(const handle_type& handle) const
+  {
+    const size_type index = slots_.resolve(handle.slot, handle.generation);
+    return index != detail::slot_map::npos ? &impl_[index] : 0;
+  }
+
+  // modifiers
+  /**
+   * \brief Adds a Line to the end of the %Block.
+   * \param line Line to be added.
+   *
+   * This function creates an element at the end of the %Block and
+   * assigns the given \p line to it.
+   */
+  void
+  push_back(const value_type& line)
+  {
+    impl_.push_back(line);
+    did_insert(size() - 1, 1);
+  }
+
+  /**
+   * \brief Adds a Line to the end of the %Block.
+   * \param line String that is used to construct the Line that will
+   *   be added.
+   *
+   * This function creates an element at the end of the %Block and
+   * assigns the Line that is constructed from \p line to it.
+   */
+  void
+  push_back(const std::string& line)
+  {
+    impl_.push_back(value_type(line));
+    did_insert(size() - 1, 1);
+  }
+
+  /**
+   * Removes the last element. This function shrinks the size() of the
+   * %Block by one.
+   */
+  void
+  pop_back()
+  {
+    will_erase(size() - 1, 1);
+    impl_.pop_back();
+  }
+
+  /**
+   * \brief Inserts a Line before given \p position.
+   * \param position Iterator into the %Block.
+   * \param line Line to be inserted.
+   * \return Iterator pointing to the inserted element.
+   *
+   * This function inserts a copy of \p line before the specified
+   * \p position and thus enlarges the %Block by one.
+   */
+  iterator
+  insert(iterator position, const value_type& line)
+  {
+    const size_type index = position - impl_.begin();
+    {
+      detail::scoped_flag suspend(link_.suspended);
+      impl_.insert(position, line);
+    }
+    did_insert(index, 1);
+    return impl_.begin() + index;
+  }
+
+  /**
+   * \brief Inserts a range into the %Block.
+   * \param position Iterator into the %Block.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   *
+   * This function inserts copies of the Lines in the range
+   * [\p first, \p last) into the %Block before the specified
+   * \p position and thus enlarges the %Block accordingly.
+   */
+  template<class InputIterator> void
+  insert(iterator position, InputIterator first, InputIterator last)
+  {
+    const size_type index = position - impl_.begin(), orig_size = size();
+    {
+      detail::scoped_flag suspend(link_.suspended);
+      impl_.insert(position, first, last);
+    }
+    did_insert(index, size() - orig_size);
+  }
+
+  /**
+   * \brief Erases element at given \p position.
+   * \param position Iterator pointing to the element to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function erases the element at the given \p position and
+   * thus shortens the %Block by one.
+   */
+  iterator
+  erase(iterator position)
+  {
+    will_erase(position - impl_.begin(), 1);
+    detail::scoped_flag suspend(link_.suspended);
+    return impl_.erase(position);
+  }
+
+  /**
+   * \brief Erases a range of elements.
+   * \param first Iterator pointing to the first element to be erased.
+   * \param last Iterator pointing to one past the last element to be
+   *   erased.
+   * \return Iterator pointing to the element pointed to by \p last
+   *   prior to erasing (or end()).
+   *
+   * This function erases the elements in the range [\p first,
+   * \p last) and shortens the %Block accordingly.
+   */
+  iterator
+  erase(iterator first, iterator last)
+  {
+    will_erase(first - impl_.begin(), last - first);
+    detail::scoped_flag suspend(link_.suspended);
+    return impl_.erase(first, last);
+  }
+
+  /**
+   * \brief Erases first Line that matches the provided key.
+   * \param key First strings of the Line to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases the first Line whose first strings are equal to the strings
+   * in \p key. If the %Block contains such Line, the function returns
+   * an iterator pointing to the next element (or end()). If no such
+   * Line exists, end() is returned.
+   */
+  iterator
+  erase_first(const key_type& key)
+  {
+    iterator line = find(key);
+    return (line != end()) ? erase(line) : line;
+  }
+
+  /**
+   * \brief Erases last Line that matches the provided key.
+   * \param key First strings of the Line to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases the last Line whose first strings are equal to the strings
+   * in \p key. If the %Block contains such Line, the function returns
+   * an iterator pointing to the next element (or end()). If no such
+   * Line exists, end() is returned.
+   */
+  iterator
+  erase_last(const key_type& key)
+  {
+    reverse_iterator line = find(rbegin(), rend(), key);
+    return (line != rend()) ? erase((++line).base()) : end();
+  }
+
+  /**
+   * \brief Erases all Lines that match the provided key.
+   * \param key First strings of the Lines to be erased.
+   * \return The number of Lines erased.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases all Lines whose first strings are equal to the strings
+   * in \p key.
+   */
+  size_type
+  erase(const key_type& key)
+  {
+    const key_matches pred(key);
+    size_type erased_count = 0;
+
+    for (iterator line = begin(); line != end();)
+    {
+      if (pred(*line))
+      {
+        line = erase(line);
+        ++erased_count;
+      }
+      else ++line;
+    }
+    return erased_count;
+  }
+
+  /**
+   * \brief Swaps data with another %Block.
+   * \param block %Block to be swapped with.
+   */
+  void
+  swap(Block& block)
+  {
+    will_replace_all();
+    block.will_replace_all();
+    swap_content(block);
+  }
+
+  /**
+   * Erases all the elements in the %Block and set its name to an
+   * empty string.
+   */
+  void
+  clear()
+  {
+    will_replace_all();
+    name_.clear();
+    impl_.clear();
+  }
+
+  /**
+   * \brief Reformats all Lines in the %Block.
+   * \sa Line::reformat()
+   */
+  void
+  reformat()
+  {
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::reformat));
+  }
+
+  /**
+   * \brief Reformats all Lines in the %Block so that their fields are
+   *   aligned in columns.
+   *
+   * The width of every column is determined once from all data Lines
+   * of the %Block and then used to lay out each of them. The spacing
+   * between the columns and the handling of signs are the same as in
+   * Line::reformat(), and trailing comments are aligned in a common
+   * column. Block definitions and comment lines are reformatted with
+   * Line::reformat().
+   * \sa reformat()
+   */
+  void
+  align_columns()
+  {
+    std::vector<std::size_t> widths;
+    std::size_t commented_fields = 0;
+
+    for (iterator line = impl_.begin(); line != impl_.end(); ++line)
+    {
+      if (!is_table_row(*line)) continue;
+      const std::size_t fields = data_size(*line);
+      if (widths.size() < fields) widths.resize(fields);
+
+      for (std::size_t i = 0; i < fields; ++i)
+      {
+        const value_type::value_type& field = line->impl_[i];
+        widths[i] = std::max(widths[i],
+                             field.length() - hanging_sign(field, i));
+      }
+      if (fields != line->size())
+      { commented_fields = std::max(commented_fields, fields); }
+    }
+
+    std::vector<std::size_t> positions(widths.size());
+    std::size_t end_pos = 0, comment_pos = 0;
+    for (std::size_t i = 0; i < widths.size(); ++i)
+    {
+      positions[i] = i == 0 ? std::size_t(value_type::shift_width_) :
+        end_pos + value_type::calc_spaces_for_indent(end_pos);
+      end_pos = positions[i] + widths[i];
+      if (i + 1 == commented_fields) comment_pos = end_pos;
+    }
+    comment_pos += value_type::calc_spaces_for_indent(comment_pos);
+
+    for (iterator line = impl_.begin(); line != impl_.end(); ++line)
+    {
+      if (!is_table_row(*line))
+      {
+        line->reformat();
+        continue;
+      }
+
+      const std::size_t fields = data_size(*line);
+      line->will_change();
+      line->columns_.resize(line->size());
+      for (std::size_t i = 0; i < fields; ++i)
+      {
+        line->columns_[i] = positions[i] - hanging_sign(line->impl_[i], i);
+      }
+      if (fields != line->size()) line->columns_[fields] = comment_pos;
+    }
+  }
+
+  /**
+   * \brief Applies a function to all numbers in a column of the
+   *   %Block.
+   * \param column Index of the fields that are transformed.
+   * \param f Function or function object that takes and returns a
+   *   \c double.
+   * \param precision Number of digits after the decimal point of the
+   *   transformed numbers.
+   * \return The number of transformed fields.
+   *
+   * The fields in \p column of all data Lines that are numbers are
+   * parsed into one contiguous buffer, \p f is applied to the whole
+   * buffer in a single loop (which the compiler can vectorize if \p f
+   * is an inlinable function object), and the results are written
+   * back in scientific notation. Fields that are not numbers are left
+   * unchanged. Instead of reformatting the Lines, only the fields
+   * after a transformed field are shifted by the change of its
+   * length.
+   * \sa Coll::transform_column()
+   */
+  template<class Function> size_type
+  transform_column(size_type column, Function f,
+                   int precision = std::numeric_limits<double>::digits10)
+  {
+    std::vector<value_type*> lines;
+    std::vector<double> values;
+    double value = 0.;
+
+    for (iterator line = impl_.begin(); line != impl_.end(); ++line)
+    {
+      if (line->is_data_line() && column < line->data_size() &&
+          detail::parse_number(line->impl_[column], value))
+      {
+        lines.push_back(&*line);
+        values.push_back(value);
+      }
+    }
+    if (values.empty()) return 0;
+
+    index_.touch_all();
+    std::transform(values.begin(), values.end(), values.begin(), f);
+
+    char field[64];
+    precision = std::max(0, std::min(precision, 40));
+    for (size_type i = 0; i < values.size(); ++i)
+    {
+      const int length = std::sprintf(field, "%.*e", precision, values[i]);
+      lines[i]->replace_field(column, field, length);
+    }
+    return values.size();
+  }
+
+  /**
+   * \brief Comments all Lines in the %Block.
+   * \sa Line::comment()
+   */
+  void
+  comment()
+  {
+    index_.touch_all();
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::comment));
+  }
+
+  /**
+   * \brief Uncomments all Lines in the %Block.
+   * \sa Line::uncomment()
+   */
+  void
+  uncomment()
+  {
+    index_.touch_all();
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::uncomment));
+  }
+
+  /** Unary predicate that checks if a provided key matches a Line. */
+  struct key_matches : public std::unary_function<value_type, bool>
+  {
+    explicit
+    key_matches(const key_type& key) : parts_(key.begin(), key.end()) {}
+
+    bool
+    operator()(const value_type& line) const
+    {
+      return (parts_.empty() || parts_.size() > line.size()) ? false :
+        std::equal(parts_.begin(), parts_.end(), line.begin(), part_matches);
+    }
+
+    void
+    set_key(const key_type& key)
+    {
+      std::vector<detail::key_pattern>(key.begin(), key.end()).swap(parts_);
+    }
+
+  private:
+    static bool
+    part_matches(const detail::key_pattern& part, const std::string& field)
+    { return part(field); }
+
+  private:
+    std::vector<detail::key_pattern> parts_;
+  };
+
+private:
+  template<class Container> static key_type
+  cont_to_key(const Container& cont)
+  {
+    key_type key;
+    key.reserve(cont.size());
+    std::string (*to_string)(const typename Container::value_type&) =
+      boost::lexical_cast<std::string, typename Container::value_type>;
+    std::transform(cont.begin(), cont.end(), std::back_inserter(key),
+      to_string);
+    return key;
+  }
+
+  static key_type
+  strings_to_key(const std::string& s0, const std::string& s1,
+                 const std::string& s2, const std::string& s3,
+                 const std::string& s4)
+  {
+    key_type key;
+    key.reserve(5);
+    if (s0.empty()) return key; key.push_back(s0);
+    if (s1.empty()) return key; key.push_back(s1);
+    if (s2.empty()) return key; key.push_back(s2);
+    if (s3.empty()) return key; key.push_back(s3);
+    if (s4.empty()) return key; key.push_back(s4);
+    return key;
+  }
+
+  static key_type
+  ints_to_key(int i0, int i1, int i2, int i3, int i4)
+  {
+    key_type key;
+    key.reserve(5);
+    if (i0 == no_index_) return key; key.push_back(to_string(i0));
+    if (i1 == no_index_) return key; key.push_back(to_string(i1));
+    if (i2 == no_index_) return key; key.push_back(to_string(i2));
+    if (i3 == no_index_) return key; key.push_back(to_string(i3));
+    if (i4 == no_index_) return key; key.push_back(to_string(i4));
+    return key;
+  }
+
+  // Lines that align_columns() lays out as rows of a table.
+  static bool
+  is_table_row(const value_type& line)
+  {
+    return !line.empty() && !value_type::is_block_specifier(line.front())
+      && !value_type::is_comment(line.front());
+  }
+
+  // Like Line::reformat(), signs of all but the first field are
+  // placed in front of the column.
+  static std::size_t
+  hanging_sign(const value_type::value_type& field, std::size_t column)
+  { return column > 0 && value_type::starts_with_sign(field); }
+
+  // Number of fields of a Line without its trailing comment.
+  static std::size_t
+  data_size(const value_type& line)
+  { return line.size() - value_type::is_comment(line.back()); }
+
+  // Looks up the candidates for key in the key index. Only the first
+  // string of key is indexed.
+  detail::key_index::lookup_type
+  lookup(const key_type& key, std::vector<size_type>& candidates) const
+  {
+    if (key.empty()) return detail::key_index::scan;
+    return index_.lookup<index_traits>(impl_.begin(), impl_.end(), key[0],
+                                       candidates);
+  }
+
+  // Returns the position of the first Line that matches key, or size()
+  // if there is no such Line.
+  size_type
+  find_position(const key_type& key) const
+  {
+    const key_matches pred(key);
+    std::vector<size_type> candidates;
+    switch (lookup(key, candidates))
+    {
+    case detail::key_index::scan:
+      return std::find_if(impl_.begin(), impl_.end(), pred) - impl_.begin();
+    case detail::key_index::absent:
+      return size();
+    case detail::key_index::found:
+      break;
+    }
+
+    size_type position = size();
+    for (std::vector<size_type>::const_iterator i = candidates.begin();
+         i != candidates.end(); ++i)
+    { if (*i < position && pred(impl_[*i])) position = *i; }
+    return position;
+  }
+
+  struct index_traits
+  {
+    static const std::string*
+    key(const value_type& line)
+    { return line.empty() ? 0 : &line.front(); }
+
+    static const std::string*
+    field(const value_type& line, size_type column)
+    { return column < line.size() ? &line[column] : 0; }
+  };
+
+  // Returns the Line at position after marking it as possibly changed.
+  // This is required whenever mutable access to a Line is handed out.
+  reference
+  touch(size_type position)
+  {
+    index_.touch(position);
+    return impl_[position];
+  }
+
+  void
+  did_insert(size_type index, size_type count)
+  {
+    index_.did_insert(index, count);
+    slots_.did_insert(index, count);
+    if (count == 0 || !link_.coll) return;
+
+    log_insert(index, count);
+    link_lines(impl_.front().owner_ == this ? index : 0);
+  }
+
+  void
+  will_erase(size_type index, size_type count)
+  {
+    log_erase(index, count);
+    index_.invalidate();
+    slots_.will_erase(index, count);
+  }
+
+  void
+  will_replace_all()
+  {
+    log_replace();
+    index_.invalidate();
+    slots_.reset();
+  }
+
+  // Exchanges the name and Lines with block without recording it.
+  void
+  swap_content(Block& block)
+  {
+    name_.swap(block.name_);
+    impl_.swap(block.impl_);
+    std::swap(slots_, block.slots_);
+    index_.invalidate();
+    block.index_.invalidate();
+    if (!link_.coll && !block.link_.coll) return;
+
+    link_lines();
+    block.link_lines();
+  }
+
+  // Sets the position of the %Block in the Coll that records its
+  // changes, or unlinks it if coll is null.
+  void
+  link(Coll* coll, size_type index)
+  {
+    const bool relink = !link_.coll != !coll;
+    link_.coll = coll;
+    link_.index = index;
+    if (relink) link_lines();
+  }
+
+  // Makes the %Block the owner of its Lines from position first on if
+  // it is linked to a Coll, so that they report their changes, and
+  // releases them otherwise. Copies of Lines are never owned, hence
+  // this is needed whenever the vector of Lines may have copied them.
+  void
+  link_lines(size_type first = 0)
+  {
+    Block* const owner = link_.coll ? this : 0;
+    for (iterator line = impl_.begin() + first; line != impl_.end(); ++line)
+    { line->owner_ = owner; }
+  }
+
+  // Report changes to the Coll that records them. They are defined
+  // after Coll and do nothing unless the %Block is linked to a Coll.
+  void log_modify(size_type position);
+  void log_insert(size_type position, size_type count);
+  void log_erase(size_type position, size_type count);
+  void log_replace();
+  void log_rename();
+
+  // Position of the %Block in the Coll that records its changes. While
+  // the Lines are shifted within the %Block, their changes are not
+  // reported.
+  struct coll_link
+  {
+    coll_link() : coll(0), index(0), suspended(false) {}
+
+    Coll* coll;
+    size_type index;
+    bool suspended;
+  };
+
+private:
+  std::string name_;
+  impl_type impl_;
+  detail::key_index index_;
+  detail::slot_map slots_;
+  coll_link link_;
+  static const int no_index_ = -32768;
+};
+
+
+/**
+ * Selection of the fields that are read from the Lines of a Block.
+ * This class selects for Blocks with given names which fields of
+ * their Lines are read by Coll::read(std::istream&, const Projection&).
+ * Block names are compared case-insensitive. Blocks without selection
+ * are read completely.
+ */
+class Projection
+{
+public:
+  typedef std::vector<bool> fields_type;
+
+  /** Constructs an empty %Projection that selects every field. */
+  Projection() : impl_() {}
+
+  /**
+   * \brief Selects a field of the Lines of a Block.
+   * \param blockName Name of the Block.
+   * \param field Index of the field that is selected.
+   * \return Reference to \c *this.
+   */
+  Projection&
+  add(const std::string& blockName, std::size_t field)
+  {
+    fields_type& fields = impl_[detail::to_upper_copy(blockName)];
+    if (fields.size() <= field) fields.resize(field + 1, false);
+    fields[field] = true;
+    return *this;
+  }
+
+  /**
+   * \brief Returns the selection of fields of a Block.
+   * \param blockName Name of the Block.
+   * \return Pointer to the selection of fields of the Block or a null
+   *   pointer if every field of the Block is selected.
+   */
+  const fields_type*
+  find(const std::string& blockName) const
+  {
+    if (impl_.empty()) return 0;
+
+    std::map<std::string, fields_type>::const_iterator it =
+      impl_.find(detail::to_upper_copy(blockName));
+    return it != impl_.end() ? &it->second : 0;
+  }
+
+  /** Returns true if the %Projection selects every field. */
+  bool
+  empty() const
+  { return impl_.empty(); }
+
+private:
+  std::map<std::string, fields_type> impl_;
+};
+
+
+/**
+ * Change of a single field in a Coll.
+ * This data type describes how a single field of a Coll has changed.
+ * It is produced by the change journal of a Coll (see
+ * Coll::enable_journal()) and consists of the name of the Block and
+ * the index of the Line that contain the field, the index of the
+ * field, and its old and new value. A field that did not exist before
+ * or does not exist anymore has an empty string as old or new value,
+ * respectively.
+ */
+struct Change
+{
+  /** Kind of change of the Line that contains the field. */
+  enum kind_type
+  {
+    modified, ///< The Line existed before and exists afterwards.
+    inserted, ///< The Line was inserted.
+    erased    ///< The Line was erased.
+  };
+
+  /** Kind of change of the Line that contains the field. */
+  kind_type kind;
+
+  /** Name of the Block that contains the field. */
+  std::string block;
+
+  /**
+   * Index of the Line in the Block. For erased Lines this is the
+   * index the Line had before the change, otherwise it is the index
+   * the Line has afterwards.
+   */
+  std::size_t line;
+
+  /** Index of the field in the Line. */
+  std::size_t field;
+
+  /** Value of the field before the change. */
+  std::string old_value;
+
+  /** Value of the field after the change. */
+  std::string new_value;
+
+  /**
+   * \brief Constructs a %Change from explicit values.
+   * \param _kind Kind of change of the Line that contains the field.
+   * \param _block Name of the Block that contains the field.
+   * \param _line Index of the Line in the Block.
+   * \param _field Index of the field in the Line.
+   * \param _old_value Value of the field before the change.
+   * \param _new_value Value of the field after the change.
+   */
+  Change(kind_type _kind, const std::string& _block, std::size_t _line,
+         std::size_t _field, const std::string& _old_value,
+         const std::string& _new_value)
+    : kind(_kind), block(_block), line(_line), field(_field),
+      old_value(_old_value), new_value(_new_value) {}
+};
+
+
+/**
+ * Container of Blocks that resembles a complete SLHA structure.
+ * This class is a container of Blocks that resembles a complete SLHA
+ * structure. Its name is an abbreviation of "collection" since it is
+ * a collection of Blocks. The elements of %Coll objects can be
+ * accessed via their names (which are always compared
+ * case-insensitive) with the operator[]() and at() functions and
+ * access to single fields, Lines and Blocks via the Key type is
+ * provided by the field(), line() and block() functions. Names
+ * marked with SLHAea::pattern(), like <tt>pattern("NMIX*")</tt> or
+ * <tt>pattern("{UMIX,VMIX}")</tt>, are patterns, see Block for their
+ * syntax. To fill this container, the functions read() or
+ * str() can be used which read data from an input stream or a string,
+ * respectively. Changes of a %Coll and of its Blocks and Lines can be
+ * recorded in order to roll them back, see checkpoint(), or to report
+ * them field by field, see enable_journal().
+ */
+class Coll
+{
+private:
+  typedef std::deque<Block> impl_type;
+
+  // Change of a Block or Line that can be undone. Positions of Blocks
+  // and Lines refer to the state right before the change, so that the
+  // entries of a log are undone in reverse order.
+  struct log_entry
+  {
+    enum action_type
+    {
+      line_modified, lines_inserted, lines_erased, lines_replaced,
+      block_renamed, blocks_inserted, block_erased, blocks_replaced
+    };
+
+    explicit
+    log_entry(action_type _action, std::size_t _block = 0,
+              std::size_t _index = 0, std::size_t _count = 0)
+      : action(_action), block(_block), index(_index), count(_count),
+        line(), lines(), name(), blocks() {}
+
+    action_type action;
+    std::size_t block;
+    std::size_t index;
+    std::size_t count;
+    Line line;
+    std::vector<Line> lines;
+    std::string name;
+    std::vector<Block> blocks;
+  };
+
+  // Lines of a Block that are already recorded in a log. All Lines of
+  // inserted and replaced Blocks are.
+  struct saved_lines
+  {
+    explicit
+    saved_lines(bool _all = false) : all(_all), lines() {}
+
+    bool all;
+    std::vector<bool> lines;
+  };
+
+  // Log of the changes since the start of a recording. A deque keeps
+  // the recorded Lines and Blocks in place when the log grows.
+  struct undo_log
+  {
+    undo_log() : entries(), saved(), active(false) {}
+
+    void
+    start(std::size_t size)
+    {
+      saved.assign(size, saved_lines());
+      active = true;
+    }
+
+    void
+    stop()
+    {
+      entries.clear();
+      saved.clear();
+      active = false;
+    }
+
+    std::deque<log_entry> entries;
+    std::vector<saved_lines> saved;
+    bool active;
+  };
+
+public:
+  typedef std::string                       key_type;
+  typedef Block                             value_type;
+  typedef Block&                            reference;
+  typedef const Block&                      const_reference;
+  typedef impl_type::iterator               iterator;
+  typedef impl_type::const_iterator         const_iterator;
+  typedef impl_type::reverse_iterator       reverse_iterator;
+  typedef impl_type::const_reverse_iterator const_reverse_iterator;
+  typedef impl_type::pointer                pointer;
+  typedef impl_type::const_pointer          const_pointer;
+  typedef impl_type::difference_type        difference_type;
+  typedef impl_type::size_type              size_type;
+  typedef Handle<value_type>                handle_type;
+  typedef std::size_t                       checkpoint_type;
+  typedef boost::function<void (const Change&)> observer_type;
+
+  /** Constructs an empty %Coll. */
+  Coll()
+    : impl_(), undo_log_(), checkpoints_(), journal_(), observers_(),
+      index_(), slots_(), suspended_(false) {}
+
+  /**
+   * \brief Constructs a %Coll with the Blocks of another %Coll.
+   * \param coll %Coll whose Blocks are copied.
+   *
+   * Checkpoints, the journal and the observers of \p coll are not
+   * copied, i.e. the new %Coll has no active checkpoint, its journal
+   * is disabled and no observer is registered.
+   */
+  Coll(const Coll& coll)
+    : impl_(coll.impl_), undo_log_(), checkpoints_(), journal_(),
+      observers_(), index_(),
+      slots_(coll.slots_), suspended_(false) {}
+
+  /**
+   * \brief Replaces the Blocks of the %Coll with those of another
+   *   %Coll.
+   * \param coll %Coll whose Blocks are copied.
+   * \return Reference to \c *this.
+   *
+   * The checkpoints, the journal and the observers of the %Coll are
+   * kept and the assignment is recorded like every other change, so
+   * that it can be rolled back. Those of \p coll are not copied.
+   */
+  Coll&
+  operator=(const Coll& coll)
+  {
+    if (this == &coll) return *this;
+
+    will_replace_all();
+    {
+      detail::scoped_flag suspend(suspended_);
+      impl_ = coll.impl_;
+    }
+    slots_ = coll.slots_;
+    did_replace_all();
+    return *this;
+  }
+
+#ifdef SLHAEA_HAS_CXX11
+  /**
+   * \brief Constructs a %Coll with the Blocks of another %Coll.
+   * \param coll %Coll whose Blocks are moved.
+   */
+  Coll(Coll&& coll)
+    : impl_(), undo_log_(), checkpoints_(), journal_(), observers_(),
+      index_(), slots_(), suspended_(false)
+  {
+    coll.will_replace_all();
+    impl_.swap(coll.impl_);
+    std::swap(slots_, coll.slots_);
+    did_replace_all();
+    coll.did_replace_all();
+  }
+
+  /**
+   * \brief Replaces the Blocks of the %Coll with those of another
+   *   %Coll.
+   * \param coll %Coll whose Blocks are moved.
+   * \return Reference to \c *this.
+   */
+  Coll&
+  operator=(Coll&& coll)
+  {
+    if (this == &coll) return *this;
+
+    will_replace_all();
+    coll.will_replace_all();
+    impl_.swap(coll.impl_);
+    std::swap(slots_, coll.slots_);
+    did_replace_all();
+    coll.did_replace_all();
+    return *this;
+  }
+#endif
+
+  /**
+   * \brief Constructs a %Coll with content from an input stream.
+   * \param is Input stream to read content from.
+   * \sa read()
+   */
+  explicit
+  Coll(std::istream& is)
+    : impl_(), undo_log_(), checkpoints_(), journal_(), observers_(),
+      index_(), slots_(), suspended_(false)
+  { read(is); }
+
+  /**
+   * \brief Constructs a %Coll with content from a string.
+   * \param coll String to read content from.
+   */
+  static Coll
+  from_str(const std::string& coll)
+  {
+    Coll result;
+    result.str(coll);
+    return result;
+  }
+
+  /**
+   * \brief Assigns content from an input stream to the %Coll.
+   * \param is Input stream to read content from.
+   * \returns Reference to \c *this.
+   *
+   * This function reads non-empty lines from \p is, transforms them
+   * into Lines, which are collected into the corresponding Blocks
+   * that are added to the %Coll.
+   */
+  Coll&
+  read(std::istream& is)
+  { return read(is, Projection()); }
+
+  /**
+   * \brief Assigns selected content from an input stream to the %Coll.
+   * \param is Input stream to read content from.
+   * \param projection Selection of the fields that are read.
+   * \returns Reference to \c *this.
+   *
+   * This function works like read(std::istream&) but stores only the
+   * fields of the Blocks in \p projection that are selected by it
+   * (see Line::str(const std::string&, const std::vector<bool>&)).
+   * Lines of these Blocks that have no selected field are skipped.
+   */
+  Coll&
+  read(std::istream& is, const Projection& projection);
+
+  /**
+   * \brief Assigns content from a memory buffer to the %Coll.
+   * \param first, last Pointers to the initial and final positions of
+   *   the buffer.
+   * \returns Reference to \c *this.
+   *
+   * This function works like read(std::istream&) but reads the
+   * characters in the range [\p first, \p last). Since the whole
+   * input is available, it first counts the Blocks, the Lines per
+   * Block, and the fields per Line, and then reserves the exact
+   * capacities of all containers, so that none of them needs to grow
+   * while the Lines are parsed.
+   */
+  Coll&
+  read(const char* first, const char* last);
+
+  /**
+   * \brief Reads content from an input stream until the Blocks and
+   *   Lines of the given Keys have been read.
+   * \param is Input stream to read content from.
+   * \param required Keys of the Lines that are needed.
+   * \returns Number of characters that were extracted from \p is.
+   *
+   * This function works like read(std::istream&) but stops right
+   * after the Line that completes the set of Lines referred to by
+   * \p required, leaving the rest of the input in \p is. A Key with an
+   * empty line part (e.g. <tt>"MASS;;0"</tt>) only requires the
+   * definition of its Block. The field index of the Keys is ignored.
+   * If not all Keys are found, the whole input is read.
+   *
+   * Reading can be resumed with another call of read() or
+   * read_until() on the same stream. The remaining Lines of a Block
+   * that was only partially read are then collected into a Block
+   * without name.
+   */
+  std::streamsize
+  read_until(std::istream& is, const std::vector<Key>& required);
+
+  /**
+   * \brief Assigns content from a string to the %Coll.
+   * \param coll String that is used as content for the %Coll.
+   * \returns Reference to \c *this.
+   * \sa read(const char*, const char*)
+   */
+  Coll&
+  str(const std::string& coll)
+  {
+    clear();
+    return read(coll.data(), coll.data() + coll.size());
+  }
+
+  /** Returns a string representation of the %Coll. */
+  std::string
+  str() const
+  {
+    std::ostringstream output;
+    output << *this;
+    return output.str();
+  }
+
+  // element access
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write reference to sought-after Block.
+   *
+   * This function locates the first Block whose name equals
+   * \p blockName. If no such Block is present, an empty Block with
+   * this name is added to the end of the %Coll and a reference to it
+   * is then returned.
+   *
+   * \throw std::out_of_range If \p blockName is a pattern (see
+   *   SLHAea::pattern()) and no Block matches it.
+   */
+  reference
+  operator[](const key_type& blockName)
+  {
+    iterator block = find(blockName);
+    if (block != impl_.end()) return *block;
+
+    if (detail::key_pattern::is_pattern(blockName))
+    {
+      detail::throw_out_of_range("SLHAea::Coll::operator[](‘" +
+                                 blockName + "’)");
+    }
+    push_back(value_type(blockName));
+    return back();
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write reference to sought-after Block.
+   * \throw std::out_of_range If no Block with the name \p blockName
+   *   exists.
+   */
+  reference
+  at(const key_type& blockName)
+  {
+    iterator block = find(blockName);
+    if (block != impl_.end()) return *block;
+
+    detail::throw_out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) reference to sought-after Block.
+   * \throw std::out_of_range If no Block with the name \p blockName
+   *   exists.
+   */
+  const_reference
+  at(const key_type& blockName) const
+  {
+    const_iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    detail::throw_out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read/write reference to sought-after Block.
+   * \throw std::out_of_range If \p key does not match any block
+   *   definition.
+   *
+   * This functions takes a vector of strings and locates the Block
+   * whose first strings of the block definition are equal to the
+   * strings in \p key. If no such Block exists, \c std::out_of_range
+   * is thrown.
+   */
+  reference
+  at(const value_type::key_type& key)
+  {
+    iterator block = find(key);
+    if (block != impl_.end()) return *block;
+
+    detail::throw_out_of_range(
+      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read-only (constant) reference to sought-after Block.
+   * \throw std::out_of_range If \p key does not match any block
+   *   definition.
+   *
+   * This functions takes a vector of strings and locates the Block
+   * whose first strings of the block definition are equal to the
+   * strings in \p key. If no such Block exists, \c std::out_of_range
+   * is thrown.
+   */
+  const_reference
+  at(const value_type::key_type& key) const
+  {
+    const_iterator block = find(key);
+    if (block != end()) return *block;
+
+    detail::throw_out_of_range(
+      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * Returns a read/write reference to the first element of the %Coll.
+   */
+  reference
+  front()
+  {
+    will_modify(0);
+    return impl_.front();
+  }
+
+  /**
+   * Returns a read-only (constant) reference to the first element of
+   * the %Coll.
+   */
+  const_reference
+  front() const
+  { return impl_.front(); }
+
+  /**
+   * Returns a read/write reference to the last element of the %Coll.
+   */
+  reference
+  back()
+  {
+    will_modify(size() - 1);
+    return impl_.back();
+  }
+
+  /**
+   * Returns a read-only (constant) reference to the last element of
+   * the %Coll.
+   */
+  const_reference
+  back() const
+  { return impl_.back(); }
+
+  // (nested) element access via Key
+  /**
+   * \brief Accesses a Block in the %Coll.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Read/write reference to the Block referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   Block.
+   */
+  reference
+  block(const Key& key);
+
+  /**
+   * \brief Accesses a Block in the %Coll.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Read-only (constant) reference to the Block referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   Block.
+   */
+  const_reference
+  block(const Key& key) const;
+
+  /**
+   * \brief Accesses a single Line in the %Coll.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Read/write reference to the Line referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  Block::reference
+  line(const Key& key);
+
+  /**
+   * \brief Accesses a single Line in the %Coll.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Read-only (constant) reference to the Line referred to by
+   *   \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  Block::const_reference
+  line(const Key& key) const;
+
+  /**
+   * \brief Accesses a single field in the %Coll.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read/write reference to the field referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   field.
+   */
+  Line::reference
+  field(const Key& key);
+
+  /**
+   * \brief Accesses a single field in the %Coll.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read-only (constant) reference to the field referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   field.
+   */
+  Line::const_reference
+  field(const Key& key) const;
+
+  /**
+   * \brief Accesses a Block in the %Coll.
+   * \param key String that represents a Key (see Key::str()).
+   * \return Read/write reference to the Block referred to by \p key.
+   * \throw std::invalid_argument If \p key is not a valid Key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   Block.
+   *
+   * The string overloads of block(), line() and field() look up
+   * \p key in the table of InternedKeys, so each distinct string is
+   * split into a Key only once. Since interned Keys are never
+   * removed, strings that are built on the fly (e.g. with a varying
+   * index) should be converted to a Key instead.
+   */
+  reference
+  block(const std::string& key);
+
+  /** \sa block(const std::string&) */
+  reference
+  block(const char* key);
+
+  /** \sa block(const std::string&) */
+  const_reference
+  block(const std::string& key) const;
+
+  /** \sa block(const std::string&) */
+  const_reference
+  block(const char* key) const;
+
+  /** \sa block(const std::string&) */
+  Block::reference
+  line(const std::string& key);
+
+  /** \sa block(const std::string&) */
+  Block::reference
+  line(const char* key);
+
+  /** \sa block(const std::string&) */
+  Block::const_reference
+  line(const std::string& key) const;
+
+  /** \sa block(const std::string&) */
+  Block::const_reference
+  line(const char* key) const;
+
+  /** \sa block(const std::string&) */
+  Line::reference
+  field(const std::string& key);
+
+  /** \sa block(const std::string&) */
+  Line::reference
+  field(const char* key);
+
+  /** \sa block(const std::string&) */
+  Line::const_reference
+  field(const std::string& key) const;
+
+  /** \sa block(const std::string&) */
+  Line::const_reference
+  field(const char* key) const;
+
+  /**
+   * \brief Tries to access a Block in the %Coll.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Pointer to the Block referred to by \p key or a null
+   *   pointer if there is no such Block.
+   *
+   * Unlike block(), this function does not throw if \p key refers to
+   * a non-existing Block.
+   */
+  pointer
+  try_block(const Key& key);
+
+  /** \sa try_block(const Key&) */
+  const_pointer
+  try_block(const Key& key) const;
+
+  /**
+   * \brief Tries to access a single Line in the %Coll.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Pointer to the Line referred to by \p key or a null
+   *   pointer if there is no such Line.
+   */
+  Block::pointer
+  try_line(const Key& key);
+
+  /** \sa try_line(const Key&) */
+  Block::const_pointer
+  try_line(const Key& key) const;
+
+  /**
+   * \brief Tries to access a single field in the %Coll.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Pointer to the field referred to by \p key or a null
+   *   pointer if there is no such field.
+   */
+  Line::pointer
+  try_field(const Key& key);
+
+  /** \sa try_field(const Key&) */
+  Line::const_pointer
+  try_field(const Key& key) const;
+
+  // iterators
+  /**
+   * Returns a read/write iterator that points to the first element in
+   * the %Coll. Iteration is done in ordinary element order.
+   */
+  iterator
+  begin()
+  {
+    index_.touch_all();
+    return impl_.begin();
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  begin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cbegin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read/write iterator that points one past the last
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  iterator
+  end()
+  {
+    index_.touch_all();
+    return impl_.end();
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  end() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cend() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to the last
+   * element in the %Coll. Iteration is done in reverse element order.
+   */
+  reverse_iterator
+  rbegin()
+  {
+    index_.touch_all();
+    return impl_.rbegin();
+  }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  rbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  crbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to one before
+   * the first element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  reverse_iterator
+  rend()
+  {
+    index_.touch_all();
+    return impl_.rend();
+  }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Coll. Iteration is done in
+   * reverse element order.
+   */
+  const_reverse_iterator
+  rend() const
+  { return impl_.rend(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Coll. Iteration is done in
+   * reverse element order.
+   */
+  const_reverse_iterator
+  crend() const
+  { return impl_.rend(); }
+
+  // lookup
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write iterator pointing to sought-after element, or
+   *   end() if not found.
+   *
+   * This function takes a key and tries to locate the Block whose
+   * name matches \p blockName. If successful the function returns a
+   * read/write iterator pointing to the sought after Block. If
+   * unsuccessful it returns end().
+   *
+   * If the %Coll is frozen() and no Block has the name
+   * \p blockName, this is detected with a Bloom filter without
+   * searching the %Coll.
+   */
+  iterator
+  find(const key_type& blockName)
+  { return touch(impl_.begin() + find_position(blockName)); }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) iterator pointing to sought-after
+   *   element, or end() const if not found.
+   *
+   * This function takes a key and tries to locate the Block whose
+   * name matches \p blockName. If successful the function returns a
+   * read-only (constant) iterator pointing to the sought after Block.
+   * If unsuccessful it returns end() const.
+   * \sa find(const key_type&)
+   */
+  const_iterator
+  find(const key_type& blockName) const
+  { return begin() + find_position(blockName); }
+
+  /**
+   * \brief Tries to locate a Block in a range.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   * \param blockName Name of the Block to be located.
+   * \return Iterator pointing to sought-after element, or \p last if
+   *   not found.
+   *
+   * This function tries to locate in the range [\p first, \p last)
+   * the Block whose name matches \p blockName. If successful the
+   * function returns an iterator pointing to the sought after Block.
+   * If unsuccessful it returns \p last.
+   */
+  template<class InputIterator> static InputIterator
+  find(InputIterator first, InputIterator last, const key_type& blockName)
+  { return std::find_if(first, last, key_matches(blockName)); }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read/write iterator pointing to sought-after element, or
+   *   end() if not found.
+   *
+   * This functions takes a vector of strings and tries to locate the
+   * Block whose first strings of the block definition are equal to
+   * the strings in \p key. If successful the function returns a
+   * read/write iterator pointing to the sought after Block. If
+   * unsuccessful it returns end().
+   */
+  iterator
+  find(const value_type::key_type& key)
+  {
+    return touch(std::find_if(impl_.begin(), impl_.end(),
+                              key_matches_block_def(key)));
+  }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read-only (constant) iterator pointing to sought-after
+   *   element, or end() const if not found.
+   *
+   * This functions takes a vector of strings and tries to locate the
+   * Block whose first strings of the block definition are equal to
+   * the strings in \p key. If successful the function returns a
+   * read-only (constant) iterator pointing to the sought after Block.
+   * If unsuccessful it returns end() const.
+   */
+  const_iterator
+  find(const value_type::key_type& key) const
+  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+
+  /**
+   * \brief Tries to locate a Block in a range.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Iterator pointing to sought-after element, or \p last if
+   *   not found.
+   *
+   * This function tries to locate in the range [\p first, \p last)
+   * the Block whose first strings of the block definition are equal
+   * to the strings in \p key. If successful the function returns an
+   * iterator pointing to the sought after Block. If unsuccessful it
+   * returns \p last.
+   */
+  template<class InputIterator> static InputIterator
+  find(InputIterator first, InputIterator last,
+       const value_type::key_type& key)
+  { return std::find_if(first, last, key_matches_block_def(key)); }
+
+  // introspection
+  /**
+   * \brief Counts all Blocks with a given name.
+   * \param blockName Name of the Blocks that will be counted.
+   * \return Number of blocks whose name equals \p blockName.
+   */
+  size_type
+  count(const key_type& blockName) const
+  {
+    const key_matches pred(blockName);
+    std::vector<size_type> candidates;
+    switch (index_.lookup<index_traits>(impl_.begin(), impl_.end(),
+                                        blockName, candidates))
+    {
+    case detail::key_index::scan:
+      return std::count_if(begin(), end(), pred);
+    case detail::key_index::absent:
+      return 0;
+    case detail::key_index::found:
+      break;
+    }
+
+    size_type matches = 0;
+    for (std::vector<size_type>::const_iterator i = candidates.begin();
+         i != candidates.end(); ++i)
+    { matches += pred(impl_[*i]); }
+    return matches;
+  }
+
+  /**
+   * \brief Locates all Blocks whose block definition has an integer
+   *   in a given range in a given column.
+   * \param column Index of the field of the block definition that is
+   *   compared, e.g. 1 for the PDG code of a DECAY block.
+   * \param lo, hi Bounds of the closed interval [\p lo, \p hi].
+   * \return CollView of the matching Blocks, ordered by the value of
+   *   their field and then by their position.
+   *
+   * Like Block::range(), the query uses a sorted index per column if
+   * the %Coll is frozen() and scans the %Coll otherwise.
+   */
+  CollView
+  range(size_type column, long lo, long hi) const;
+
+  /**
+   * \brief Locates all Lines of a Block whose field in a given
+   *   column is an integer in a given range.
+   * \param blockName Name of the Block.
+   * \param column Index of the field that is compared.
+   * \param lo, hi Bounds of the closed interval [\p lo, \p hi].
+   * \throw std::out_of_range If no Block has the name \p blockName.
+   * \sa Block::range()
+   */
+  BlockView
+  range(const key_type& blockName, size_type column, long lo,
+        long hi) const;
+
+  /**
+   * \brief Converts a Block into a NumericBlock.
+   * \param blockName Name of the Block.
+   * \return NumericBlock with the content of the Block.
+   * \throw std::out_of_range If no Block has the name \p blockName.
+   * \throw std::invalid_argument If a data field of the Block is not a
+   *   number.
+   * \sa NumericBlock::assign()
+   */
+  NumericBlock
+  numeric(const key_type& blockName) const;
+
+  /**
+   * \brief Enables lookup structures for the %Coll and all its Blocks.
+   *
+   * While the %Coll is frozen, find(), count(), at() and range()
+   * consult a Bloom filter and sorted indices of its Blocks instead
+   * of scanning it, and all Blocks are frozen as well (see
+   * Block::freeze()), including Blocks that are added later. This
+   * makes repeated lookups in large Colls, in particular with
+   * field(), line() and block(), considerably faster.
+   *
+   * Like those of a Block, the structures are built by the first
+   * lookup and kept up to date afterwards. Blocks that a non-const
+   * member function made accessible for modification are compared
+   * with the indexed names by the next lookup, so that e.g.
+   * <tt>coll.at("MASS").at("25")</tt> uses the structures of the
+   * %Coll and of the Block. Changes through references, pointers or
+   * iterators to Blocks or Lines are only detected if they are made
+   * before the next lookup in the %Coll or Block, respectively.
+   */
+  void
+  freeze()
+  {
+    index_.enable();
+    freeze_blocks(0, size());
+  }
+
+  /**
+   * \brief Removes the lookup structures of the %Coll and all its
+   *   Blocks.
+   * \sa freeze()
+   */
+  void
+  thaw()
+  {
+    index_.disable();
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::thaw));
+  }
+
+  /** Returns true if the %Coll is frozen. \sa freeze() */
+  bool
+  frozen() const
+  { return index_.enabled(); }
+
+  // capacity
+  /** Returns the number of elements in the %Coll. */
+  size_type
+  size() const
+  { return impl_.size(); }
+
+  /** Returns the size() of the largest possible %Coll. */
+  size_type
+  max_size() const
+  { return impl_.max_size(); }
+
+  /** Returns true if the %Coll is empty. */
+  bool
+  empty() const
+  { return impl_.empty(); }
+
+  // stable handles
+  /**
+   * \brief Returns a stable handle to a Block in the %Coll.
+   * \param block Iterator pointing to a Block in the %Coll.
+   * \return Handle that refers to the Block.
+   *
+   * The returned Handle stays valid while Blocks are inserted into or
+   * erased from the %Coll with its modifiers, and becomes stale when
+   * the Block it refers to is erased, or when the %Coll is cleared or
+   * swapped. Notice that reordering Blocks through iterators is not
+   * detected.
+   * \sa Block::handle()
+   */
+  handle_type
+  handle(const_iterator block)
+  {
+    handle_type result;
+    result.slot = slots_.acquire(block - impl_.begin(), size(),
+                                 result.generation);
+    return result;
+  }
+
+  /**
+   * \brief Resolves a Handle to a Block in the %Coll.
+   * \param handle Handle that was returned by handle().
+   * \return Pointer to the Block \p handle refers to or a null
+   *   pointer if \p handle is stale.
+   */
+  pointer
+  resolve(const handle_type& handle)
+  {
+    const size_type index = slots_.resolve(handle.slot, handle.generation);
+    if (index == detail::slot_map::npos) return 0;
+
+    will_modify(index);
+    return &impl_[index];
+  }
+
+  /**
+   * \brief Resolves a Handle to a Block in the %Coll.
+   * \param handle Handle that was returned by handle().
+   * \return Pointer to the (constant) Block \p handle refers to or a
+   *   null pointer if \p handle is stale.
+   */
+  const_pointer
+  resolve(const handle_type& handle) const
+  {
+    const size_type index = slots_.resolve(handle.slot, handle.generation);
+    return index != detail::slot_map::npos ? &impl_[index] : 0;
+  }
+
+  // modifiers
+  /**
+   * \brief Adds a Block to the end of the %Coll.
+   * \param block Block to be added.
+   *
+   * This function creates an element at the end of the %Coll and
+   * assigns the given \p block to it.
+   */
+  void
+  push_back(const value_type& block)
+  {
+    impl_.push_back(block);
+    did_insert(size() - 1);
+  }
+
+  /**
+   * \brief Adds a Block to the end of the %Coll.
+   * \param blockString String that is used to construct the Block
+   *   that will be added.
+   *
+   * This function creates an element at the end of the %Coll and
+   * assigns the Block that is constructed from \p blockString to it.
+   */
+  void
+  push_back(const std::string& blockString)
+  {
+    value_type block;
+    block.str(blockString);
+    push_back(block);
+  }
+
+  /**
+   * \brief Adds a Block to the begin of the %Coll.
+   * \param block Block to be added.
+   *
+   * This function creates an element at the begin of the %Coll and
+   * assigns the given \p block to it.
+   */
+  void
+  push_front(const value_type& block)
+  {
+    impl_.push_front(block);
+    did_insert(0);
+  }
+
+  /**
+   * \brief Adds a Block to the begin of the %Coll.
+   * \param blockString String that is used to construct the Block
+   *   that will be added.
+   *
+   * This function creates an element at the begin of the %Coll and
+   * assigns the Block that is constructed from \p blockString to it.
+   */
+  void
+  push_front(const std::string& blockString)
+  {
+    value_type block;
+    block.str(blockString);
+    push_front(block);
+  }
+
+  /**
+   * Removes the last element. This function shrinks the size() of the
+   * %Coll by one.
+   */
+  void
+  pop_back()
+  {
+    will_erase(size() - 1);
+    impl_.pop_back();
+  }
+
+  /**
+   * \brief Inserts a Block before given \p position.
+   * \param position Iterator into the %Coll.
+   * \param block Block to be inserted.
+   * \return Iterator pointing to the inserted element.
+   *
+   * This function inserts a copy of \p block before the specified
+   * \p position and thus enlarges the %Coll by one.
+   */
+  iterator
+  insert(iterator position, const value_type& block)
+  {
+    const size_type index = position - impl_.begin();
+    {
+      detail::scoped_flag suspend(suspended_);
+      impl_.insert(position, block);
+    }
+    did_insert(index);
+    return impl_.begin() + index;
+  }
+
+  /**
+   * \brief Inserts a range into the %Coll.
+   * \param position Iterator into the %Coll.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   *
+   * This function inserts copies of the Blocks in the range
+   * [\p first, \p last) into the %Coll before the specified
+   * \p position and thus enlarges the %Coll accordingly.
+   */
+  template<class InputIterator> void
+  insert(iterator position, InputIterator first, InputIterator last)
+  {
+    const size_type index = position - impl_.begin();
+    const size_type orig_size = size();
+    {
+      detail::scoped_flag suspend(suspended_);
+      impl_.insert(position, first, last);
+    }
+    did_insert(index, size() - orig_size);
+  }
+
+  /**
+   * \brief Erases element at given \p position.
+   * \param position Iterator pointing to the element to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function erases the element at the given \p position and
+   * thus shortens the %Coll by one.
+   */
+  iterator
+  erase(iterator position)
+  {
+    const size_type index = position - impl_.begin();
+    will_erase(index);
+    {
+      detail::scoped_flag suspend(suspended_);
+      impl_.erase(position);
+    }
+    did_erase(index);
+    return impl_.begin() + index;
+  }
+
+  /**
+   * \brief Erases a range of elements.
+   * \param first Iterator pointing to the first element to be erased.
+   * \param last Iterator pointing to one past the last element to be
+   *   erased.
+   * \return Iterator pointing to the element pointed to by \p last
+   *   prior to erasing (or end()).
+   *
+   * This function erases the elements in the range [\p first,
+   * \p last) and shortens the %Coll accordingly.
+   */
+  iterator
+  erase(iterator first, iterator last)
+  {
+    const size_type index = first - impl_.begin();
+    will_erase(index, last - first);
+    {
+      detail::scoped_flag suspend(suspended_);
+      impl_.erase(first, last);
+    }
+    did_erase(index);
+    return impl_.begin() + index;
+  }
+
+  /**
+   * \brief Erases first Block with a given name.
+   * \param blockName Name of the Block to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key and erases the first Block whose name
+   * matches \p blockName. If the %Coll contains such Block, the
+   * function returns an iterator pointing to the next element (or
+   * end()). If no such Block exists, end() is returned.
+   */
+  iterator
+  erase_first(const key_type& blockName)
+  {
+    iterator block = std::find_if(impl_.begin(), impl_.end(),
+                                  key_matches(blockName));
+    return (block != impl_.end()) ? erase(block) : block;
+  }
+
+  /**
+   * \brief Erases last Block with a given name.
+   * \param blockName Name of the Block to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key and erases the last Block whose name
+   * matches \p blockName. If the %Coll contains such Block, the
+   * function returns an iterator pointing to the next element (or
+   * end()). If no such Block exists, end() is returned.
+   */
+  iterator
+  erase_last(const key_type& blockName)
+  {
+    reverse_iterator block = find(impl_.rbegin(), impl_.rend(), blockName);
+    return (block != impl_.rend()) ? erase((++block).base()) : impl_.end();
+  }
+
+  /**
+   * \brief Erases all Blocks with a given name.
+   * \param blockName Name of the Blocks to be erased.
+   * \return The number of Blocks erased.
+   */
+  size_type
+  erase(const key_type& blockName)
+  {
+    const key_matches pred(blockName);
+    size_type erased_count = 0;
+
+    for (iterator block = impl_.begin(); block != impl_.end();)
+    {
+      if (pred(*block))
+      {
+        block = erase(block);
+        ++erased_count;
+      }
+      else ++block;
+    }
+    return erased_count;
+  }
+
+  /**
+   * \brief Swaps data with another %Coll.
+   * \param coll %Coll to be swapped with.
+   */
+  void
+  swap(Coll& coll)
+  {
+    will_replace_all();
+    coll.will_replace_all();
+    slots_.reset();
+    coll.slots_.reset();
+    impl_.swap(coll.impl_);
+    did_replace_all();
+    coll.did_replace_all();
+  }
+
+  /** Erases all the elements in the %Coll. */
+  void
+  clear()
+  {
+    will_replace_all();
+    slots_.reset();
+    impl_.clear();
+    did_replace_all();
+  }
+
+  /**
+   * \brief Reformats all Blocks in the %Coll.
+   * \sa Block::reformat()
+   */
+  void
+  reformat()
+  {
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::reformat));
+  }
+
+  /**
+   * \brief Aligns the fields of all Blocks in the %Coll in columns.
+   * \sa Block::align_columns()
+   */
+  void
+  align_columns()
+  {
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::align_columns));
+  }
+
+  /**
+   * \brief Applies a function to all numbers in a column of the
+   *   Blocks with a given name.
+   * \param blockName Name of the Blocks, which may be a pattern.
+   * \param column Index of the fields that are transformed.
+   * \param f Function or function object that takes and returns a
+   *   \c double.
+   * \param precision Number of digits after the decimal point of the
+   *   transformed numbers.
+   * \return The number of transformed fields.
+   * \sa Block::transform_column()
+   */
+  template<class Function> size_type
+  transform_column(const key_type& blockName, size_type column, Function f,
+                   int precision = std::numeric_limits<double>::digits10)
+  { return transform_blocks(key_matches(blockName), column, f, precision); }
+
+  /**
+   * \brief Applies a function to all numbers in a column of the
+   *   Blocks whose block definition matches a given key.
+   * \param key First strings of the block definitions, e.g.
+   *   <tt>"DECAY"</tt> to rescale the branching ratios of all decays.
+   * \param column Index of the fields that are transformed.
+   * \param f Function or function object that takes and returns a
+   *   \c double.
+   * \param precision Number of digits after the decimal point of the
+   *   transformed numbers.
+   * \return The number of transformed fields.
+   * \sa Block::transform_column()
+   */
+  template<class Function> size_type
+  transform_column(const value_type::key_type& key, size_type column,
+                   Function f,
+                   int precision = std::numeric_limits<double>::digits10)
+  {
+    return transform_blocks(key_matches_block_def(key), column, f,
+                            precision);
+  }
+
+  /**
+   * \brief Comments all Blocks in the %Coll.
+   * \sa Block::comment()
+   */
+  void
+  comment()
+  {
+    index_.touch_all();
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::comment));
+  }
+
+  /**
+   * \brief Uncomments all Blocks in the %Coll.
+   * \sa Block::uncomment()
+   */
+  void
+  uncomment()
+  {
+    index_.touch_all();
+    std::for_each(impl_.begin(), impl_.end(),
+                  std::mem_fun_ref(&value_type::uncomment));
+  }
+
+  // transactions
+  /**
+   * \brief Sets a checkpoint to which the %Coll can be rolled back.
+   * \return Identifier of the checkpoint.
+   *
+   * After a checkpoint is set, the %Coll records how to undo every
+   * change that is made to it. Changes are recorded by the modifiers
+   * of the Lines, Blocks, and of the %Coll itself right before they
+   * are made: the first change of a Line stores a copy of this Line,
+   * and erased or replaced Lines and Blocks are copied as well.
+   * Element access and mutable iterators of the %Coll and its Blocks
+   * do not store anything. Hence, rolling back costs time and memory
+   * proportional to the size of the changed Lines and not to the size
+   * of the whole %Coll. Checkpoints can be nested.
+   *
+   * While a checkpoint is active, every Line knows the Block that
+   * contains it, so setting the outermost checkpoint and committing
+   * it take time proportional to the number of Lines in the %Coll
+   * unless the journal is enabled (see enable_journal()).
+   * Fields are plain strings, hence a change of a field is recorded
+   * when a mutable reference to it is obtained from its Line (e.g. by
+   * Line::operator[]() or Line::begin()). References to fields that
+   * were obtained before the checkpoint was set must not be used to
+   * modify the %Coll.
+   */
+  checkpoint_type
+  checkpoint()
+  {
+    checkpoints_.push_back(undo_log_.entries.size());
+    undo_log_.start(size());
+    if (checkpoints_.size() == 1) link_blocks();
+    return checkpoints_.size() - 1;
+  }
+
+  /**
+   * \brief Reverts all changes since a checkpoint.
+   * \param cp Identifier of the checkpoint.
+   * \throw std::out_of_range If \p cp is not an active checkpoint.
+   *
+   * This function restores the state of the %Coll at the time \p cp
+   * was set. All checkpoints that were set after \p cp are removed,
+   * while \p cp remains active so that the %Coll can be rolled back
+   * to it again.
+   */
+  void
+  rollback(checkpoint_type cp)
+  {
+    check_checkpoint(cp, "rollback");
+
+    {
+      detail::scoped_flag suspend(suspended_);
+      for (size_type pos = checkpoints_[cp];
+           undo_log_.entries.size() > pos;)
+      {
+        undo(undo_log_.entries.back());
+        undo_log_.entries.pop_back();
+      }
+    }
+
+    checkpoints_.resize(cp + 1);
+    undo_log_.start(size());
+    did_reset();
+  }
+
+  /**
+   * \brief Accepts all changes since a checkpoint.
+   * \param cp Identifier of the checkpoint.
+   * \throw std::out_of_range If \p cp is not an active checkpoint.
+   *
+   * This function removes \p cp and all checkpoints that were set
+   * after it. The changes since \p cp can still be reverted by
+   * rolling back to an enclosing checkpoint. If no checkpoint remains,
+   * the recorded changes are discarded.
+   */
+  void
+  commit(checkpoint_type cp)
+  {
+    check_checkpoint(cp, "commit");
+
+    checkpoints_.resize(cp);
+    if (!checkpoints_.empty()) return;
+
+    undo_log_.stop();
+    link_blocks();
+  }
+
+  // change journal
+  /**
+   * \brief Starts recording changes of the %Coll.
+   *
+   * While the journal is enabled, the %Coll records every change made
+   * to it, including changes of its Blocks, Lines, and fields, in the
+   * same way as checkpoint() does: the modifiers of the Lines, Blocks,
+   * and of the %Coll itself report each change right before it is
+   * made, no matter whether the Block or Line was reached through the
+   * %Coll or through a reference obtained earlier. Rolling back to a
+   * checkpoint is recorded as well. The recorded changes are turned
+   * into field-level Change objects by drain_changes(). If the journal
+   * is already enabled, this function does nothing.
+   *
+   * Enabling the journal while no checkpoint is active takes time
+   * proportional to the number of Lines in the %Coll. Fields are plain
+   * strings, hence changes through references to fields that were
+   * obtained from their Lines before the journal was enabled or last
+   * drained are not recorded.
+   */
+  void
+  enable_journal()
+  {
+    if (journal_.active) return;
+
+    journal_.start(size());
+    link_blocks();
+  }
+
+  /**
+   * \brief Stops recording changes of the %Coll.
+   *
+   * All changes that have not been drained yet are discarded.
+   */
+  void
+  disable_journal()
+  {
+    journal_.stop();
+    link_blocks();
+  }
+
+  /** Returns true if the journal of the %Coll is enabled. */
+  bool
+  journal_enabled() const
+  { return journal_.active; }
+
+  /**
+   * \brief Registers a function that is called for every Change.
+   * \param observer Function that is called with every Change that is
+   *   returned by drain_changes().
+   *
+   * Observers are not called when a change is made, but only when
+   * drain_changes() is called. They are not copied to copies of the
+   * %Coll.
+   */
+  void
+  add_observer(const observer_type& observer)
+  { observers_.push_back(observer); }
+
+  /** Removes all functions registered with add_observer(). */
+  void
+  clear_observers()
+  { observers_.clear(); }
+
+  /**
+   * \brief Returns and forgets all changes recorded by the journal.
+   * \return Field-level changes since the journal was enabled or
+   *   last drained.
+   *
+   * This function reconstructs the previous state of every Block that
+   * was changed since the journal was enabled or last drained by
+   * undoing the recorded changes on a copy of it. It then reports
+   * every field whose value differs, every field of inserted Lines and
+   * Blocks, and every field of erased Lines and Blocks. Changes that
+   * do not alter any field (e.g. reformatting) are not reported. All registered observers are called with every Change
+   * before the Changes are returned. Afterwards the journal starts
+   * recording anew.
+   */
+  std::vector<Change>
+  drain_changes()
+  {
+    std::vector<Change> changes;
+    if (!journal_.active) return changes;
+
+    bool replaced = false;
+    for (std::deque<log_entry>::const_iterator entry =
+           journal_.entries.begin(); entry != journal_.entries.end(); ++entry)
+    { replaced = replaced || entry->action == log_entry::blocks_replaced; }
+
+    if (replaced) diff_all(changes);
+    else diff_recorded(changes);
+    journal_.entries.clear();
+    journal_.start(size());
+
+    for (std::vector<observer_type>::const_iterator observer =
+           observers_.begin(); observer != observers_.end(); ++observer)
+    {
+      std::for_each(changes.begin(), changes.end(), *observer);
+    }
+    return changes;
+  }
+
+  /**
+   * Unary predicate that checks if a provided name matches the name
+   * of a Block.
+   */
+  struct key_matches : public std::unary_function<value_type, bool>
+  {
+    explicit
+    key_matches(const key_type& blockName) : name_(blockName) {}
+
+    bool
+    operator()(const value_type& block) const
+    { return name_(block.name()); }
+
+    void
+    set_key(const key_type& blockName)
+    { name_ = detail::key_pattern(blockName); }
+
+  private:
+    detail::key_pattern name_;
+  };
+
+  /**
+   * Unary predicate that checks if a provided key matches the block
+   * definition of a Block.
+   */
+  struct key_matches_block_def : public std::unary_function<value_type, bool>
+  {
+    explicit
+    key_matches_block_def(const value_type::key_type& key)
+      : key_matches_(key) {}
+
+    bool
+    operator()(const value_type& block) const
+    {
+      value_type::const_iterator block_def = block.find_block_def();
+      return (block_def == block.end()) ? false : key_matches_(*block_def);
+    }
+
+    void
+    set_key(const value_type::key_type& key)
+    { key_matches_.set_key(key); }
+
+  private:
+    value_type::key_matches key_matches_;
+  };
+
+private:
+  pointer
+  push_back_named_block(const key_type& blockName)
+  {
+    push_back(value_type(blockName));
+    return &back();
+  }
+
+  iterator
+  erase_if_empty(const key_type& blockName, const size_type& offset = 0)
+  {
+    iterator block = find(impl_.begin() + offset, impl_.end(), blockName);
+    return (block != impl_.end() && block->empty()) ? erase(block) : block;
+  }
+
+  // Returns the position of the first Block that matches blockName, or
+  // size() if there is no such Block.
+  size_type
+  find_position(const key_type& blockName) const
+  {
+    const key_matches pred(blockName);
+    std::vector<size_type> candidates;
+    switch (index_.lookup<index_traits>(impl_.begin(), impl_.end(),
+                                        blockName, candidates))
+    {
+    case detail::key_index::scan:
+      return std::find_if(impl_.begin(), impl_.end(), pred) - impl_.begin();
+    case detail::key_index::absent:
+      return size();
+    case detail::key_index::found:
+      break;
+    }
+
+    size_type position = size();
+    for (std::vector<size_type>::const_iterator i = candidates.begin();
+         i != candidates.end(); ++i)
+    { if (*i < position && pred(impl_[*i])) position = *i; }
+    return position;
+  }
+
+  struct index_traits
+  {
+    static const std::string*
+    key(const value_type& block)
+    { return &block.name(); }
+
+    static const std::string*
+    field(const value_type& block, size_type column)
+    {
+      value_type::const_iterator def = block.find_block_def();
+      return def != block.end() && column < def->size() ?
+        &(*def)[column] : 0;
+    }
+  };
+
+  iterator
+  touch(iterator block)
+  {
+    if (block != impl_.end()) will_modify(block - impl_.begin());
+    return block;
+  }
+
+  template<class Predicate, class Function> size_type
+  transform_blocks(const Predicate& pred, size_type column, Function f,
+                   int precision)
+  {
+    size_type transformed = 0;
+    for (size_type i = 0; i < size(); ++i)
+    {
+      if (!pred(impl_[i])) continue;
+      will_modify(i);
+      transformed += impl_[i].transform_column(column, f, precision);
+    }
+    return transformed;
+  }
+
+  void
+  will_modify(size_type index)
+  { index_.touch(index); }
+
+  void
+  did_insert(size_type index, size_type count = 1)
+  {
+    index_.did_insert(index, count);
+    if (index_.enabled()) freeze_blocks(index, count);
+    slots_.did_insert(index, count);
+    if (count == 0) return;
+
+    if (undo_log_.active) record_insert_blocks(undo_log_, index, count);
+    if (journal_.active) record_insert_blocks(journal_, index, count);
+    link_blocks(index + count == size() ? index : 0);
+  }
+
+  void
+  will_erase(size_type index, size_type count = 1)
+  {
+    index_.invalidate();
+    slots_.will_erase(index, count);
+    if (undo_log_.active) record_erase_blocks(undo_log_, index, count);
+    if (journal_.active) record_erase_blocks(journal_, index, count);
+  }
+
+  // Updates the positions of the Blocks after the Blocks in front of
+  // the end of the %Coll were shifted.
+  void
+  did_erase(size_type index)
+  { if (index < size()) link_blocks(); }
+
+  void
+  will_replace_all()
+  {
+    if (undo_log_.active) record_replace_blocks(undo_log_);
+    if (journal_.active) record_replace_blocks(journal_);
+  }
+
+  void
+  did_replace_all()
+  {
+    if (undo_log_.active) undo_log_.saved.assign(size(), saved_lines(true));
+    if (journal_.active) journal_.saved.assign(size(), saved_lines(true));
+    did_reset();
+  }
+
+  // Drops the key index after the Blocks were replaced or restored and
+  // links them again. The new Blocks of a frozen %Coll are frozen as
+  // well.
+  void
+  did_reset()
+  {
+    index_.invalidate();
+    if (index_.enabled()) freeze_blocks(0, size());
+    link_blocks();
+  }
+
+  void
+  freeze_blocks(size_type index, size_type count)
+  {
+    std::for_each(impl_.begin() + index, impl_.begin() + index + count,
+                  std::mem_fun_ref(&value_type::freeze));
+  }
+
+  // Recording of the changes for rollback() and drain_changes(). While
+  // a checkpoint is active or the journal is enabled, all Blocks are
+  // linked to the %Coll and report the changes of their Lines, which
+  // are recorded right before they are made. Blocks and Lines that the
+  // containers themselves move around do not report anything.
+
+  // Links the Blocks from position first on to the %Coll if changes
+  // are recorded and unlinks them otherwise. The Blocks of a %Coll are
+  // either all linked or all unlinked.
+  void
+  link_blocks(size_type first = 0)
+  {
+    Coll* const coll = undo_log_.active || journal_.active ? this : 0;
+    if (first >= size() || (!coll && !impl_[first].link_.coll)) return;
+
+    for (size_type i = first; i < size(); ++i) impl_[i].link(coll, i);
+  }
+
+  void
+  will_modify_line(size_type block, size_type line)
+  {
+    if (suspended_) return;
+    if (undo_log_.active) record_line(undo_log_, block, line);
+    if (journal_.active) record_line(journal_, block, line);
+  }
+
+  void
+  did_insert_lines(size_type block, size_type line, size_type count)
+  {
+    if (suspended_) return;
+    if (undo_log_.active) record_insert_lines(undo_log_, block, line, count);
+    if (journal_.active) record_insert_lines(journal_, block, line, count);
+  }
+
+  void
+  will_erase_lines(size_type block, size_type line, size_type count)
+  {
+    if (suspended_) return;
+    if (undo_log_.active) record_erase_lines(undo_log_, block, line, count);
+    if (journal_.active) record_erase_lines(journal_, block, line, count);
+  }
+
+  void
+  will_replace_lines(size_type block)
+  {
+    if (suspended_) return;
+    if (undo_log_.active) record_replace_lines(undo_log_, block);
+    if (journal_.active) record_replace_lines(journal_, block);
+  }
+
+  void
+  will_rename_block(size_type block)
+  {
+    if (suspended_) return;
+    if (undo_log_.active) record_rename(undo_log_, block);
+    if (journal_.active) record_rename(journal_, block);
+  }
+
+  void
+  record_line(undo_log& log, size_type block, size_type line)
+  {
+    saved_lines& saved = log.saved[block];
+    if (saved.all) return;
+    if (saved.lines.size() <= line) saved.lines.resize(line + 1);
+    if (saved.lines[line]) return;
+
+    saved.lines[line] = true;
+    log.entries.push_back(log_entry(log_entry::line_modified, block, line));
+    log.entries.back().line = impl_[block].impl_[line];
+  }
+
+  static void
+  record_insert_lines(undo_log& log, size_type block, size_type line,
+                      size_type count)
+  {
+    saved_lines& saved = log.saved[block];
+    if (saved.all) return;
+    if (saved.lines.size() < line) saved.lines.resize(line);
+    saved.lines.insert(saved.lines.begin() + line, count, true);
+    log.entries.push_back(
+      log_entry(log_entry::lines_inserted, block, line, count));
+  }
+
+  void
+  record_erase_lines(undo_log& log, size_type block, size_type line,
+                     size_type count)
+  {
+    saved_lines& saved = log.saved[block];
+    if (saved.all) return;
+    if (line < saved.lines.size())
+    {
+      saved.lines.erase(saved.lines.begin() + line, saved.lines.begin() +
+                        std::min(line + count, saved.lines.size()));
+    }
+    const Block::impl_type& lines = impl_[block].impl_;
+    log.entries.push_back(
+      log_entry(log_entry::lines_erased, block, line, count));
+    log.entries.back().lines.assign(lines.begin() + line,
+                                    lines.begin() + line + count);
+  }
+
+  void
+  record_replace_lines(undo_log& log, size_type block)
+  {
+    saved_lines& saved = log.saved[block];
+    if (saved.all) return;
+    saved.all = true;
+    saved.lines.clear();
+    log.entries.push_back(log_entry(log_entry::lines_replaced, block));
+    log.entries.back().name = impl_[block].name_;
+    log.entries.back().lines = impl_[block].impl_;
+  }
+
+  void
+  record_rename(undo_log& log, size_type block)
+  {
+    if (log.saved[block].all) return;
+    log.entries.push_back(log_entry(log_entry::block_renamed, block));
+    log.entries.back().name = impl_[block].name_;
+  }
+
+  static void
+  record_insert_blocks(undo_log& log, size_type index, size_type count)
+  {
+    log.saved.insert(log.saved.begin() + index, count, saved_lines(true));
+    log.entries.push_back(
+      log_entry(log_entry::blocks_inserted, index, 0, count));
+  }
+
+  void
+  record_erase_blocks(undo_log& log, size_type index, size_type count)
+  {
+    log.saved.erase(log.saved.begin() + index,
+                    log.saved.begin() + index + count);
+    for (size_type i = 0; i < count; ++i)
+    {
+      log.entries.push_back(log_entry(log_entry::block_erased, index));
+      log.entries.back().blocks.push_back(impl_[index + i]);
+    }
+  }
+
+  void
+  record_replace_blocks(undo_log& log)
+  {
+    log.entries.push_back(log_entry(log_entry::blocks_replaced));
+    log.entries.back().blocks.assign(impl_.begin(), impl_.end());
+  }
+
+  // Records in log the change that is made by undoing entry.
+  void
+  record_undo(undo_log& log, const log_entry& entry)
+  {
+    switch (entry.action)
+    {
+    case log_entry::line_modified:
+      record_line(log, entry.block, entry.index);
+      break;
+    case log_entry::lines_inserted:
+      record_erase_lines(log, entry.block, entry.index, entry.count);
+      break;
+    case log_entry::lines_erased:
+      record_insert_lines(log, entry.block, entry.index, entry.count);
+      break;
+    case log_entry::lines_replaced:
+      record_replace_lines(log, entry.block);
+      break;
+    case log_entry::block_renamed:
+      record_rename(log, entry.block);
+      break;
+    case log_entry::blocks_inserted:
+      record_erase_blocks(log, entry.block, entry.count);
+      break;
+    case log_entry::block_erased:
+      record_insert_blocks(log, entry.block, 1);
+      break;
+    case log_entry::blocks_replaced:
+      record_replace_blocks(log);
+      log.saved.assign(entry.blocks.size(), saved_lines(true));
+      break;
+    }
+  }
+
+  // Undoes a change for rollback(), which links the Blocks again and
+  // invalidates the key index afterwards.
+  void
+  undo(log_entry& entry)
+  {
+    if (journal_.active) record_undo(journal_, entry);
+
+    switch (entry.action)
+    {
+    case log_entry::blocks_inserted:
+      slots_.will_erase(entry.block, entry.count);
+      break;
+    case log_entry::block_erased:
+      slots_.did_insert(entry.block, 1);
+      break;
+    case log_entry::blocks_replaced:
+      slots_.reset();
+      break;
+    default:
+      break;
+    }
+    revert(impl_, entry);
+  }
+
+  // Undoes a change in impl. The recorded Lines and Blocks are moved
+  // out of entry.
+  static void
+  revert(impl_type& impl, log_entry& entry)
+  {
+    switch (entry.action)
+    {
+    case log_entry::blocks_inserted:
+      impl.erase(impl.begin() + entry.block,
+                 impl.begin() + entry.block + entry.count);
+      break;
+    case log_entry::block_erased:
+      impl.insert(impl.begin() + entry.block, value_type());
+      impl[entry.block].swap_content(entry.blocks.front());
+      break;
+    case log_entry::blocks_replaced:
+      impl.clear();
+      impl.resize(entry.blocks.size());
+      for (size_type i = 0; i < impl.size(); ++i)
+      { impl[i].swap_content(entry.blocks[i]); }
+      break;
+    default:
+      revert(impl[entry.block], entry);
+      break;
+    }
+  }
+
+  // Undoes a change of the name or the Lines of block.
+  static void
+  revert(Block& block, log_entry& entry)
+  {
+    Block::impl_type& lines = block.impl_;
+    switch (entry.action)
+    {
+    case log_entry::line_modified:
+      lines[entry.index].swap(entry.line);
+      break;
+    case log_entry::lines_inserted:
+      lines.erase(lines.begin() + entry.index,
+                  lines.begin() + entry.index + entry.count);
+      block.slots_.will_erase(entry.index, entry.count);
+      break;
+    case log_entry::lines_erased:
+      lines.insert(lines.begin() + entry.index, entry.lines.begin(),
+                   entry.lines.end());
+      block.slots_.did_insert(entry.index, entry.count);
+      block.link_lines();
+      break;
+    case log_entry::lines_replaced:
+      block.name_.swap(entry.name);
+      lines.swap(entry.lines);
+      block.slots_.reset();
+      block.link_lines();
+      break;
+    case log_entry::block_renamed:
+      block.name_.swap(entry.name);
+      break;
+    default:
+      break;
+    }
+    block.index_.invalidate();
+  }
+
+  // Changes of a Block that was neither inserted nor erased since the
+  // journal was last drained.
+  struct journal_record
+  {
+    journal_record() : inserted(false), entries() {}
+
+    bool inserted;
+    std::vector<log_entry*> entries;
+  };
+
+  void
+  diff_recorded(std::vector<Change>& changes)
+  {
+    // Follow every Block through the insertions and erasures of Blocks
+    // and collect the changes of its Lines. The previous state of a
+    // changed Block is reconstructed by undoing them on a copy.
+    size_type orig_size = size();
+    for (std::deque<log_entry>::const_iterator entry =
+           journal_.entries.begin(); entry != journal_.entries.end(); ++entry)
+    {
+      if (entry->action == log_entry::blocks_inserted)
+      { orig_size -= entry->count; }
+      else if (entry->action == log_entry::block_erased) ++orig_size;
+    }
+
+    std::deque<journal_record> records;
+    std::vector<journal_record*> record_of(orig_size);
+    std::deque<value_type> erased;
+
+    for (std::deque<log_entry>::iterator entry = journal_.entries.begin();
+         entry != journal_.entries.end(); ++entry)
+    {
+      journal_record* record = 0;
+      switch (entry->action)
+      {
+      case log_entry::blocks_inserted:
+        record_of.insert(record_of.begin() + entry->block, entry->count, 0);
+        for (size_type i = 0; i < entry->count; ++i)
+        {
+          records.push_back(journal_record());
+          records.back().inserted = true;
+          record_of[entry->block + i] = &records.back();
+        }
+        break;
+      case log_entry::block_erased:
+        record = record_of[entry->block];
+        record_of.erase(record_of.begin() + entry->block);
+        if (record && record->inserted) break;
+
+        erased.push_back(value_type());
+        erased.back().swap_content(entry->blocks.front());
+        if (record) revert_all(erased.back(), record->entries);
+        break;
+      default:
+        record = record_of[entry->block];
+        if (!record)
+        {
+          records.push_back(journal_record());
+          record = record_of[entry->block] = &records.back();
+        }
+        if (!record->inserted) record->entries.push_back(&*entry);
+        break;
+      }
+    }
+
+    for (std::deque<value_type>::const_iterator block = erased.begin();
+         block != erased.end(); ++block)
+    { diff_blocks(&*block, 0, changes); }
+
+    for (size_type i = 0; i < size(); ++i)
+    {
+      const journal_record* const record = record_of[i];
+      if (!record) continue;
+      if (record->inserted)
+      {
+        diff_blocks(0, &impl_[i], changes);
+        continue;
+      }
+
+      value_type old_block(impl_[i]);
+      revert_all(old_block, record->entries);
+      diff_blocks(&old_block, &impl_[i], changes);
+    }
+  }
+
+  static void
+  revert_all(Block& block, const std::vector<log_entry*>& entries)
+  {
+    for (std::vector<log_entry*>::const_reverse_iterator entry =
+           entries.rbegin(); entry != entries.rend(); ++entry)
+    { revert(block, **entry); }
+  }
+
+  void
+  diff_all(std::vector<Change>& changes)
+  {
+    // Reconstruct the previous state of the whole Coll and align its
+    // Blocks with the current Blocks by their names.
+    impl_type old_impl(impl_);
+    for (std::deque<log_entry>::reverse_iterator entry =
+           journal_.entries.rbegin(); entry != journal_.entries.rend(); ++entry)
+    { revert(old_impl, *entry); }
+
+    size_type i = 0;
+    for (const_iterator block = impl_.begin(); block != impl_.end(); ++block)
+    {
+      size_type k = i;
+      while (k < old_impl.size() && old_impl[k].name() != block->name()) ++k;
+      if (k == old_impl.size())
+      {
+        diff_blocks(0, &*block, changes);
+        continue;
+      }
+      for (; i < k; ++i) diff_blocks(&old_impl[i], 0, changes);
+      diff_blocks(&old_impl[i++], &*block, changes);
+    }
+    for (; i < old_impl.size(); ++i) diff_blocks(&old_impl[i], 0, changes);
+  }
+
+  static void
+  diff_blocks(const Block* old_block, const Block* new_block,
+              std::vector<Change>& changes)
+  {
+    const std::string& name = new_block ? new_block->name()
+                                        : old_block->name();
+    const std::size_t old_size = old_block ? old_block->size() : 0;
+    const std::size_t new_size = new_block ? new_block->size() : 0;
+
+    // Lines that are equal at the beginning and the end of both Blocks
+    // are skipped, the remaining Lines are compared pairwise.
+    std::size_t prefix = 0, suffix = 0;
+    while (prefix < old_size && prefix < new_size &&
+           same_fields(old_block->begin()[prefix], new_block->begin()[prefix]))
+    { ++prefix; }
+    while (suffix < old_size - prefix && suffix < new_size - prefix &&
+           same_fields(old_block->begin()[old_size - suffix - 1],
+                       new_block->begin()[new_size - suffix - 1]))
+    { ++suffix; }
+
+    std::size_t i = prefix;
+    for (; i < old_size - suffix && i < new_size - suffix; ++i)
+    {
+      diff_lines(Change::modified, name, i, &old_block->begin()[i],
+                 &new_block->begin()[i], changes);
+    }
+    for (std::size_t k = i; k < old_size - suffix; ++k)
+    {
+      diff_lines(Change::erased, name, k, &old_block->begin()[k], 0,
+                 changes);
+    }
+    for (std::size_t k = i; k < new_size - suffix; ++k)
+    {
+      diff_lines(Change::inserted, name, k, 0, &new_block->begin()[k],
+                 changes);
+    }
+  }
+
+  static bool
+  same_fields(const Line& lhs, const Line& rhs)
+  {
+    return lhs.size() == rhs.size() &&
+      std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+
+  static void
+  diff_lines(Change::kind_type kind, const std::string& block,
+             std::size_t index, const Line* old_line, const Line* new_line,
+             std::vector<Change>& changes)
+  {
+    static const std::string empty;
+    const std::size_t old_size = old_line ? old_line->size() : 0;
+    const std::size_t new_size = new_line ? new_line->size() : 0;
+
+    for (std::size_t i = 0; i < std::max(old_size, new_size); ++i)
+    {
+      const std::string& old_value = i < old_size ? (*old_line)[i] : empty;
+      const std::string& new_value = i < new_size ? (*new_line)[i] : empty;
+      if (old_value != new_value)
+      {
+        changes.push_back(Change(kind, block, index, i, old_value,
+                                 new_value));
+      }
+    }
+  }
+
+  void
+  check_checkpoint(checkpoint_type cp, const char* function) const
+  {
+    if (cp < checkpoints_.size()) return;
+    detail::throw_out_of_range(std::string("SLHAea::Coll::") + function +
+                            "(‘" + to_string(cp) + "’)");
+  }
+
+private:
+  impl_type impl_;
+  undo_log undo_log_;
+  std::vector<size_type> checkpoints_;
+  undo_log journal_;
+  std::vector<observer_type> observers_;
+  detail::key_index index_;
+  detail::slot_map slots_;
+  bool suspended_;
+
+  friend class Block;
+};
+
+inline void
+Line::will_change()
+{ if (owner_) owner_->log_modify(this - &owner_->impl_.front()); }
+
+inline void
+Block::log_modify(size_type position)
+{
+  if (link_.coll && !link_.suspended)
+  { link_.coll->will_modify_line(link_.index, position); }
+}
+
+inline void
+Block::log_insert(size_type position, size_type count)
+{ if (link_.coll) link_.coll->did_insert_lines(link_.index, position, count); }
+
+inline void
+Block::log_erase(size_type position, size_type count)
+{ if (link_.coll) link_.coll->will_erase_lines(link_.index, position, count); }
+
+inline void
+Block::log_replace()
+{ if (link_.coll) link_.coll->will_replace_lines(link_.index); }
+
+inline void
+Block::log_rename()
+{ if (link_.coll) link_.coll->will_rename_block(link_.index); }
+
+
+/**
+ * Reference to a single field in a SLHA structure.
+ * This data type represents a reference to a single field in a SLHA
+ * structure, but which is independent of any concrete Coll object.
+ * That means that only the keys and the index of the Coll, Block, and
+ * Line containers of the corresponding field are stored. One of the
+ * main purposes of this data type is the conversion to string and
+ * vice versa in a way that the string representation of a %Key can be
+ * used as a single field in a SLHA structure. For example, the string
+ * representation of a %Key that refers to the entry in the first row
+ * and third column of the RVHMIX matrix is \c "RVHMIX;1,3;2". Further
+ * examples are \c "1000022;DECAY;2" which refers to the total decay
+ * width of the lightest neutralino or \c "1000022;(any),2,11,24;0"
+ * which refers to the branching ratio of the decay of the lightest
+ * neutralino into an electron and a W boson.
+ */
+struct Key
+{
+public:
+  /** Name of the Block that contains the field. */
+  Coll::key_type block;
+
+  /** First field(s) of the Line that contains the field. */
+  Block::key_type line;
+
+  /** Index of the field in the Line. */
+  Line::size_type field;
+
+  /**
+   * \brief Constructs a %Key from explicit key values.
+   * \param _block Name of the Block that contains the field.
+   * \param _line First field(s) of the Line that contains the field.
+   * \param _field Index of the field in the Line.
+   */
+  Key(const Coll::key_type& _block,
+      const Block::key_type& _line,
+      const Line::size_type& _field)
+    : block(_block), line(_line), field(_field) {}
+
+  /**
+   * \brief Constructs a %Key from a string.
+   * \param keyString String from which the %Key is constructed.
+   * \sa str()
+   */
+  Key(const std::string& keyString)
+  { str(keyString); }
+
+  /**
+   * \brief Constructs a %Key from a string.
+   * \param keyString String from which the %Key is constructed.
+   * \sa str()
+   */
+  Key(const char* keyString)
+  { str(keyString); }
+
+  /**
+   * \brief Converts a string to a %Key.
+   * \param keyString String that represents a %Key.
+   * \return Reference to \c *this.
+   */
+  Key&
+  str(const std::string& keyString)
+  {
+    std::vector<std::string> keys;
+    boost::split(keys, keyString, boost::is_any_of(";"));
+
+    if (keys.size() != 3)
+    { detail::throw_invalid_argument("SLHAea::Key::str(‘" + keyString + "’)"); }
+
+    block = keys[0];
+    line.clear();
+    boost::split(line, keys[1], boost::is_any_of(","));
+    field = to<Line::size_type>(keys[2]);
+
+    return *this;
+  }
+
+  /**
+   * \brief Tries to convert a string to a %Key.
+   * \param keyString String that represents a %Key.
+   * \return \c true if \p keyString is a valid %Key, \c false
+   *   otherwise.
+   *
+   * Unlike str(const std::string&), this function does not throw. If
+   * \p keyString is not a valid %Key, \c *this is left unchanged.
+   */
+  bool
+  try_str(const std::string& keyString)
+  {
+    std::vector<std::string> keys;
+    boost::split(keys, keyString, boost::is_any_of(";"));
+
+    Line::size_type new_field;
+    if (keys.size() != 3 || !try_to(keys[2], new_field)) return false;
+
+    block = keys[0];
+    line.clear();
+    boost::split(line, keys[1], boost::is_any_of(","));
+    field = new_field;
+
+    return true;
+  }
+
+  /**
+   * \brief Converts a %Key into its string representation.
+   * \return String that represents the %Key.
+   */
+  std::string
+  str() const
+  {
+    std::ostringstream output;
+    output << block << ";" << boost::join(line, ",") << ";" << field;
+    return output.str();
+  }
+};
+
+
+namespace detail {
+
+struct string_ref_hash
+{
+  std::size_t
+  operator()(boost::string_ref str) const
+  { return boost::hash_range(str.begin(), str.end()); }
+};
+
+struct string_ref_equal
+{
+  bool
+  operator()(boost::string_ref lhs, boost::string_ref rhs) const
+  { return lhs == rhs; }
+};
+
+} // namespace detail
+
+
+/**
+ * Immutable handle to an interned Key.
+ * This class refers to a Key in a global, thread-safe table of Keys
+ * that maps strings to the Keys they represent. The first time a
+ * string is used to construct an %InternedKey, the string is converted
+ * to a Key which is then stored in the table. All later %InternedKeys
+ * constructed from the same string refer to this Key, so constructing
+ * them costs a single hash lookup and no allocations. This is useful
+ * for Keys whose strings are only known at runtime, for example from
+ * configuration files. Interned Keys are never removed from the table.
+ *
+ * An %InternedKey can be used wherever a Key is accepted.
+ */
+class InternedKey
+{
+public:
+  /**
+   * \brief Constructs an %InternedKey from a string.
+   * \param keyString String that represents a Key.
+   * \throw std::invalid_argument If \p keyString is not a valid Key.
+   * \sa Key::str()
+   */
+  InternedKey(const std::string& keyString)
+    : key_(&intern(keyString)) {}
+
+  /**
+   * \brief Constructs an %InternedKey from a string.
+   * \param keyString String that represents a Key.
+   * \throw std::invalid_argument If \p keyString is not a valid Key.
+   * \sa Key::str()
+   */
+  InternedKey(const char* keyString)
+    : key_(&intern(keyString)) {}
+
+  /** Returns the Key the %InternedKey refers to. */
+  const Key&
+  get() const
+  { return *key_; }
+
+  /** Returns the Key the %InternedKey refers to. */
+  operator const Key&() const
+  { return *key_; }
+
+  /** Returns the Key the %InternedKey refers to. */
+  const Key&
+  operator*() const
+  { return *key_; }
+
+  /** Returns a pointer to the Key the %InternedKey refers to. */
+  const Key*
+  operator->() const
+  { return key_; }
+
+  /**
+   * \brief Returns true if both %InternedKeys refer to the same Key.
+   *
+   * Two %InternedKeys refer to the same Key if and only if they were
+   * constructed from equal strings.
+   */
+  bool
+  operator==(const InternedKey& rhs) const
+  { return key_ == rhs.key_; }
+
+  /** Returns true if the %InternedKeys refer to different Keys. */
+  bool
+  operator!=(const InternedKey& rhs) const
+  { return key_ != rhs.key_; }
+
+private:
+  typedef boost::unordered_map<std::string, Key, detail::string_ref_hash,
+                               detail::string_ref_equal> table_type;
+
+  static const Key&
+  intern(boost::string_ref keyString)
+  {
+    static table_type table;
+    static detail::copyable_mutex mutex;
+    detail::scoped_lock lock(mutex);
+
+    table_type::const_iterator key = table.find(keyString,
+      detail::string_ref_hash(), detail::string_ref_equal());
+    if (key != table.end()) return key->second;
+
+    const std::string str(keyString.begin(), keyString.end());
+    return table.insert(std::make_pair(str, Key(str))).first->second;
+  }
+
+private:
+  const Key* key_;
+};
+
+
+/**
+ * Read-only view of a selection of the Lines of a Block.
+ *
+ * A %BlockView refers to a Block and holds the positions of the Lines
+ * it contains; it never copies Lines. The selection is given either
+ * by a predicate on Lines or by a list of positions and can be
+ * narrowed further with filter(). A %BlockView provides the const
+ * lookup and iteration interface of Block. Like iterators into the
+ * Block, it is invalidated by any modification of the Block that
+ * inserts or erases Lines.
+ */
+class BlockView
+{
+public:
+  typedef Block::value_type      value_type;
+  typedef Block::const_reference const_reference;
+  typedef Block::size_type       size_type;
+  typedef Block::key_type        key_type;
+  typedef std::vector<size_type> positions_type;
+  typedef boost::permutation_iterator<Block::const_iterator,
+    positions_type::const_iterator> const_iterator;
+
+  /** Constructs an empty %BlockView that refers to no Block. */
+  BlockView() : block_(0) {}
+
+  /**
+   * \brief Constructs a %BlockView of all Lines of a Block.
+   * \param block Block that is viewed.
+   */
+  explicit
+  BlockView(const Block& block) : block_(&block)
+  { for (size_type i = 0; i < block.size(); ++i) positions_.push_back(i); }
+
+  /**
+   * \brief Constructs a %BlockView of the Lines of a Block that
+   *   satisfy a predicate.
+   * \param block Block that is viewed.
+   * \param pred Unary predicate on Lines.
+   */
+  template<class Predicate>
+  BlockView(const Block& block, Predicate pred) : block_(&block)
+  {
+    for (size_type i = 0; i < block.size(); ++i)
+    { if (pred(block.begin()[i])) positions_.push_back(i); }
+  }
+
+  /**
+   * \brief Constructs a %BlockView of the Lines of a Block at given
+   *   positions.
+   * \param block Block that is viewed.
+   * \param positions Indices of the viewed Lines in \p block.
+   * \throw std::out_of_range If a position is out of range.
+   */
+  BlockView(const Block& block, const positions_type& positions)
+    : block_(&block), positions_(positions)
+  {
+    for (positions_type::const_iterator pos = positions_.begin();
+         pos != positions_.end(); ++pos)
+    {
+      if (*pos >= block.size())
+      {
+        detail::throw_out_of_range(
+          "SLHAea::BlockView::BlockView(" + to_string(*pos) + ")");
+      }
+    }
+  }
+
+  /**
+   * \brief Returns a %BlockView of the Lines of this %BlockView that
+   *   satisfy a predicate.
+   * \param pred Unary predicate on Lines.
+   */
+  template<class Predicate> BlockView
+  filter(Predicate pred) const
+  {
+    BlockView result;
+    result.block_ = block_;
+    for (const_iterator line = begin(); line != end(); ++line)
+    {
+      if (pred(*line))
+      { result.positions_.push_back(positions_[line - begin()]); }
+    }
+    return result;
+  }
+
+  /** Returns the name of the viewed Block. */
+  const std::string&
+  name() const
+  {
+    static const std::string empty;
+    return block_ ? block_->name() : empty;
+  }
+
+  /** Returns the viewed Block. */
+  const Block&
+  block() const
+  { return *block_; }
+
+  /** Returns the indices of the viewed Lines in the viewed Block. */
+  const positions_type&
+  positions() const
+  { return positions_; }
+
+  /**
+   * \brief Locates a Line in the %BlockView.
+   * \param key First strings of the Line to be located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   */
+  const_reference
+  at(const key_type& key) const
+  {
+    const_iterator line = find(key);
+    if (line != end()) return *line;
+
+    detail::throw_out_of_range(
+      "SLHAea::BlockView::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * \brief Locates a Line in the %BlockView.
+   * \param key Integers that are used to locate the Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   */
+  const_reference
+  at(const std::vector<int>& key) const
+  { return at(Block::cont_to_key(key)); }
+
+  /**
+   * \brief Locates a Line in the %BlockView.
+   * \param s0, s1, s2, s3, s4 First strings of the Line to be
+   *   located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided strings do not match any
+   *   Line.
+   */
+  const_reference
+  at(const std::string& s0,      const std::string& s1 = "",
+     const std::string& s2 = "", const std::string& s3 = "",
+     const std::string& s4 = "") const
+  { return at(Block::strings_to_key(s0, s1, s2, s3, s4)); }
+
+  /**
+   * \brief Locates a Line in the %BlockView.
+   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
+   *   Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided ints do not match any Line.
+   */
+  const_reference
+  at(int i0, int i1 = Block::no_index_, int i2 = Block::no_index_,
+             int i3 = Block::no_index_, int i4 = Block::no_index_) const
+  { return at(Block::ints_to_key(i0, i1, i2, i3, i4)); }
+
+  /**
+   * \brief Tries to locate a Line in the %BlockView.
+   * \param key First strings of the Line to be located.
+   * \return Read-only (constant) iterator to sought-after Line or
+   *   end() if there is none.
+   */
+  const_iterator
+  find(const key_type& key) const
+  { return std::find_if(begin(), end(), Block::key_matches(key)); }
+
+  /**
+   * \brief Counts all Lines that match a given key.
+   * \param key First strings of the Lines that will be counted.
+   */
+  size_type
+  count(const key_type& key) const
+  {
+    return static_cast<size_type>(
+      std::count_if(begin(), end(), Block::key_matches(key)));
+  }
+
+  /** Returns a read-only (constant) reference to the first Line. */
+  const_reference
+  front() const
+  { return *begin(); }
+
+  /** Returns a read-only (constant) reference to the last Line. */
+  const_reference
+  back() const
+  { return *(end() - 1); }
+
+  /** Returns a read-only (constant) iterator to the first Line. */
+  const_iterator
+  begin() const
+  {
+    return const_iterator(block_ ? block_->begin() : Block::const_iterator(),
+                          positions_.begin());
+  }
+
+  /** Returns a read-only (constant) iterator past the last Line. */
+  const_iterator
+  end() const
+  {
+    return const_iterator(block_ ? block_->begin() : Block::const_iterator(),
+                          positions_.end());
+  }
+
+  /** Returns the number of Lines in the %BlockView. */
+  size_type
+  size() const
+  { return positions_.size(); }
+
+  /** Returns true if the %BlockView contains no Lines. */
+  bool
+  empty() const
+  { return positions_.empty(); }
+
+  /** Returns a string representation of the viewed Lines. */
+  std::string
+  str() const
+  {
+    std::string result;
+    for (const_iterator line = begin(); line != end(); ++line)
+    {
+      result += line->str();
+      result += '\n';
+    }
+    return result;
+  }
+
+private:
+  const Block* block_;
+  positions_type positions_;
+};
+
+
+/**
+ * Read-only view of a selection of the Blocks of a Coll.
+ *
+ * A %CollView refers to a Coll and holds the positions of the Blocks
+ * it contains; it never copies Blocks. The selection is given either
+ * by a predicate on Blocks or by a list of positions and can be
+ * narrowed further with filter(). A %CollView provides the const
+ * lookup and iteration interface of Coll, and view() returns a
+ * BlockView of a viewed Block. It is invalidated by any modification
+ * of the Coll that inserts or erases Blocks.
+ */
+class CollView
+{
+public:
+  typedef Coll::value_type       value_type;
+  typedef Coll::const_reference  const_reference;
+  typedef Coll::size_type        size_type;
+  typedef Coll::key_type         key_type;
+  typedef std::vector<size_type> positions_type;
+  typedef boost::permutation_iterator<Coll::const_iterator,
+    positions_type::const_iterator> const_iterator;
+
+  /** Constructs an empty %CollView that refers to no Coll. */
+  CollView() : coll_(0) {}
+
+  /**
+   * \brief Constructs a %CollView of all Blocks of a Coll.
+   * \param coll Coll that is viewed.
+   */
+  explicit
+  CollView(const Coll& coll) : coll_(&coll)
+  { for (size_type i = 0; i < coll.size(); ++i) positions_.push_back(i); }
+
+  /**
+   * \brief Constructs a %CollView of the Blocks of a Coll that
+   *   satisfy a predicate.
+   * \param coll Coll that is viewed.
+   * \param pred Unary predicate on Blocks.
+   */
+  template<class Predicate>
+  CollView(const Coll& coll, Predicate pred) : coll_(&coll)
+  {
+    for (size_type i = 0; i < coll.size(); ++i)
+    { if (pred(coll.begin()[i])) positions_.push_back(i); }
+  }
+
+  /**
+   * \brief Constructs a %CollView of the Blocks of a Coll at given
+   *   positions.
+   * \param coll Coll that is viewed.
+   * \param positions Indices of the viewed Blocks in \p coll.
+   * \throw std::out_of_range If a position is out of range.
+   */
+  CollView(const Coll& coll, const positions_type& positions)
+    : coll_(&coll), positions_(positions)
+  {
+    for (positions_type::const_iterator pos = positions_.begin();
+         pos != positions_.end(); ++pos)
+    {
+      if (*pos >= coll.size())
+      {
+        detail::throw_out_of_range(
+          "SLHAea::CollView::CollView(" + to_string(*pos) + ")");
+      }
+    }
+  }
+
+  /**
+   * \brief Returns a %CollView of the Blocks of this %CollView that
+   *   satisfy a predicate.
+   * \param pred Unary predicate on Blocks.
+   */
+  template<class Predicate> CollView
+  filter(Predicate pred) const
+  {
+    CollView result;
+    result.coll_ = coll_;
+    for (const_iterator block = begin(); block != end(); ++block)
+    {
+      if (pred(*block))
+      { result.positions_.push_back(positions_[block - begin()]); }
+    }
+    return result;
+  }
+
+  /**
+   * \brief Returns a BlockView of the Lines of a viewed Block that
+   *   satisfy a predicate.
+   * \param blockName Name of the Block.
+   * \param pred Unary predicate on Lines.
+   * \throw std::out_of_range If no viewed Block has the name
+   *   \p blockName.
+   */
+  template<class Predicate> BlockView
+  view(const key_type& blockName, Predicate pred) const
+  { return BlockView(at(blockName), pred); }
+
+  /** Returns the viewed Coll. */
+  const Coll&
+  coll() const
+  { return *coll_; }
+
+  /** Returns the indices of the viewed Blocks in the viewed Coll. */
+  const positions_type&
+  positions() const
+  { return positions_; }
+
+  /**
+   * \brief Locates a Block in the %CollView.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) reference to sought-after Block.
+   * \throw std::out_of_range If \p blockName does not match any Block.
+   */
+  const_reference
+  at(const key_type& blockName) const
+  {
+    const_iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    detail::throw_out_of_range("SLHAea::CollView::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Accesses a single Block in the %CollView.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Read-only (constant) reference to the Block referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Block.
+   */
+  const_reference
+  block(const Key& key) const
+  { return at(key.block); }
+
+  /**
+   * \brief Accesses a single Line in the %CollView.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Read-only (constant) reference to the Line referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  Block::const_reference
+  line(const Key& key) const
+  { return block(key).at(key.line); }
+
+  /**
+   * \brief Accesses a single field in the %CollView.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read-only (constant) reference to the field referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing field.
+   */
+  Line::const_reference
+  field(const Key& key) const
+  { return line(key).at(key.field); }
+
+  /**
+   * \brief Tries to locate a Block in the %CollView.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) iterator to sought-after Block or
+   *   end() if there is none.
+   */
+  const_iterator
+  find(const key_type& blockName) const
+  { return std::find_if(begin(), end(), Coll::key_matches(blockName)); }
+
+  /**
+   * \brief Counts all Blocks with a given name.
+   * \param blockName Name of the Blocks that will be counted.
+   */
+  size_type
+  count(const key_type& blockName) const
+  {
+    return static_cast<size_type>(
+      std::count_if(begin(), end(), Coll::key_matches(blockName)));
+  }
+
+  /** Returns a read-only (constant) reference to the first Block. */
+  const_reference
+  front() const
+  { return *begin(); }
+
+  /** Returns a read-only (constant) reference to the last Block. */
+  const_reference
+  back() const
+  { return *(end() - 1); }
+
+  /** Returns a read-only (constant) iterator to the first Block. */
+  const_iterator
+  begin() const
+  {
+    return const_iterator(coll_ ? coll_->begin() : Coll::const_iterator(),
+                          positions_.begin());
+  }
+
+  /** Returns a read-only (constant) iterator past the last Block. */
+  const_iterator
+  end() const
+  {
+    return const_iterator(coll_ ? coll_->begin() : Coll::const_iterator(),
+                          positions_.end());
+  }
+
+  /** Returns the number of Blocks in the %CollView. */
+  size_type
+  size() const
+  { return positions_.size(); }
+
+  /** Returns true if the %CollView contains no Blocks. */
+  bool
+  empty() const
+  { return positions_.empty(); }
+
+  /** Returns a string representation of the viewed Blocks. */
+  std::string
+  str() const
+  {
+    std::string result;
+    for (const_iterator block = begin(); block != end(); ++block)
+    { result += block->str(); }
+    return result;
+  }
+
+private:
+  const Coll* coll_;
+  positions_type positions_;
+};
+
+
+inline BlockView
+Block::range(size_type column, long lo, long hi) const
+{
+  return BlockView(*this, index_.range<index_traits>(
+                            impl_.begin(), impl_.end(), column, lo, hi));
+}
+
+inline CollView
+Coll::range(size_type column, long lo, long hi) const
+{
+  return CollView(*this, index_.range<index_traits>(
+                           impl_.begin(), impl_.end(), column, lo, hi));
+}
+
+inline BlockView
+Coll::range(const key_type& blockName, size_type column, long lo,
+            long hi) const
+{ return at(blockName).range(column, lo, hi); }
+
+inline Coll::reference
+Coll::block(const Key& key)
+{ return at(key.block); }
+
+inline Coll::const_reference
+Coll::block(const Key& key) const
+{ return at(key.block); }
+
+inline Block::reference
+Coll::line(const Key& key)
+{ return block(key).at(key.line); }
+
+inline Block::const_reference
+Coll::line(const Key& key) const
+{ return block(key).at(key.line); }
+
+inline Line::reference
+Coll::field(const Key& key)
+{ return line(key).at(key.field); }
+
+inline Line::const_reference
+Coll::field(const Key& key) const
+{ return line(key).at(key.field); }
+
+inline Coll::reference
+Coll::block(const std::string& key)
+{ return block(InternedKey(key).get()); }
+
+inline Coll::const_reference
+Coll::block(const std::string& key) const
+{ return block(InternedKey(key).get()); }
+
+inline Coll::reference
+Coll::block(const char* key)
+{ return block(InternedKey(key).get()); }
+
+inline Coll::const_reference
+Coll::block(const char* key) const
+{ return block(InternedKey(key).get()); }
+
+inline Block::reference
+Coll::line(const std::string& key)
+{ return line(InternedKey(key).get()); }
+
+inline Block::const_reference
+Coll::line(const std::string& key) const
+{ return line(InternedKey(key).get()); }
+
+inline Block::reference
+Coll::line(const char* key)
+{ return line(InternedKey(key).get()); }
+
+inline Block::const_reference
+Coll::line(const char* key) const
+{ return line(InternedKey(key).get()); }
+
+inline Line::reference
+Coll::field(const std::string& key)
+{ return field(InternedKey(key).get()); }
+
+inline Line::const_reference
+Coll::field(const std::string& key) const
+{ return field(InternedKey(key).get()); }
+
+inline Line::reference
+Coll::field(const char* key)
+{ return field(InternedKey(key).get()); }
+
+inline Line::const_reference
+Coll::field(const char* key) const
+{ return field(InternedKey(key).get()); }
+
+inline Coll::pointer
+Coll::try_block(const Key& key)
+{
+  iterator block = find(key.block);
+  return block != impl_.end() ? &*block : 0;
+}
+
+inline Coll::const_pointer
+Coll::try_block(const Key& key) const
+{
+  const_iterator block = find(key.block);
+  return block != end() ? &*block : 0;
+}
+
+inline Block::pointer
+Coll::try_line(const Key& key)
+{
+  pointer block = try_block(key);
+  if (!block) return 0;
+  Block::iterator line = block->find(key.line);
+  return line != block->impl_.end() ? &*line : 0;
+}
+
+inline Block::const_pointer
+Coll::try_line(const Key& key) const
+{
+  const_pointer block = try_block(key);
+  if (!block) return 0;
+  Block::const_iterator line = block->find(key.line);
+  return line != block->end() ? &*line : 0;
+}
+
+inline Line::pointer
+Coll::try_field(const Key& key)
+{
+  Block::pointer line = try_line(key);
+  return line && key.field < line->size() ? &(*line)[key.field] : 0;
+}
+
+inline Line::const_pointer
+Coll::try_field(const Key& key) const
+{
+  Block::const_pointer line = try_line(key);
+  return line && key.field < line->size() ? &(*line)[key.field] : 0;
+}
+
+inline std::streamsize
+Coll::read_until(std::istream& is, const std::vector<Key>& required)
+{
+  std::vector<const Key*> missing, in_block;
+  for (std::vector<Key>::const_iterator key = required.begin();
+       key != required.end(); ++key)
+  { missing.push_back(&*key); }
+
+  std::streamsize count = 0;
+  std::string line_str;
+  Line line;
+
+  const size_type orig_size = size();
+  pointer block = push_back_named_block("");
+
+  for (std::vector<const Key*>::const_iterator key = missing.begin();
+       key != missing.end(); ++key)
+  { if ((*key)->block.empty()) in_block.push_back(*key); }
+
+  while (!missing.empty() && std::getline(is, line_str))
+  {
+    count += static_cast<std::streamsize>(line_str.size()) + !is.eof();
+    if (detail::is_all_whitespace(line_str)) continue;
+
+    line.str(line_str);
+    if (line.is_block_def())
+    {
+      block = push_back_named_block(line[1]);
+      in_block.clear();
+      for (std::vector<const Key*>::const_iterator key = missing.begin();
+           key != missing.end(); ++key)
+      {
+        if (boost::iequals((*key)->block, line[1]))
+        { in_block.push_back(*key); }
+      }
+    }
+    else if (line.empty()) continue;
+    block->push_back(line);
+
+    for (std::size_t i = 0; i < in_block.size();)
+    {
+      const Block::key_type& key = in_block[i]->line;
+      const bool block_only =
+        key.empty() || (key.size() == 1 && key[0].empty());
+
+      if (block_only || Block::key_matches(key)(line))
+      {
+        missing.erase(std::find(missing.begin(), missing.end(),
+                                in_block[i]));
+        in_block.erase(in_block.begin() + i);
+      }
+      else ++i;
+    }
+  }
+
+  erase_if_empty("", orig_size);
+  return count;
+}
+
+inline std::istream&
+operator>>(std::istream& is, Block& block)
+{
+  block.read(is);
+  return is;
+}
+
+inline std::istream&
+operator>>(std::istream& is, Coll& coll)
+{
+  coll.read(is);
+  return is;
+}
+
+inline std::ostream&
+operator<<(std::ostream& os, const Line& line)
+{ return os << line.str(); }
+
+inline std::ostream&
+operator<<(std::ostream& os, const Block& block)
+{
+  std::copy(block.begin(), block.end(),
+            std::ostream_iterator<Block::value_type>(os, "\n"));
+  return os;
+}
+
+inline std::ostream&
+operator<<(std::ostream& os, const Coll& coll)
+{
+  std::copy(coll.begin(), coll.end(),
+            std::ostream_iterator<Coll::value_type>(os));
+  return os;
+}
+
+inline std::ostream&
+operator<<(std::ostream& os, const Key& key)
+{ return os << key.str(); }
+
+
+// relational operators for Line
+inline bool
+operator==(const Line& a, const Line& b)
+{
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin())
+    && a.str() == b.str();
+}
+
+inline bool
+operator<(const Line& a, const Line& b)
+{
+  const bool a_is_block_def = a.is_block_def();
+
+  return (a_is_block_def != b.is_block_def()) ? a_is_block_def :
+    std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+inline bool
+operator!=(const Line& a, const Line& b)
+{ return !(a == b); }
+
+inline bool
+operator>(const Line& a, const Line& b)
+{ return b < a; }
+
+inline bool
+operator<=(const Line& a, const Line& b)
+{ return !(b < a); }
+
+inline bool
+operator>=(const Line& a, const Line& b)
+{ return !(a < b); }
+
+
+// relational operators for Block
+inline bool
+operator==(const Block& a, const Block& b)
+{
+  return a.size() == b.size() && a.name() == b.name()
+    && std::equal(a.begin(), a.end(), b.begin());
+}
+
+inline bool
+operator<(const Block& a, const Block& b)
+{
+  return (a.name() != b.name()) ? a.name() < b.name() :
+    std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+inline bool
+operator!=(const Block& a, const Block& b)
+{ return !(a == b); }
 
-  /**
-   * Returns a read-only (constant) reference to the last element of
-   * the %Coll.
-   */
-  const_reference
-  back() const
-  { return impl_.back(); }
+inline bool
+operator>(const Block& a, const Block& b)
+{ return b < a; }
 
-  // (nested) element access via Key
-  /**
-   * \brief Accesses a Block in the %Coll.
-   * \param key Key that refers to the Block that should be accessed.
-   * \return Read/write reference to the Block referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   Block.
-   */
-  reference
-  block(const Key& key);
+inline bool
+operator<=(const Block& a, const Block& b)
+{ return !(b < a); }
 
-  /**
-   * \brief Accesses a Block in the %Coll.
-   * \param key Key that refers to the Block that should be accessed.
-   * \return Read-only (constant) reference to the Block referred to
-   *   by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   Block.
-   */
-  const_reference
-  block(const Key& key) const;
+inline bool
+operator>=(const Block& a, const Block& b)
+{ return !(a < b); }
 
-  /**
-   * \brief Accesses a single Line in the %Coll.
-   * \param key Key that refers to the Line that should be accessed.
-   * \return Read/write reference to the Line referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing Line.
-   */
-  Block::reference
-  line(const Key& key);
 
-  /**
-   * \brief Accesses a single Line in the %Coll.
-   * \param key Key that refers to the Line that should be accessed.
-   * \return Read-only (constant) reference to the Line referred to by
-   *   \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing Line.
-   */
-  Block::const_reference
-  line(const Key& key) const;
+// relational operators for Coll
+inline bool
+operator==(const Coll& a, const Coll& b)
+{ return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin()); }
 
-  /**
-   * \brief Accesses a single field in the %Coll.
-   * \param key Key that refers to the field that should be accessed.
-   * \return Read/write reference to the field referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   field.
-   */
-  Line::reference
-  field(const Key& key);
+inline bool
+operator<(const Coll& a, const Coll& b)
+{
+  return std::lexicographical_compare(a.begin(), a.end(),
+                                      b.begin(), b.end());
+}
 
-  /**
-   * \brief Accesses a single field in the %Coll.
-   * \param key Key that refers to the field that should be accessed.
-   * \return Read-only (constant) reference to the field referred to
-   *   by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   field.
-   */
-  Line::const_reference
-  field(const Key& key) const;
+inline bool
+operator!=(const Coll& a, const Coll& b)
+{ return !(a == b); }
 
-  // iterators
-  /**
-   * Returns a read/write iterator that points to the first element in
-   * the %Coll. Iteration is done in ordinary element order.
-   */
-  iterator
-  begin()
-  { return impl_.begin(); }
+inline bool
+operator>(const Coll& a, const Coll& b)
+{ return b < a; }
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Coll. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  begin() const
-  { return impl_.begin(); }
+inline bool
+operator<=(const Coll& a, const Coll& b)
+{ return !(b < a); }
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Coll. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cbegin() const
-  { return impl_.begin(); }
+inline bool
+operator>=(const Coll& a, const Coll& b)
+{ return !(a < b); }
 
+/**
+ * Streaming writer for SLHA structures.
+ * This class writes blocks, lines, and comments directly to an output
+ * stream or string without the need to build a Coll of Blocks of
+ * Lines first. The fields are laid out exactly as Line::reformat()
+ * lays them out, so that the output of a %Writer is identical to the
+ * output of a Coll whose Lines were filled with Line::operator<<().
+ * Numbers are formatted into a fixed-size buffer on the stack, so
+ * writing a field does not create a temporary string.
+ *
+ * A %Writer always has at most one open line. A line is started by
+ * begin_block(), decay(), line(), and channel() (which terminate the
+ * previously open line) and it is terminated by end_line() or the
+ * destructor. Additional fields can be appended to the open line with
+ * operator<<() and comment(). If no line is open, operator<<() and
+ * comment() start a new one.
+ */
+class Writer
+{
+public:
   /**
-   * Returns a read/write iterator that points one past the last
-   * element in the %Coll. Iteration is done in ordinary element
-   * order.
+   * \brief Constructs a %Writer that writes to an output stream.
+   * \param os Output stream the %Writer writes to.
    */
-  iterator
-  end()
-  { return impl_.end(); }
+  explicit
+  Writer(std::ostream& os)
+    : os_(&os), buffer_(0), pos_(0), fields_(0), block_def_(false),
+      has_comment_(false) {}
 
   /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Coll. Iteration is done in ordinary element
-   * order.
+   * \brief Constructs a %Writer that appends to a string.
+   * \param buffer String the %Writer appends to.
    */
-  const_iterator
-  end() const
-  { return impl_.end(); }
+  explicit
+  Writer(std::string& buffer)
+    : os_(0), buffer_(&buffer), pos_(0), fields_(0), block_def_(false),
+      has_comment_(false) {}
 
-  /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Coll. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cend() const
-  { return impl_.end(); }
+  /** Terminates the open line. */
+  ~Writer()
+  { end_line(); }
 
   /**
-   * Returns a read/write reverse iterator that points to the last
-   * element in the %Coll. Iteration is done in reverse element order.
+   * \brief Starts a block definition.
+   * \param name Name of the block.
+   * \return Reference to \c *this.
    */
-  reverse_iterator
-  rbegin()
-  { return impl_.rbegin(); }
+  Writer&
+  begin_block(const std::string& name)
+  {
+    end_line();
+    put("BLOCK");
+    put(name);
+    return *this;
+  }
 
   /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Coll. Iteration is done in reverse
-   * element order.
+   * \brief Starts a block definition with a scale.
+   * \param name Name of the block.
+   * \param q Scale at which the data in the block is given.
+   * \return Reference to \c *this.
+   *
+   * The written block definition has the form
+   * <tt>"BLOCK name Q= q"</tt>.
    */
-  const_reverse_iterator
-  rbegin() const
-  { return impl_.rbegin(); }
+  template<class T> Writer&
+  begin_block(const std::string& name, const T& q)
+  {
+    begin_block(name);
+    put("Q=");
+    put(q);
+    return *this;
+  }
 
   /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Coll. Iteration is done in reverse
-   * element order.
+   * \brief Starts a decay block definition.
+   * \param pdg PDG code of the decaying particle.
+   * \param width Total width of the decaying particle.
+   * \return Reference to \c *this.
    */
-  const_reverse_iterator
-  crbegin() const
-  { return impl_.rbegin(); }
+  template<class T0, class T1> Writer&
+  decay(const T0& pdg, const T1& width)
+  {
+    end_line();
+    put("DECAY");
+    put(pdg);
+    put(width);
+    return *this;
+  }
 
   /**
-   * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Coll. Iteration is done in reverse
-   * element order.
+   * \brief Starts a line.
+   * \param f0, f1, f2, f3, f4 Fields of the line.
+   * \return Reference to \c *this.
+   *
+   * This function takes up to five fields. Lines with more fields
+   * can be written by appending the remaining ones with operator<<().
    */
-  reverse_iterator
-  rend()
-  { return impl_.rend(); }
+  template<class T0> Writer&
+  line(const T0& f0)
+  {
+    end_line();
+    put(f0);
+    return *this;
+  }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Coll. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  rend() const
-  { return impl_.rend(); }
+  /** \copydoc line(const T0&) */
+  template<class T0, class T1> Writer&
+  line(const T0& f0, const T1& f1)
+  {
+    line(f0);
+    put(f1);
+    return *this;
+  }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Coll. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  crend() const
-  { return impl_.rend(); }
+  /** \copydoc line(const T0&) */
+  template<class T0, class T1, class T2> Writer&
+  line(const T0& f0, const T1& f1, const T2& f2)
+  {
+    line(f0, f1);
+    put(f2);
+    return *this;
+  }
 
-  // lookup
-  /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read/write iterator pointing to sought-after element, or
-   *   end() if not found.
-   *
-   * This function takes a key and tries to locate the Block whose
-   * name matches \p blockName. If successful the function returns a
-   * read/write iterator pointing to the sought after Block. If
-   * unsuccessful it returns end().
-   */
-  iterator
-  find(const key_type& blockName)
-  { return std::find_if(begin(), end(), key_matches(blockName)); }
+  /** \copydoc line(const T0&) */
+  template<class T0, class T1, class T2, class T3> Writer&
+  line(const T0& f0, const T1& f1, const T2& f2, const T3& f3)
+  {
+    line(f0, f1, f2);
+    put(f3);
+    return *this;
+  }
 
-  /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read-only (constant) iterator pointing to sought-after
-   *   element, or end() const if not found.
-   *
-   * This function takes a key and tries to locate the Block whose
-   * name matches \p blockName. If successful the function returns a
-   * read-only (constant) iterator pointing to the sought after Block.
-   * If unsuccessful it returns end() const.
-   */
-  const_iterator
-  find(const key_type& blockName) const
-  { return std::find_if(begin(), end(), key_matches(blockName)); }
+  /** \copydoc line(const T0&) */
+  template<class T0, class T1, class T2, class T3, class T4> Writer&
+  line(const T0& f0, const T1& f1, const T2& f2, const T3& f3,
+       const T4& f4)
+  {
+    line(f0, f1, f2, f3);
+    put(f4);
+    return *this;
+  }
 
   /**
-   * \brief Tries to locate a Block in a range.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   * \param blockName Name of the Block to be located.
-   * \return Iterator pointing to sought-after element, or \p last if
-   *   not found.
+   * \brief Starts a decay channel line.
+   * \param br Branching ratio of the decay channel.
+   * \param d0, d1, d2, d3 PDG codes of the daughter particles.
+   * \return Reference to \c *this.
    *
-   * This function tries to locate in the range [\p first, \p last)
-   * the Block whose name matches \p blockName. If successful the
-   * function returns an iterator pointing to the sought after Block.
-   * If unsuccessful it returns \p last.
-   */
-  template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last, const key_type& blockName)
-  { return std::find_if(first, last, key_matches(blockName)); }
+   * The number of daughters is written between \p br and the
+   * daughters' PDG codes, as required for lines in DECAY blocks.
+   */
+  template<class T, class D0, class D1> Writer&
+  channel(const T& br, const D0& d0, const D1& d1)
+  { return line(br, 2, d0, d1); }
+
+  /** \copydoc channel(const T&, const D0&, const D1&) */
+  template<class T, class D0, class D1, class D2> Writer&
+  channel(const T& br, const D0& d0, const D1& d1, const D2& d2)
+  { return line(br, 3, d0, d1, d2); }
+
+  /** \copydoc channel(const T&, const D0&, const D1&) */
+  template<class T, class D0, class D1, class D2, class D3> Writer&
+  channel(const T& br, const D0& d0, const D1& d1, const D2& d2,
+          const D3& d3)
+  {
+    line(br, 4, d0, d1, d2);
+    put(d3);
+    return *this;
+  }
 
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read/write iterator pointing to sought-after element, or
-   *   end() if not found.
+   * \brief Appends a comment to the open line.
+   * \param text Text of the comment.
+   * \return Reference to \c *this.
    *
-   * This functions takes a vector of strings and tries to locate the
-   * Block whose first strings of the block definition are equal to
-   * the strings in \p key. If successful the function returns a
-   * read/write iterator pointing to the sought after Block. If
-   * unsuccessful it returns end().
+   * If \p text does not begin with \c "#", it is prefixed with
+   * <tt>"# "</tt>. If no line is open, a comment line is started.
    */
-  iterator
-  find(const value_type::key_type& key)
-  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+  Writer&
+  comment(const std::string& text)
+  {
+    if (!text.empty() && text[0] == '#') put(text);
+    else put("# " + text);
+    return *this;
+  }
 
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read-only (constant) iterator pointing to sought-after
-   *   element, or end() const if not found.
+   * \brief Appends a field to the open line.
+   * \param field Field that is appended to the open line.
+   * \return Reference to \c *this.
    *
-   * This functions takes a vector of strings and tries to locate the
-   * Block whose first strings of the block definition are equal to
-   * the strings in \p key. If successful the function returns a
-   * read-only (constant) iterator pointing to the sought after Block.
-   * If unsuccessful it returns end() const.
+   * This function behaves like Line::operator<<(): floating-point
+   * numbers are written in scientific notation with their full
+   * precision and if the open line contains a comment, \p field is
+   * appended to it.
    */
-  const_iterator
-  find(const value_type::key_type& key) const
-  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+  template<class T> Writer&
+  operator<<(const T& field)
+  {
+    put(field);
+    return *this;
+  }
 
   /**
-   * \brief Tries to locate a Block in a range.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Iterator pointing to sought-after element, or \p last if
-   *   not found.
-   *
-   * This function tries to locate in the range [\p first, \p last)
-   * the Block whose first strings of the block definition are equal
-   * to the strings in \p key. If successful the function returns an
-   * iterator pointing to the sought after Block. If unsuccessful it
-   * returns \p last.
+   * \brief Terminates the open line.
+   * \return Reference to \c *this.
    */
-  template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last,
-       const value_type::key_type& key)
-  { return std::find_if(first, last, key_matches_block_def(key)); }
+  Writer&
+  end_line()
+  {
+    if (fields_ == 0) return *this;
 
-  // introspection
-  /**
-   * \brief Counts all Blocks with a given name.
-   * \param blockName Name of the Blocks that will be counted.
-   * \return Number of blocks whose name equals \p blockName.
-   */
-  size_type
-  count(const key_type& blockName) const
-  { return std::count_if(begin(), end(), key_matches(blockName)); }
+    write("\n", 1);
+    pos_ = 0;
+    fields_ = 0;
+    block_def_ = false;
+    has_comment_ = false;
+    return *this;
+  }
 
-  // capacity
-  /** Returns the number of elements in the %Coll. */
-  size_type
-  size() const
-  { return impl_.size(); }
+private:
+  // NOTE: A %Writer refers to a stream or string that it does not
+  //   own, so it must not be copied.
+  Writer(const Writer&);
+  Writer& operator=(const Writer&);
 
-  /** Returns the size() of the largest possible %Coll. */
-  size_type
-  max_size() const
-  { return impl_.max_size(); }
+  void
+  put(const std::string& field)
+  { put_field(field.data(), field.length()); }
 
-  /** Returns true if the %Coll is empty. */
-  bool
-  empty() const
-  { return impl_.empty(); }
+  void
+  put(const char* field)
+  { put_field(field, std::strlen(field)); }
 
-  // modifiers
-  /**
-   * \brief Adds a Block to the end of the %Coll.
-   * \param block Block to be added.
-   *
-   * This function creates an element at the end of the %Coll and
-   * assigns the given \p block to it.
-   */
   void
-  push_back(const value_type& block)
-  { impl_.push_back(block); }
+  put(int number)
+  { put_integer("%d", number); }
 
-  /**
-   * \brief Adds a Block to the end of the %Coll.
-   * \param blockString String that is used to construct the Block
-   *   that will be added.
-   *
-   * This function creates an element at the end of the %Coll and
-   * assigns the Block that is constructed from \p blockString to it.
-   */
   void
-  push_back(const std::string& blockString)
+  put(long number)
+  { put_integer("%ld", number); }
+
+  void
+  put(unsigned int number)
+  { put_integer("%u", number); }
+
+  void
+  put(unsigned long number)
+  { put_integer("%lu", number); }
+
+  void
+  put(float number)
+  { put_floating<float>("%.*e", static_cast<double>(number)); }
+
+  void
+  put(double number)
+  { put_floating<double>("%.*e", number); }
+
+  void
+  put(long double number)
+  { put_floating<long double>("%.*Le", number); }
+
+  template<class T> void
+  put(const T& field)
+  { put(to_string(field)); }
+
+  template<class T> void
+  put_integer(const char* format, T number)
   {
-    value_type block;
-    block.str(blockString);
-    impl_.push_back(block);
+    char field[32];
+    const int length = std::sprintf(field, format, number);
+    put_field(field, length);
+  }
+
+  template<class T, class U> void
+  put_floating(const char* format, U number)
+  {
+    char field[64];
+    const int length = std::sprintf(field, format,
+      std::numeric_limits<T>::digits10, number);
+    put_field(field, length);
+  }
+
+  void
+  put_field(const char* field, std::size_t length)
+  {
+    while (length > 0 && is_whitespace(field[length-1])) --length;
+    if (length == 0) return;
+
+    if (has_comment_)
+    {
+      write(field, length);
+      pos_ += length;
+      return;
+    }
+
+    while (is_whitespace(*field)) { ++field; --length; }
+
+    std::size_t column = 0;
+    if (fields_ == 0)
+    {
+      block_def_ = is_block_specifier(field, length);
+      if (!block_def_ && field[0] != '#') column = Line::shift_width_;
+    }
+    else if (fields_ == 1 && block_def_)
+    { column = pos_ + 1; }
+    else
+    {
+      column = pos_ + Line::calc_spaces_for_indent(pos_);
+      if (field[0] == '-' || field[0] == '+') --column;
+    }
+
+    write_spaces(column - pos_);
+    write(field, length);
+    pos_ = column + length;
+    ++fields_;
+    has_comment_ = field[0] == '#';
+  }
+
+  static bool
+  is_whitespace(char c)
+  { return c != '\0' && std::strchr(" \t\n\v\f\r", c) != 0; }
+
+  static bool
+  is_block_specifier(const char* field, std::size_t length)
+  {
+    static const std::size_t specifier_length = 5;
+    if (length != specifier_length) return false;
+
+    char field_upper[specifier_length];
+    for (std::size_t i = 0; i < specifier_length; ++i)
+    { field_upper[i] = static_cast<char>(std::toupper(field[i])); }
+
+    return std::equal(field_upper, field_upper + length, "BLOCK") ||
+           std::equal(field_upper, field_upper + length, "DECAY");
+  }
+
+  void
+  write(const char* str, std::size_t length)
+  {
+    if (buffer_) buffer_->append(str, length);
+    else os_->write(str, static_cast<std::streamsize>(length));
+  }
+
+  void
+  write_spaces(std::size_t count)
+  {
+    static const char spaces[] = "                ";
+    static const std::size_t max_count = sizeof(spaces) - 1;
+
+    for (; count > max_count; count -= max_count) write(spaces, max_count);
+    write(spaces, count);
   }
 
+private:
+  std::ostream* os_;
+  std::string* buffer_;
+  std::size_t pos_;
+  std::size_t fields_;
+  bool block_def_;
+  bool has_comment_;
+};
+
+
+/**
+ * Block whose data fields are stored as numbers.
+ *
+ * A %NumericBlock is meant for Blocks whose data fields are known to
+ * be numeric, like MASS, the mixing matrices, MINPAR/EXTPAR, or the
+ * decay channels of a DECAY block. All data fields are parsed once
+ * when the %NumericBlock is read from a stream (see read()) or
+ * converted from a Block and are stored as \c double in one
+ * contiguous array. Reading from a stream does not create a Line or
+ * string per field. Per Line only the offset of its first field is
+ * stored, together with one bit per field that remembers if the
+ * field was an integer. Comments are kept in a separate sparse table.
+ *
+ * The block definition is kept as ordinary Line and is only
+ * written back as text. Its number, i.e. the total width of a DECAY
+ * block or the scale Q of a BLOCK, is parsed once as well and can be
+ * read with def_value(), but it cannot be modified.
+ *
+ * Numeric reads are therefore plain array accesses. The fields are
+ * converted back to text only by str(), which uses the same layout as
+ * Line::reformat(). Integers are written as integers and all other
+ * numbers in scientific notation with their full precision.
+ *
+ * Only Blocks whose data fields are all numbers can be stored. Blocks
+ * with text fields, like SPINFO or DCINFO, make assign() and read()
+ * throw std::invalid_argument and must be kept as Block. The text of
+ * the fields is not kept either, so str() writes numbers in
+ * normalized form. Coll::numeric() converts a Block of a Coll.
+ */
+class NumericBlock
+{
+public:
+  typedef std::size_t size_type;
+
+  /** Value returned by find() if no matching Line exists. */
+  static const size_type npos = static_cast<size_type>(-1);
+
+  /** Constructs an empty %NumericBlock. */
+  NumericBlock() : def_value_(no_value()), offsets_(1, 0) {}
+
   /**
-   * \brief Adds a Block to the begin of the %Coll.
-   * \param block Block to be added.
+   * \brief Constructs a %NumericBlock with content from an input
+   *   stream.
+   * \param is Input stream to read content from.
+   * \throw std::invalid_argument If a data field is not a number.
+   * \sa read()
+   */
+  explicit
+  NumericBlock(std::istream& is) : def_value_(no_value()), offsets_(1, 0)
+  { read(is); }
+
+  /**
+   * \brief Constructs a %NumericBlock from a Block.
+   * \param block Block whose Lines are converted.
+   * \throw std::invalid_argument If a data field of \p block is not a
+   *   number.
+   */
+  explicit
+  NumericBlock(const Block& block) : def_value_(no_value()), offsets_(1, 0)
+  { assign(block); }
+
+  /**
+   * \brief Assigns content from an input stream to the %NumericBlock.
+   * \param is Input stream to read content from.
+   * \return Reference to \c *this.
+   * \throw std::invalid_argument If a data field is not a number.
    *
-   * This function creates an element at the begin of the %Coll and
-   * assigns the given \p block to it.
+   * This function reads the lines of one Block from \p is like
+   * Block::read(), but parses the data fields directly into numbers.
+   * Reading stops before the second block definition.
    */
-  void
-  push_front(const value_type& block)
-  { impl_.push_front(block); }
+  NumericBlock&
+  read(std::istream& is)
+  {
+    static const std::string whitespace = " \t\v\f\r";
+    static const std::string delimiters = " \t\v\f\r#";
+
+    clear();
+    std::string line, field;
+    bool has_def = false;
+
+    while (std::getline(is, line))
+    {
+      std::size_t pos1 = line.find_first_not_of(whitespace);
+      if (pos1 == std::string::npos) continue;
+
+      std::size_t pos2 = line.find_first_of(delimiters, pos1);
+      if (pos2 == std::string::npos) pos2 = line.length();
+      if (pos2 - pos1 == 5 &&
+          (boost::iequals(line.substr(pos1, 5), "BLOCK") ||
+           boost::iequals(line.substr(pos1, 5), "DECAY")) &&
+          Line(line).is_block_def())
+      {
+        if (has_def)
+        {
+          is.seekg(-static_cast<std::streamoff>(line.length()) - 1,
+                   std::ios_base::cur);
+          break;
+        }
+        set_def(Line(line));
+        has_def = true;
+        continue;
+      }
+
+      while (pos1 != std::string::npos)
+      {
+        if (line[pos1] == '#')
+        {
+          add_comment(line.substr(pos1,
+            line.find_last_not_of(whitespace) + 1 - pos1));
+          break;
+        }
+        pos2 = line.find_first_of(delimiters, pos1);
+        field.assign(line, pos1, pos2 == std::string::npos ?
+                     std::string::npos : pos2 - pos1);
+        add_field(field);
+        pos1 = line.find_first_not_of(whitespace, pos2);
+      }
+      offsets_.push_back(values_.size());
+    }
+    return *this;
+  }
 
   /**
-   * \brief Adds a Block to the begin of the %Coll.
-   * \param blockString String that is used to construct the Block
-   *   that will be added.
+   * \brief Assigns the content of a Block to the %NumericBlock.
+   * \param block Block whose Lines are converted.
+   * \return Reference to \c *this.
+   * \throw std::invalid_argument If a data field of \p block is not a
+   *   number.
    *
-   * This function creates an element at the begin of the %Coll and
-   * assigns the Block that is constructed from \p blockString to it.
+   * The first block definition of \p block becomes the block
+   * definition of the %NumericBlock. All other Lines are converted
+   * into numeric Lines; Lines that only consist of a comment become
+   * numeric Lines without fields.
    */
-  void
-  push_front(const std::string& blockString)
+  NumericBlock&
+  assign(const Block& block)
   {
-    value_type block;
-    block.str(blockString);
-    impl_.push_front(block);
+    clear();
+    for (Block::const_iterator line = block.begin(); line != block.end();
+         ++line)
+    {
+      if (line->is_block_def() && def_.empty())
+      {
+        set_def(*line);
+        continue;
+      }
+
+      for (Line::const_iterator field = line->begin();
+           field != line->end(); ++field)
+      {
+        if ((*field)[0] == '#')
+        {
+          add_comment(*field);
+          break;
+        }
+        add_field(*field);
+      }
+      offsets_.push_back(values_.size());
+    }
+    return *this;
   }
 
   /**
-   * Removes the last element. This function shrinks the size() of the
-   * %Coll by one.
+   * \brief Returns the name of the %NumericBlock.
+   * \return Second field of the block definition or an empty string
+   *   if there is none.
+   */
+  std::string
+  name() const
+  { return def_.size() > 1 ? def_[1] : std::string(); }
+
+  /** Returns the block definition of the %NumericBlock. */
+  const Line&
+  block_def() const
+  { return def_; }
+
+  /**
+   * \brief Returns the number in the block definition.
+   * \return Total width of a DECAY block, the scale Q of a BLOCK
+   *   (which follows \c "Q=") or NaN if the block definition has no
+   *   such number.
+   */
+  double
+  def_value() const
+  { return def_value_; }
+
+  /** Returns the number of Lines without the block definition. */
+  size_type
+  size() const
+  { return offsets_.size() - 1; }
+
+  /** Returns true if the %NumericBlock contains no Lines. */
+  bool
+  empty() const
+  { return size() == 0; }
+
+  /**
+   * \brief Returns the number of fields of a Line.
+   * \param line Index of the Line.
    */
-  void
-  pop_back()
-  { impl_.pop_back(); }
+  size_type
+  size(size_type line) const
+  { return offsets_[line+1] - offsets_[line]; }
 
   /**
-   * \brief Inserts a Block before given \p position.
-   * \param position Iterator into the %Coll.
-   * \param block Block to be inserted.
-   * \return Iterator pointing to the inserted element.
-   *
-   * This function inserts a copy of \p block before the specified
-   * \p position and thus enlarges the %Coll by one.
+   * \brief Returns the value of a field without range check.
+   * \param line Index of the Line.
+   * \param field Index of the field in the Line.
    */
-  iterator
-  insert(iterator position, const value_type& block)
-  { return impl_.insert(position, block); }
+  double
+  operator()(size_type line, size_type field) const
+  { return values_[offsets_[line] + field]; }
 
   /**
-   * \brief Inserts a range into the %Coll.
-   * \param position Iterator into the %Coll.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   *
-   * This function inserts copies of the Blocks in the range
-   * [\p first, \p last) into the %Coll before the specified
-   * \p position and thus enlarges the %Coll accordingly.
+   * \brief Returns the value of a field.
+   * \param line Index of the Line.
+   * \param field Index of the field in the Line.
+   * \throw std::out_of_range If \p line or \p field is out of range.
    */
-  template<class InputIterator> void
-  insert(iterator position, InputIterator first, InputIterator last)
-  { impl_.insert(position, first, last); }
+  double
+  at(size_type line, size_type field) const
+  { return values_[index(line, field)]; }
 
   /**
-   * \brief Erases element at given \p position.
-   * \param position Iterator pointing to the element to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function erases the element at the given \p position and
-   * thus shortens the %Coll by one.
+   * \brief Returns true if a field is an integer.
+   * \param line Index of the Line.
+   * \param field Index of the field in the Line.
+   * \throw std::out_of_range If \p line or \p field is out of range.
    */
-  iterator
-  erase(iterator position)
-  { return impl_.erase(position); }
+  bool
+  is_integral(size_type line, size_type field) const
+  { return integral_[index(line, field)]; }
 
   /**
-   * \brief Erases a range of elements.
-   * \param first Iterator pointing to the first element to be erased.
-   * \param last Iterator pointing to one past the last element to be
-   *   erased.
-   * \return Iterator pointing to the element pointed to by \p last
-   *   prior to erasing (or end()).
-   *
-   * This function erases the elements in the range [\p first,
-   * \p last) and shortens the %Coll accordingly.
+   * \brief Sets the value of a field to a floating-point number.
+   * \param line Index of the Line.
+   * \param field Index of the field in the Line.
+   * \param value New value of the field.
+   * \throw std::out_of_range If \p line or \p field is out of range.
    */
-  iterator
-  erase(iterator first, iterator last)
-  { return impl_.erase(first, last); }
+  void
+  set(size_type line, size_type field, double value)
+  {
+    const size_type i = index(line, field);
+    values_[i] = value;
+    integral_[i] = false;
+  }
 
   /**
-   * \brief Erases first Block with a given name.
-   * \param blockName Name of the Block to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key and erases the first Block whose name
-   * matches \p blockName. If the %Coll contains such Block, the
-   * function returns an iterator pointing to the next element (or
-   * end()). If no such Block exists, end() is returned.
+   * \brief Sets the value of a field to an integer.
+   * \param line Index of the Line.
+   * \param field Index of the field in the Line.
+   * \param value New value of the field.
+   * \throw std::out_of_range If \p line or \p field is out of range.
    */
-  iterator
-  erase_first(const key_type& blockName)
+  void
+  set(size_type line, size_type field, long value)
   {
-    iterator block = find(blockName);
-    return (block != end()) ? erase(block) : block;
+    const size_type i = index(line, field);
+    values_[i] = static_cast<double>(value);
+    integral_[i] = true;
   }
 
   /**
-   * \brief Erases last Block with a given name.
-   * \param blockName Name of the Block to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key and erases the last Block whose name
-   * matches \p blockName. If the %Coll contains such Block, the
-   * function returns an iterator pointing to the next element (or
-   * end()). If no such Block exists, end() is returned.
+   * \brief Finds the first Line whose first field equals a value.
+   * \param key0 Value of the first field.
+   * \return Index of the Line or npos if there is none.
    */
-  iterator
-  erase_last(const key_type& blockName)
+  size_type
+  find(double key0) const
   {
-    reverse_iterator block = find(rbegin(), rend(), blockName);
-    return (block != rend()) ? erase((++block).base()) : end();
+    for (size_type line = 0; line < size(); ++line)
+    { if (size(line) > 0 && (*this)(line, 0) == key0) return line; }
+    return npos;
   }
 
   /**
-   * \brief Erases all Blocks with a given name.
-   * \param blockName Name of the Blocks to be erased.
-   * \return The number of Blocks erased.
+   * \brief Finds the first Line whose first two fields equal two
+   *   values.
+   * \param key0 Value of the first field.
+   * \param key1 Value of the second field.
+   * \return Index of the Line or npos if there is none.
    */
   size_type
-  erase(const key_type& blockName)
+  find(double key0, double key1) const
   {
-    const key_matches pred(blockName);
-    size_type erased_count = 0;
-
-    for (iterator block = begin(); block != end();)
+    for (size_type line = 0; line < size(); ++line)
     {
-      if (pred(*block))
-      {
-        block = erase(block);
-        ++erased_count;
-      }
-      else ++block;
+      if (size(line) > 1 && (*this)(line, 0) == key0 &&
+          (*this)(line, 1) == key1) return line;
     }
-    return erased_count;
+    return npos;
   }
 
   /**
-   * \brief Swaps data with another %Coll.
-   * \param coll %Coll to be swapped with.
+   * \brief Converts the %NumericBlock into its string representation.
+   * \return String that contains the Lines of the %NumericBlock
+   *   separated by newlines.
    */
-  void
-  swap(Coll& coll)
-  { impl_.swap(coll.impl_); }
-
-  /** Erases all the elements in the %Coll. */
-  void
-  clear()
-  { impl_.clear(); }
+  std::string
+  str() const
+  {
+    std::string result;
+    {
+      Writer writer(result);
+      if (!def_.empty())
+      {
+        for (Line::const_iterator field = def_.begin(); field != def_.end();
+             ++field) writer << *field;
+        writer.end_line();
+      }
 
-  /**
-   * \brief Reformats all Blocks in the %Coll.
-   * \sa Block::reformat()
-   */
-  void
-  reformat()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::reformat)); }
+      std::map<size_type, std::string>::const_iterator comment =
+        comments_.begin();
+      for (size_type line = 0; line < size(); ++line)
+      {
+        for (size_type i = offsets_[line]; i < offsets_[line+1]; ++i)
+        {
+          if (!integral_[i]) writer << values_[i];
+          else if (fits_long(values_[i]))
+          { writer << static_cast<long>(values_[i]); }
+          else writer << format_integral(values_[i]);
+        }
+        if (comment != comments_.end() && comment->first == line)
+        { writer.comment((comment++)->second); }
+        writer.end_line();
+      }
+    }
+    return result;
+  }
 
-  /**
-   * \brief Comments all Blocks in the %Coll.
-   * \sa Block::comment()
-   */
-  void
-  comment()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::comment)); }
+  /** Converts the %NumericBlock into a Block. */
+  Block
+  block() const
+  { return Block::from_str(str()); }
 
-  /**
-   * \brief Uncomments all Blocks in the %Coll.
-   * \sa Block::uncomment()
-   */
+  /** Erases all Lines and the block definition. */
   void
-  uncomment()
-  { std::for_each(begin(), end(), std::mem_fun_ref(&value_type::uncomment)); }
+  clear()
+  {
+    def_.clear();
+    def_value_ = no_value();
+    values_.clear();
+    integral_.clear();
+    offsets_.assign(1, 0);
+    comments_.clear();
+  }
 
-  /**
-   * Unary predicate that checks if a provided name matches the name
-   * of a Block.
-   */
-  struct key_matches : public std::unary_function<value_type, bool>
+private:
+  size_type
+  index(size_type line, size_type field) const
   {
-    explicit
-    key_matches(const key_type& blockName) : name_(blockName) {}
+    if (line >= size() || field >= size(line))
+    {
+      detail::throw_out_of_range("SLHAea::NumericBlock::at(" +
+        to_string(line) + ", " + to_string(field) + ")");
+    }
+    return offsets_[line] + field;
+  }
 
-    bool
-    operator()(const value_type& block) const
-    { return boost::iequals(name_, block.name()); }
+  static double
+  no_value()
+  { return std::numeric_limits<double>::quiet_NaN(); }
 
-    void
-    set_key(const key_type& blockName)
-    { name_ = blockName; }
+  static bool
+  fits_long(double value)
+  {
+    // Both bounds are powers of two and therefore exact as double.
+    static const double min_value =
+      static_cast<double>(std::numeric_limits<long>::min());
+    return value >= min_value && value < -min_value;
+  }
 
-  private:
-    key_type name_;
-  };
+  static std::string
+  format_integral(double value)
+  {
+    char buffer[std::numeric_limits<double>::max_exponent10 + 8];
+    std::sprintf(buffer, "%.0f", value);
+    return buffer;
+  }
 
-  /**
-   * Unary predicate that checks if a provided key matches the block
-   * definition of a Block.
-   */
-  struct key_matches_block_def : public std::unary_function<value_type, bool>
+  void
+  set_def(const Line& def)
   {
-    explicit
-    key_matches_block_def(const value_type::key_type& key)
-      : key_matches_(key) {}
+    def_ = def;
+    def_value_ = no_value();
 
-    bool
-    operator()(const value_type& block) const
+    std::string value;
+    if (boost::iequals(def_[0], "DECAY"))
     {
-      value_type::const_iterator block_def = block.find_block_def();
-      return (block_def == block.end()) ? false : key_matches_(*block_def);
+      if (def_.size() > 2) value = def_[2];
     }
+    else
+    {
+      for (Line::size_type i = 2; i < def_.size(); ++i)
+      {
+        if (boost::iequals(def_[i], "Q="))
+        {
+          if (i + 1 < def_.size()) value = def_[i+1];
+          break;
+        }
+        if (boost::istarts_with(def_[i], "Q="))
+        {
+          value = def_[i].substr(2);
+          break;
+        }
+      }
+    }
+    if (!detail::parse_number(value, def_value_)) def_value_ = no_value();
+  }
 
-    void
-    set_key(const value_type::key_type& key)
-    { key_matches_.set_key(key); }
-
-  private:
-    value_type::key_matches key_matches_;
-  };
+  void
+  add_comment(const std::string& comment)
+  { comments_[size()] = comment; }
 
-private:
-  pointer
-  push_back_named_block(const key_type& blockName)
+  void
+  add_field(const std::string& field)
   {
-    push_back(value_type(blockName));
-    return &back();
+    bool integral;
+    values_.push_back(parse(field, integral));
+    integral_.push_back(integral);
   }
 
-  iterator
-  erase_if_empty(const key_type& blockName, const size_type& offset = 0)
+  static double
+  parse(const std::string& field, bool& integral)
   {
-    iterator block = find(begin() + offset, end(), blockName);
-    return (block != end() && block->empty()) ? erase(block) : block;
+    integral = field.find_first_not_of("+-0123456789") == std::string::npos;
+
+    double value;
+    if (detail::parse_number(field, value)) return value;
+
+    detail::throw_invalid_argument("SLHAea::NumericBlock::assign(‘" + field +
+                                "’)");
   }
 
 private:
-  impl_type impl_;
+  Line def_;
+  double def_value_;
+  std::vector<double> values_;
+  std::vector<bool> integral_;
+  std::vector<size_type> offsets_;
+  std::map<size_type, std::string> comments_;
 };
 
 
+inline NumericBlock
+Coll::numeric(const key_type& blockName) const
+{ return NumericBlock(at(blockName)); }
+
+
 /**
- * Reference to a single field in a SLHA structure.
- * This data type represents a reference to a single field in a SLHA
- * structure, but which is independent of any concrete Coll object.
- * That means that only the keys and the index of the Coll, Block, and
- * Line containers of the corresponding field are stored. One of the
- * main purposes of this data type is the conversion to string and
- * vice versa in a way that the string representation of a %Key can be
- * used as a single field in a SLHA structure. For example, the string
- * representation of a %Key that refers to the entry in the first row
- * and third column of the RVHMIX matrix is \c "RVHMIX;1,3;2". Further
- * examples are \c "1000022;DECAY;2" which refers to the total decay
- * width of the lightest neutralino or \c "1000022;(any),2,11,24;0"
- * which refers to the branching ratio of the decay of the lightest
- * neutralino into an electron and a W boson.
+ * Difference between two Blocks that is reported by stream_diff().
  */
-struct Key
+struct BlockDifference
 {
-public:
-  /** Name of the Block that contains the field. */
-  Coll::key_type block;
-
-  /** First field(s) of the Line that contains the field. */
-  Block::key_type line;
-
-  /** Index of the field in the Line. */
-  Line::size_type field;
+  /** Kinds of differences. */
+  enum kind_type
+  {
+    inserted, /**< The Block only exists in the new input. */
+    erased,   /**< The Block only exists in the old input. */
+    modified  /**< The Block exists in both inputs but differs. */
+  };
 
-  /**
-   * \brief Constructs a %Key from explicit key values.
-   * \param _block Name of the Block that contains the field.
-   * \param _line First field(s) of the Line that contains the field.
-   * \param _field Index of the field in the Line.
-   */
-  Key(const Coll::key_type& _block,
-      const Block::key_type& _line,
-      const Line::size_type& _field)
-    : block(_block), line(_line), field(_field) {}
+  /** Kind of the difference. */
+  kind_type kind;
 
-  /**
-   * \brief Constructs a %Key from a string.
-   * \param keyString String from which the %Key is constructed.
-   * \sa str()
-   */
-  Key(const std::string& keyString)
-  { str(keyString); }
+  /** Block from the old input or an empty Block if it was inserted. */
+  Block old_block;
 
-  /**
-   * \brief Constructs a %Key from a string.
-   * \param keyString String from which the %Key is constructed.
-   * \sa str()
-   */
-  Key(const char* keyString)
-  { str(keyString); }
+  /** Block from the new input or an empty Block if it was erased. */
+  Block new_block;
+};
 
-  /**
-   * \brief Converts a string to a %Key.
-   * \param keyString String that represents a %Key.
-   * \return Reference to \c *this.
-   */
-  Key&
-  str(const std::string& keyString)
+namespace detail {
+
+// Reads one Block per call from a stream. The line that starts the
+// next Block is kept instead of being put back into the stream, so
+// that the stream need not be seekable. For seekable streams the
+// offset where each Block started is remembered, so that Blocks can
+// be read again later by their offset. Otherwise the offset is -1.
+class block_reader
+{
+public:
+  explicit
+  block_reader(std::istream& is)
+    : is_(is), next_(), next_offset_(-1), has_next_(false) {}
+
+  bool
+  next(Block& block, std::streamoff& offset)
   {
-    std::vector<std::string> keys;
-    boost::split(keys, keyString, boost::is_any_of(";"));
+    block.clear();
+    offset = -1;
 
-    if (keys.size() != 3)
-    { throw std::invalid_argument("SLHAea::Key::str(‘" + keyString + "’)"); }
+    std::string line_str;
+    Line line;
+    bool has_def = false;
 
-    block = keys[0];
-    line.clear();
-    boost::split(line, keys[1], boost::is_any_of(","));
-    field = to<Line::size_type>(keys[2]);
+    for (;;)
+    {
+      std::streamoff line_offset = next_offset_;
+      if (has_next_)
+      {
+        line_str.swap(next_);
+        has_next_ = false;
+      }
+      else
+      {
+        line_offset = is_.tellg();
+        if (!std::getline(is_, line_str)) break;
+      }
+      if (is_all_whitespace(line_str)) continue;
 
-    return *this;
+      line.str(line_str);
+      if (line.is_block_def())
+      {
+        // Like Coll::read(), Lines before the first block definition
+        // form a nameless Block of their own.
+        if (has_def || !block.empty())
+        {
+          next_.swap(line_str);
+          next_offset_ = line_offset;
+          has_next_ = true;
+          break;
+        }
+        if (block.name().empty()) block.name(line[1]);
+        has_def = true;
+      }
+      if (block.empty()) offset = line_offset;
+      block.push_back(line);
+    }
+    return !block.empty();
   }
 
-  /**
-   * \brief Converts a %Key into its string representation.
-   * \return String that represents the %Key.
-   */
-  std::string
-  str() const
+  void
+  read_at(std::streamoff offset, Block& block)
   {
-    std::ostringstream output;
-    output << block << ";" << boost::join(line, ",") << ";" << field;
-    return output.str();
+    const bool at_end = !is_.good();
+    const std::streampos here = at_end ? std::streampos(0) : is_.tellg();
+
+    is_.clear();
+    is_.seekg(offset);
+    std::streamoff block_offset;
+    block_reader(is_).next(block, block_offset);
+
+    is_.clear();
+    if (at_end) is_.seekg(0, std::ios_base::end);
+    else is_.seekg(here);
   }
+
+private:
+  std::istream& is_;
+  std::string next_;
+  std::streamoff next_offset_;
+  bool has_next_;
 };
 
+// Identifies a Block by its name and by the number of preceding
+// Blocks with the same name, so that e.g. several Blocks that only
+// differ in their scale are paired in order.
+inline std::string
+block_diff_key(const Block& block, std::map<std::string, std::size_t>& seen)
+{
+  const std::string name = to_upper_copy(block.name());
+  return name + '\n' + to_string(seen[name]++);
+}
 
-inline Coll::reference
-Coll::block(const Key& key)
-{ return at(key.block); }
+// Block whose partner has not been seen yet. If its stream is not
+// seekable, the Block itself is kept instead of its offset.
+struct block_diff_entry
+{
+  std::size_t hash;
+  std::size_t sequence;
+  std::streamoff offset;
+  Block block;
+};
 
-inline Coll::const_reference
-Coll::block(const Key& key) const
-{ return at(key.block); }
+inline void
+read_entry(block_reader& reader, const block_diff_entry& entry,
+           Block& block)
+{
+  if (entry.offset < 0) block = entry.block;
+  else reader.read_at(entry.offset, block);
+}
 
-inline Block::reference
-Coll::line(const Key& key)
-{ return block(key).at(key.line); }
+inline std::size_t
+block_hash(const Block& block)
+{
+  std::size_t seed = 0;
+  for (Block::const_iterator line = block.begin(); line != block.end();
+       ++line)
+  {
+    boost::hash_combine(seed, line->size());
+    for (Line::const_iterator field = line->begin(); field != line->end();
+         ++field) boost::hash_combine(seed, *field);
+  }
+  return seed;
+}
 
-inline Block::const_reference
-Coll::line(const Key& key) const
-{ return block(key).at(key.line); }
+} // namespace detail
 
-inline Line::reference
-Coll::field(const Key& key)
-{ return line(key).at(key.field); }
 
-inline Line::const_reference
-Coll::field(const Key& key) const
-{ return line(key).at(key.field); }
+/**
+ * \brief Compares two SLHA inputs Block by Block without loading them.
+ * \param old_is Input stream with the old content.
+ * \param new_is Input stream with the new content.
+ * \param report Function that is called for every difference.
+ * \return Number of differences.
+ *
+ * This function reads one Block at a time from both inputs. Blocks
+ * are paired by their name (case-insensitive) and, for Blocks with
+ * the same name, by their order of appearance. As long as both inputs
+ * contain the Blocks in the same order, only the two current Blocks
+ * are kept in memory and are compared directly.
+ *
+ * If the order differs, every Block whose partner has not been seen
+ * yet is recorded in a temporary index with a hash of its content and
+ * its offset in the stream. When the partner arrives, the recorded
+ * Block is read again. If the hashes differ, the Blocks are reported
+ * as modified right away, otherwise their content is compared. The
+ * memory used thus grows with the number of Blocks that are out of
+ * order, not with the size of the inputs. Blocks that are left in the
+ * index at the end are reported as erased or inserted, in the order
+ * in which they appear in their inputs.
+ *
+ * Lines before the first block definition of an input form a
+ * nameless Block, like in Coll::read(). Paired Blocks are compared
+ * with operator==(), which is exact: Blocks whose names only differ
+ * in case, or whose Lines only differ in their formatting (e.g. in
+ * the whitespace between fields or \c 1.0E+02 instead of \c 100),
+ * are reported as modified.
+ *
+ * The inputs need not be seekable, e.g. \c std::cin works as well.
+ * For an input that is not seekable, the index holds copies of the
+ * out-of-order Blocks instead of their offsets, so that the memory
+ * used then grows with their size.
+ */
+SLHAEA_INLINE std::size_t
+stream_diff(std::istream& old_is, std::istream& new_is,
+            const boost::function<void (const BlockDifference&)>& report);
 
+} // namespace SLHAea
 
-// stream operators
-inline std::istream&
-operator>>(std::istream& is, Block& block)
+
+// Definitions of the functions that are declared with SLHAEA_INLINE.
+// If SLHAEA_USE_LIBRARY is defined, they are omitted here and are
+// provided by libslhaea instead (see slhaea.cpp).
+#if !defined(SLHAEA_USE_LIBRARY) || defined(SLHAEA_COMPILING_LIBRARY)
+
+namespace SLHAea {
+
+template<> SLHAEA_INLINE Line&
+Line::operator<< <float>(const float& number)
 {
-  block.read(is);
-  return is;
+  insert_fundamental_type(number);
+  return *this;
 }
 
-inline std::istream&
-operator>>(std::istream& is, Coll& coll)
+template<> SLHAEA_INLINE Line&
+Line::operator<< <double>(const double& number)
 {
-  coll.read(is);
-  return is;
+  insert_fundamental_type(number);
+  return *this;
 }
 
-inline std::ostream&
-operator<<(std::ostream& os, const Line& line)
-{ return os << line.str(); }
-
-inline std::ostream&
-operator<<(std::ostream& os, const Block& block)
+template<> SLHAEA_INLINE Line&
+Line::operator<< <long double>(const long double& number)
 {
-  std::copy(block.begin(), block.end(),
-            std::ostream_iterator<Block::value_type>(os, "\n"));
-  return os;
+  insert_fundamental_type(number);
+  return *this;
 }
 
-inline std::ostream&
-operator<<(std::ostream& os, const Coll& coll)
+SLHAEA_INLINE void
+Line::parse(const char* first, const char* last)
 {
-  std::copy(coll.begin(), coll.end(),
-            std::ostream_iterator<Coll::value_type>(os));
-  return os;
-}
+  clear();
+  while (last != first && detail::is_whitespace(*(last - 1))) --last;
 
-inline std::ostream&
-operator<<(std::ostream& os, const Key& key)
-{ return os << key.str(); }
+  const char* const comment = std::find(first, last, '#');
+  const char* pos1 = first;
 
+  while (true)
+  {
+    while (pos1 != comment && detail::is_whitespace(*pos1)) ++pos1;
+    if (pos1 == comment) break;
 
-// relational operators for Line
-inline bool
-operator==(const Line& a, const Line& b)
-{
-  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin())
-    && a.str() == b.str();
+    const char* pos2 = pos1;
+    while (pos2 != comment && !detail::is_whitespace(*pos2)) ++pos2;
+
+    impl_.push_back(value_type(pos1, pos2));
+    columns_.push_back(pos1 - first);
+    pos1 = pos2;
+  }
+
+  if (comment != last)
+  {
+    impl_.push_back(value_type(comment, last));
+    columns_.push_back(comment - first);
+  }
 }
 
-inline bool
-operator<(const Line& a, const Line& b)
+SLHAEA_INLINE Block&
+Block::read(std::istream& is)
 {
-  const bool a_is_block_def = a.is_block_def();
+  std::string line_str;
+  value_type line;
 
-  return (a_is_block_def != b.is_block_def()) ? a_is_block_def :
-    std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  std::size_t def_count = 0;
+  bool nameless = name().empty();
+
+  while (std::getline(is, line_str))
+  {
+    if (detail::is_all_whitespace(line_str)) continue;
+
+    line.str(line_str);
+    if (line.is_block_def())
+    {
+      if (++def_count > 1)
+      {
+        is.seekg(-line_str.length()-1, std::ios_base::cur);
+        break;
+      }
+      if (nameless)
+      {
+        name(line[1]);
+        nameless = false;
+      }
+    }
+    push_back(line);
+  }
+  return *this;
 }
 
-inline bool
-operator!=(const Line& a, const Line& b)
-{ return !(a == b); }
+SLHAEA_INLINE Coll&
+Coll::read(std::istream& is, const Projection& projection)
+{
+  std::string line_str;
+  Line line;
 
-inline bool
-operator>(const Line& a, const Line& b)
-{ return b < a; }
+  const size_type orig_size = size();
+  pointer block = push_back_named_block("");
+  const Projection::fields_type* fields = projection.find("");
 
-inline bool
-operator<=(const Line& a, const Line& b)
-{ return !(b < a); }
+  while (std::getline(is, line_str))
+  {
+    if (detail::is_all_whitespace(line_str)) continue;
 
-inline bool
-operator>=(const Line& a, const Line& b)
-{ return !(a < b); }
+    if (fields) line.str(line_str, *fields);
+    else line.str(line_str);
 
+    if (line.is_block_def())
+    {
+      block = push_back_named_block(line[1]);
+      fields = projection.find(line[1]);
+    }
+    else if (line.empty()) continue;
+    block->push_back(line);
+  }
 
-// relational operators for Block
-inline bool
-operator==(const Block& a, const Block& b)
-{
-  return a.size() == b.size() && a.name() == b.name()
-    && std::equal(a.begin(), a.end(), b.begin());
+  erase_if_empty("", orig_size);
+  return *this;
 }
 
-inline bool
-operator<(const Block& a, const Block& b)
+SLHAEA_INLINE Coll&
+Coll::read(const char* first, const char* last)
 {
-  return (a.name() != b.name()) ? a.name() < b.name() :
-    std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
-}
+  std::vector<std::size_t> block_sizes(1, 0), line_sizes;
+  bool block_def = false;
 
-inline bool
-operator!=(const Block& a, const Block& b)
-{ return !(a == b); }
+  for (const char* line = first; line != last;)
+  {
+    const char* line_end = std::find(line, last, '\n');
+    const std::size_t fields =
+      detail::count_fields(line, line_end, block_def);
+    if (fields != 0)
+    {
+      if (block_def) block_sizes.push_back(0);
+      ++block_sizes.back();
+      line_sizes.push_back(fields);
+    }
+    line = (line_end == last) ? last : line_end + 1;
+  }
 
-inline bool
-operator>(const Block& a, const Block& b)
-{ return b < a; }
+  const size_type orig_size = size();
+  pointer block = push_back_named_block("");
+  block->impl_.reserve(block_sizes.front());
 
-inline bool
-operator<=(const Block& a, const Block& b)
-{ return !(b < a); }
+  std::vector<std::size_t>::const_iterator block_size = block_sizes.begin();
+  std::vector<std::size_t>::const_iterator line_size = line_sizes.begin();
+  std::size_t remaining = *block_size;
 
-inline bool
-operator>=(const Block& a, const Block& b)
-{ return !(a < b); }
+  for (const char* line = first; line != last;)
+  {
+    const char* line_end = std::find(line, last, '\n');
+    if (!detail::is_all_whitespace(line, line_end))
+    {
+      if (remaining == 0)
+      {
+        block = push_back_named_block("");
+        block->impl_.reserve(*++block_size);
+        remaining = *block_size;
+      }
 
+      block->impl_.push_back(Line());
+      Line& new_line = block->impl_.back();
+      new_line.impl_.reserve(*line_size);
+      new_line.columns_.reserve(*line_size++);
+      new_line.parse(line, line_end);
 
-// relational operators for Coll
-inline bool
-operator==(const Coll& a, const Coll& b)
-{ return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin()); }
+      if (remaining-- == *block_size && block_size != block_sizes.begin())
+      { block->name(new_line[1]); }
+    }
+    line = (line_end == last) ? last : line_end + 1;
+  }
 
-inline bool
-operator<(const Coll& a, const Coll& b)
+  // The Lines were added to the new Blocks without their hooks.
+  if (undo_log_.active)
+  {
+    for (size_type i = orig_size; i < size(); ++i) impl_[i].link_lines();
+  }
+  erase_if_empty("", orig_size);
+  return *this;
+}
+
+SLHAEA_INLINE std::size_t
+stream_diff(std::istream& old_is, std::istream& new_is,
+            const boost::function<void (const BlockDifference&)>& report)
 {
-  return std::lexicographical_compare(a.begin(), a.end(),
-                                      b.begin(), b.end());
+  typedef std::map<std::string, detail::block_diff_entry> index_type;
+
+  detail::block_reader readers[2] = {
+    detail::block_reader(old_is), detail::block_reader(new_is) };
+  std::map<std::string, std::size_t> seen[2];
+  index_type pending[2];
+  std::size_t count = 0, sequence = 0;
+
+  BlockDifference diff;
+  Block* blocks[2] = { &diff.old_block, &diff.new_block };
+  bool has_block[2] = { true, true };
+  std::string keys[2];
+  std::streamoff offsets[2];
+
+  for (;;)
+  {
+    for (int i = 0; i < 2; ++i)
+    {
+      if (has_block[i]) has_block[i] = readers[i].next(*blocks[i], offsets[i]);
+      if (has_block[i]) keys[i] = detail::block_diff_key(*blocks[i], seen[i]);
+    }
+    if (!has_block[0] && !has_block[1]) break;
+
+    if (has_block[0] && has_block[1] && keys[0] == keys[1])
+    {
+      if (*blocks[0] != *blocks[1])
+      {
+        diff.kind = BlockDifference::modified;
+        report(diff);
+        ++count;
+      }
+      continue;
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+      if (!has_block[i]) continue;
+
+      const int other = 1 - i;
+      const std::size_t hash = detail::block_hash(*blocks[i]);
+      index_type::iterator partner = pending[other].find(keys[i]);
+
+      if (partner == pending[other].end())
+      {
+        detail::block_diff_entry& e = pending[i][keys[i]];
+        e.hash = hash;
+        e.sequence = sequence++;
+        e.offset = offsets[i];
+        if (e.offset < 0) e.block = *blocks[i];
+        continue;
+      }
+
+      BlockDifference modified;
+      modified.kind = BlockDifference::modified;
+      (i == 0 ? modified.old_block : modified.new_block) = *blocks[i];
+      detail::read_entry(readers[other], partner->second,
+        other == 0 ? modified.old_block : modified.new_block);
+      if (partner->second.hash != hash ||
+          modified.old_block != modified.new_block)
+      {
+        report(modified);
+        ++count;
+      }
+      pending[other].erase(partner);
+    }
+  }
+
+  for (int i = 0; i < 2; ++i)
+  {
+    std::map<std::size_t, const detail::block_diff_entry*> remaining;
+    for (index_type::const_iterator it = pending[i].begin();
+         it != pending[i].end(); ++it)
+    { remaining[it->second.sequence] = &it->second; }
+
+    BlockDifference missing;
+    missing.kind = (i == 0) ? BlockDifference::erased :
+                              BlockDifference::inserted;
+    for (std::map<std::size_t, const detail::block_diff_entry*>::
+           const_iterator entry = remaining.begin();
+         entry != remaining.end(); ++entry)
+    {
+      detail::read_entry(readers[i], *entry->second,
+                         i == 0 ? missing.old_block : missing.new_block);
+      report(missing);
+      ++count;
+    }
+  }
+  return count;
 }
 
-inline bool
-operator!=(const Coll& a, const Coll& b)
-{ return !(a == b); }
+} // namespace SLHAea
 
-inline bool
-operator>(const Coll& a, const Coll& b)
-{ return b < a; }
+#endif
+
+
+// Explicit instantiations of the most commonly used conversions. If
+// SLHAEA_USE_LIBRARY is defined, they are only declared here and are
+// provided by libslhaea, so that they are not instantiated anew in
+// every translation unit. Declarations of explicit instantiations
+// (extern template) do not exist before C++11, so without C++11 these
+// conversions are instantiated in every translation unit as in the
+// header-only case and libslhaea only provides the SLHAEA_INLINE
+// functions.
+#if defined(SLHAEA_HAS_CXX11) && \
+    (defined(SLHAEA_USE_LIBRARY) || defined(SLHAEA_COMPILING_LIBRARY))
+#ifdef SLHAEA_COMPILING_LIBRARY
+#define SLHAEA_INSTANTIATE template
+#else
+#define SLHAEA_INSTANTIATE extern template
+#endif
 
-inline bool
-operator<=(const Coll& a, const Coll& b)
-{ return !(b < a); }
+namespace SLHAea {
 
-inline bool
-operator>=(const Coll& a, const Coll& b)
-{ return !(a < b); }
+SLHAEA_INSTANTIATE double to<double, std::string>(const std::string&);
+SLHAEA_INSTANTIATE float to<float, std::string>(const std::string&);
+SLHAEA_INSTANTIATE int to<int, std::string>(const std::string&);
+SLHAEA_INSTANTIATE long to<long, std::string>(const std::string&);
+SLHAEA_INSTANTIATE std::size_t
+  to<std::size_t, std::string>(const std::string&);
+
+SLHAEA_INSTANTIATE std::string to_string<double>(const double&);
+SLHAEA_INSTANTIATE std::string to_string<float>(const float&);
+SLHAEA_INSTANTIATE std::string to_string<int>(const int&);
+SLHAEA_INSTANTIATE std::string to_string<long>(const long&);
+SLHAEA_INSTANTIATE std::string to_string<std::size_t>(const std::size_t&);
+SLHAEA_INSTANTIATE std::string to_string<double>(const double&, int);
 
 } // namespace SLHAea
 
+#undef SLHAEA_INSTANTIATE
+#endif
+
+#undef SLHAEA_INLINE
+
 #endif // SLHAEA_H
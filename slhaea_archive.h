@@ -0,0 +1,578 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// ScanArchive, an append-only file of many Colls with random access
+// by point id. It needs a C++11 compiler and POSIX file functions.
+
+#ifndef SLHAEA_ARCHIVE_H
+#define SLHAEA_ARCHIVE_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "slhaea.h"
+
+#if defined(SLHAEA_HAS_CXX11) && defined(SLHAEA_HAS_POSIX)
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SLHAea {
+
+#if defined(SLHAEA_HAS_CXX11) && defined(SLHAEA_HAS_POSIX)
+namespace detail {
+
+struct archive_header
+{
+  char magic[8];
+  std::uint64_t segment_size;
+};
+
+struct record_header
+{
+  char magic[4];
+  std::uint32_t checksum;
+  std::uint64_t point_id;
+  std::uint64_t size;
+};
+
+// 32-bit FNV-1a hash of the point id and the text of a record.
+inline std::uint32_t
+record_checksum(std::uint64_t point_id, const char* text, std::size_t size)
+{
+  std::uint32_t h = 2166136261u;
+  for (int i = 0; i < 8; ++i, point_id >>= 8)
+  {
+    h ^= static_cast<std::uint32_t>(point_id & 0xff);
+    h *= 16777619u;
+  }
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    h ^= static_cast<unsigned char>(text[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+} // namespace detail
+
+
+/**
+ * Append-only file of Colls with random access by point id.
+ *
+ * A %ScanArchive stores many Colls, e.g. the outputs of all points of
+ * a parameter scan, as records in one file instead of one file per
+ * Coll. A record consists of a small header with the point id and a
+ * checksum, followed by the SLHA text of the Coll. The offsets of all
+ * records are kept in a hash table, so that get() needs one lookup and
+ * one read regardless of the size of the archive. When an existing
+ * archive is opened, this index is rebuilt by reading all records.
+ * Records whose checksum does not match, e.g. because writing them
+ * was interrupted, end the scan of their segment and are not indexed.
+ * get() and str() verify the checksum again.
+ *
+ * The file is divided into segments of equal size. Every Appender
+ * reserves whole segments for itself and fills them with its records,
+ * so that Appenders in different threads write to disjoint parts of
+ * the file. Only the reservation of a segment and the update of the
+ * index are synchronized. Records that do not fit into one segment get
+ * consecutive segments of their own, and the unused tail of a segment
+ * remains a hole in the file.
+ *
+ * An archive that is opened for writing is locked with \c flock(), so
+ * that only one %ScanArchive object (in any process) can append to a
+ * file at a time. Archives opened with \c read_only are not locked
+ * and see the records that existed when they were opened. Records are
+ * stored in the native byte order.
+ */
+class ScanArchive
+{
+public:
+  typedef std::uint64_t point_type;
+  typedef std::size_t   size_type;
+
+  class Appender;
+
+  /** Ways to open an archive. */
+  enum mode_type
+  {
+    read_write, /**< Open or create the archive for appending. */
+    read_only   /**< Open an existing archive for reading only. */
+  };
+
+  /** Default size of the segments of a new archive. */
+  static const size_type default_segment_size = 1 << 20;
+
+  /**
+   * \brief Opens or creates an archive for appending.
+   * \param path Path of the archive file.
+   * \param segment_size Size of the segments if the archive is
+   *   created. An existing archive keeps its segment size.
+   * \throw std::runtime_error If the file cannot be opened, is not an
+   *   archive, or is locked by another writer.
+   */
+  explicit
+  ScanArchive(const std::string& path,
+              size_type segment_size = default_segment_size);
+
+  /**
+   * \brief Opens an archive.
+   * \param path Path of the archive file.
+   * \param mode If \c read_only, the file is neither created nor
+   *   locked and append() throws.
+   * \throw std::runtime_error If the file cannot be opened, is not an
+   *   archive, or is locked by another writer.
+   */
+  ScanArchive(const std::string& path, mode_type mode);
+
+  /** Closes the archive file. */
+  ~ScanArchive();
+
+  /**
+   * \brief Appends a Coll to the archive.
+   * \param id Point id under which \p coll is stored.
+   * \param coll Coll to be stored.
+   * \throw std::invalid_argument If the archive already contains a
+   *   record with the point id \p id.
+   * \throw std::runtime_error If the archive is read-only or writing
+   *   the record failed.
+   *
+   * This function is thread-safe, but all threads share one segment.
+   * Threads that append many Colls should use an Appender each.
+   */
+  void
+  append(point_type id, const Coll& coll);
+
+  /** Returns true if the archive contains a record with the point id. */
+  bool
+  contains(point_type id) const
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_type::const_iterator entry = index_.find(id);
+    return entry != index_.end() && entry->second.size != pending;
+  }
+
+  /**
+   * \brief Reads the SLHA text of a record.
+   * \param id Point id of the record.
+   * \throw std::out_of_range If the archive contains no record with
+   *   the point id \p id.
+   * \throw std::runtime_error If reading the record failed or its
+   *   checksum does not match.
+   */
+  std::string
+  str(point_type id) const
+  {
+    entry_type entry;
+    {
+      std::lock_guard<std::mutex> lock(index_mutex_);
+      index_type::const_iterator it = index_.find(id);
+      if (it == index_.end() || it->second.size == pending)
+      {
+        detail::throw_out_of_range("SLHAea::ScanArchive::str(" +
+                                   to_string(id) + ")");
+      }
+      entry = it->second;
+    }
+
+    std::string record(sizeof(detail::record_header) + entry.size, '\0');
+    read_at(&record[0], record.size(), entry.offset, "str");
+    if (!valid_record(record, id)) fail("str");
+    return record.substr(sizeof(detail::record_header));
+  }
+
+  /**
+   * \brief Reads the Coll of a record.
+   * \param id Point id of the record.
+   * \throw std::out_of_range If the archive contains no record with
+   *   the point id \p id.
+   * \throw std::runtime_error If reading the record failed or its
+   *   checksum does not match.
+   */
+  Coll
+  get(point_type id) const
+  {
+    const std::string text = str(id);
+    Coll coll;
+    coll.read(text.data(), text.data() + text.size());
+    return coll;
+  }
+
+  /** Returns the point ids of all records in ascending order. */
+  std::vector<point_type>
+  point_ids() const
+  {
+    std::vector<point_type> ids;
+    {
+      std::lock_guard<std::mutex> lock(index_mutex_);
+      ids.reserve(index_.size());
+      for (index_type::const_iterator entry = index_.begin();
+           entry != index_.end(); ++entry)
+      { if (entry->second.size != pending) ids.push_back(entry->first); }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+  /** Returns the number of records in the archive. */
+  size_type
+  size() const
+  { return point_ids().size(); }
+
+  /** Returns the size of the segments of the archive. */
+  size_type
+  segment_size() const
+  { return segment_size_; }
+
+  /**
+   * \brief Flushes all written records to the storage device.
+   * \throw std::runtime_error If flushing failed.
+   */
+  void
+  sync()
+  { if (::fsync(fd_) == -1) fail("sync"); }
+
+private:
+  ScanArchive(const ScanArchive&);
+  ScanArchive& operator=(const ScanArchive&);
+
+  struct entry_type
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+  };
+
+  typedef boost::unordered_map<point_type, entry_type> index_type;
+
+  static const std::uint64_t pending = std::uint64_t(-1);
+
+  static const char*
+  archive_magic()
+  { return "SLHAarc2"; }
+
+  static const char*
+  record_magic()
+  { return "SLHr"; }
+
+  BOOST_NORETURN void
+  fail(const std::string& function) const
+  {
+    detail::throw_runtime_error("SLHAea::ScanArchive::" + function + "(‘" +
+                                path_ + "’)");
+  }
+
+  void
+  open()
+  {
+    if (fd_ == -1) fail("ScanArchive");
+    if (!read_only_ && ::flock(fd_, LOCK_EX | LOCK_NB) == -1)
+    { fail("ScanArchive"); }
+
+    struct stat status;
+    if (::fstat(fd_, &status) == -1) fail("ScanArchive");
+    const std::uint64_t file_size = status.st_size;
+
+    detail::archive_header header;
+    if (file_size == 0 && !read_only_)
+    {
+      std::memcpy(header.magic, archive_magic(), sizeof(header.magic));
+      header.segment_size = segment_size_;
+      write_at(&header, sizeof(header), 0, "ScanArchive");
+      return;
+    }
+
+    if (file_size < sizeof(header)) fail("ScanArchive");
+    read_at(&header, sizeof(header), 0, "ScanArchive");
+    if (std::memcmp(header.magic, archive_magic(), sizeof(header.magic)) ||
+        header.segment_size < 2 * sizeof(detail::record_header))
+    { fail("ScanArchive"); }
+    segment_size_ = header.segment_size;
+
+    const std::uint64_t segments =
+      (file_size - sizeof(header) + segment_size_ - 1) / segment_size_;
+    for (std::uint64_t segment = 0; segment < segments; ++segment)
+    { segment += scan_segment(segment, file_size); }
+    next_segment_ = segments;
+  }
+
+  // Adds the records of a segment to the index and returns the number
+  // of following segments that are covered by its last record.
+  std::uint64_t
+  scan_segment(std::uint64_t segment, std::uint64_t file_size)
+  {
+    const std::uint64_t base = segment_offset(segment);
+    detail::record_header header;
+    std::string record;
+
+    for (std::uint64_t pos = 0;
+         pos + sizeof(header) <= segment_size_ &&
+         base + pos + sizeof(header) <= file_size;)
+    {
+      read_at(&header, sizeof(header), base + pos, "ScanArchive");
+      if (std::memcmp(header.magic, record_magic(), sizeof(header.magic)) ||
+          header.size > file_size)
+      { break; }
+
+      const std::uint64_t length = sizeof(header) + header.size;
+      if (base + pos + length > file_size) break;
+
+      record.resize(length);
+      read_at(&record[0], length, base + pos, "ScanArchive");
+      if (!valid_record(record, header.point_id)) break;
+
+      const entry_type entry = { base + pos, header.size };
+      index_.insert(std::make_pair(header.point_id, entry));
+      if (length > segment_size_) return segments_for(length) - 1;
+      pos += length;
+    }
+    return 0;
+  }
+
+  static bool
+  valid_record(const std::string& record, point_type id)
+  {
+    detail::record_header header;
+    std::memcpy(&header, record.data(), sizeof(header));
+    return !std::memcmp(header.magic, record_magic(), sizeof(header.magic)) &&
+      header.point_id == id &&
+      header.size == record.size() - sizeof(header) &&
+      header.checksum == detail::record_checksum(id,
+        record.data() + sizeof(header), record.size() - sizeof(header));
+  }
+
+  std::uint64_t
+  segment_offset(std::uint64_t segment) const
+  { return sizeof(detail::archive_header) + segment * segment_size_; }
+
+  std::uint64_t
+  segments_for(std::uint64_t length) const
+  { return (length + segment_size_ - 1) / segment_size_; }
+
+  // Returns the offset of count consecutive unused segments.
+  std::uint64_t
+  reserve_segments(std::uint64_t count)
+  { return segment_offset(next_segment_.fetch_add(count)); }
+
+  void
+  reserve_id(point_type id)
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    const entry_type entry = { 0, pending };
+    if (!index_.insert(std::make_pair(id, entry)).second)
+    {
+      detail::throw_invalid_argument("SLHAea::ScanArchive::append(" +
+                                     to_string(id) + ")");
+    }
+  }
+
+  void
+  release_id(point_type id)
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_.erase(id);
+  }
+
+  void
+  publish(point_type id, std::uint64_t offset, std::uint64_t size)
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    const entry_type entry = { offset, size };
+    index_[id] = entry;
+  }
+
+  void
+  read_at(void* buffer, std::size_t length, std::uint64_t offset,
+          const char* function) const
+  {
+    char* chars = static_cast<char*>(buffer);
+    while (length > 0)
+    {
+      const ssize_t count = ::pread(fd_, chars, length, offset);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) fail(function);
+      chars += count;
+      length -= count;
+      offset += count;
+    }
+  }
+
+  void
+  write_at(const void* buffer, std::size_t length, std::uint64_t offset,
+           const char* function)
+  {
+    const char* chars = static_cast<const char*>(buffer);
+    while (length > 0)
+    {
+      const ssize_t count = ::pwrite(fd_, chars, length, offset);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) fail(function);
+      chars += count;
+      length -= count;
+      offset += count;
+    }
+  }
+
+private:
+  std::string path_;
+  bool read_only_;
+  int fd_;
+  std::uint64_t segment_size_;
+  std::atomic<std::uint64_t> next_segment_;
+  index_type index_;
+  mutable std::mutex index_mutex_;
+  std::unique_ptr<Appender> shared_appender_;
+  std::mutex append_mutex_;
+};
+
+
+/**
+ * Appends Colls to a ScanArchive from one thread.
+ *
+ * An %Appender owns one segment of the archive at a time and writes
+ * its records into this segment without any synchronization with
+ * other Appenders. A new segment is reserved when the current one is
+ * full. Every thread that appends to an archive should use its own
+ * %Appender, which must not outlive the archive.
+ */
+class ScanArchive::Appender
+{
+public:
+  /** Constructs an %Appender that appends to \p archive. */
+  explicit
+  Appender(ScanArchive& archive)
+    : archive_(archive), segment_(0), used_(archive.segment_size_) {}
+
+  /**
+   * \brief Appends a Coll to the archive.
+   * \param id Point id under which \p coll is stored.
+   * \param coll Coll to be stored.
+   * \throw std::invalid_argument If the archive already contains a
+   *   record with the point id \p id.
+   * \throw std::runtime_error If the archive is read-only or writing
+   *   the record failed.
+   */
+  void
+  append(point_type id, const Coll& coll)
+  {
+    if (archive_.read_only_) archive_.fail("append");
+
+    detail::record_header header;
+    std::memcpy(header.magic, record_magic(), sizeof(header.magic));
+    header.point_id = id;
+
+    std::string record(sizeof(header), '\0');
+    record += coll.str();
+    header.size = record.size() - sizeof(header);
+    header.checksum = detail::record_checksum(id,
+      record.data() + sizeof(header), header.size);
+    std::memcpy(&record[0], &header, sizeof(header));
+
+    archive_.reserve_id(id);
+    BOOST_TRY
+    {
+      const std::uint64_t offset = place(record.size());
+      archive_.write_at(record.data(), record.size(), offset, "append");
+      archive_.publish(id, offset, header.size);
+    }
+    BOOST_CATCH(...)
+    {
+      // Later records must not follow a gap in the segment.
+      used_ = archive_.segment_size_;
+      archive_.release_id(id);
+      BOOST_RETHROW;
+    }
+    BOOST_CATCH_END
+  }
+
+private:
+  Appender(const Appender&);
+  Appender& operator=(const Appender&);
+
+  std::uint64_t
+  place(std::uint64_t length)
+  {
+    const std::uint64_t segment_size = archive_.segment_size_;
+    if (length > segment_size)
+    { return archive_.reserve_segments(archive_.segments_for(length)); }
+
+    if (length > segment_size - used_)
+    {
+      segment_ = archive_.reserve_segments(1);
+      used_ = 0;
+    }
+    used_ += length;
+    return segment_ + used_ - length;
+  }
+
+private:
+  ScanArchive& archive_;
+  std::uint64_t segment_;
+  std::uint64_t used_;
+};
+
+// NOTE: The constructor and destructor are defined here, since they
+//   need the complete type of Appender.
+inline
+ScanArchive::ScanArchive(const std::string& path, size_type segment_size)
+  : path_(path), read_only_(false),
+    fd_(::open(path.c_str(), O_RDWR | O_CREAT, 0644)),
+    segment_size_(std::max(segment_size, 2 * sizeof(detail::record_header))),
+    next_segment_(0), index_(), index_mutex_(), shared_appender_(),
+    append_mutex_()
+{
+  BOOST_TRY { open(); }
+  BOOST_CATCH(...)
+  {
+    if (fd_ != -1) ::close(fd_);
+    BOOST_RETHROW;
+  }
+  BOOST_CATCH_END
+}
+
+inline
+ScanArchive::ScanArchive(const std::string& path, mode_type mode)
+  : path_(path), read_only_(mode == read_only),
+    fd_(::open(path.c_str(), read_only_ ? O_RDONLY : O_RDWR | O_CREAT,
+               0644)),
+    segment_size_(default_segment_size), next_segment_(0), index_(),
+    index_mutex_(), shared_appender_(), append_mutex_()
+{
+  BOOST_TRY { open(); }
+  BOOST_CATCH(...)
+  {
+    if (fd_ != -1) ::close(fd_);
+    BOOST_RETHROW;
+  }
+  BOOST_CATCH_END
+}
+
+// NOTE: Closing the file also releases the lock.
+inline
+ScanArchive::~ScanArchive()
+{ ::close(fd_); }
+
+inline void
+ScanArchive::append(point_type id, const Coll& coll)
+{
+  std::lock_guard<std::mutex> lock(append_mutex_);
+  if (!shared_appender_) shared_appender_.reset(new Appender(*this));
+  shared_appender_->append(id, coll);
+}
+#endif // SLHAEA_HAS_CXX11 && SLHAEA_HAS_POSIX
+
+} // namespace SLHAea
+
+#endif // SLHAEA_ARCHIVE_H
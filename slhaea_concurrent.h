@@ -0,0 +1,669 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// write_many() and ConcurrentWriter, which write SLHA output from
+// several threads. Both need a C++11 compiler.
+
+#ifndef SLHAEA_CONCURRENT_H
+#define SLHAEA_CONCURRENT_H
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "slhaea.h"
+
+#ifdef SLHAEA_HAS_CXX11
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifdef SLHAEA_HAS_POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SLHAea {
+
+#ifdef SLHAEA_HAS_CXX11
+namespace detail {
+
+template<class T>
+class blocking_queue
+{
+public:
+  explicit
+  blocking_queue(std::size_t capacity)
+    : capacity_(capacity), closed_(false) {}
+
+  void
+  push(T&& item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    queue_.push_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  bool
+  pop(T& item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+    if (queue_.empty()) return false;
+
+    item = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void
+  close()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+private:
+  std::deque<T> queue_;
+  std::size_t capacity_;
+  bool closed_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+inline const Coll&
+coll_ref(const Coll& coll)
+{ return coll; }
+
+inline const Coll&
+coll_ref(const Coll* coll)
+{ return *coll; }
+
+// Writes content to a temporary file in the directory of path and
+// renames it to path afterwards. Where mkstemp() is available the
+// temporary file has a unique name, the data is flushed to disk with
+// fsync() before the rename and the directory is synced afterwards.
+// Otherwise path + tmp_suffix is used as temporary file.
+inline void
+write_file_atomically(const std::string& path, const std::string& content,
+                      const std::string& tmp_suffix)
+{
+#ifdef SLHAEA_HAS_POSIX
+  static_cast<void>(tmp_suffix);
+  const std::string::size_type slash = path.rfind('/');
+  const std::string dir = slash == std::string::npos ? std::string(".") :
+    slash == 0 ? std::string("/") : path.substr(0, slash);
+
+  std::vector<char> tmp_name(path.begin(), slash == std::string::npos ?
+                             path.begin() : path.begin() + slash + 1);
+  const char tmp_template[] = ".slhaea-XXXXXX";
+  tmp_name.insert(tmp_name.end(), tmp_template,
+                  tmp_template + sizeof(tmp_template));
+
+  const int fd = ::mkstemp(&tmp_name[0]);
+  bool ok = fd != -1;
+
+  // mkstemp() creates the file with mode 0600, so that the mode of an
+  // existing file is kept and new files are readable by everyone.
+  struct stat old_stat;
+  const mode_t mode = ::stat(path.c_str(), &old_stat) == 0 ?
+    (old_stat.st_mode & 07777) : mode_t(0644);
+  ok = ok && ::fchmod(fd, mode) == 0;
+
+  std::size_t written = 0;
+  while (ok && written < content.size())
+  {
+    const ssize_t n = ::write(fd, content.data() + written,
+                              content.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    ok = n > 0;
+    if (ok) written += static_cast<std::size_t>(n);
+  }
+  ok = ok && ::fsync(fd) == 0;
+  if (fd != -1) ok = (::close(fd) == 0) && ok;
+  ok = ok && std::rename(&tmp_name[0], path.c_str()) == 0;
+
+  if (ok)
+  {
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY);
+    ok = dir_fd != -1 && ::fsync(dir_fd) == 0;
+    if (dir_fd != -1) ::close(dir_fd);
+  }
+  else if (fd != -1)
+  { std::remove(&tmp_name[0]); }
+#else
+  const std::string tmp_path = path + tmp_suffix;
+  std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+  bool ok = file != 0;
+
+  if (ok)
+  {
+    ok = std::fwrite(content.data(), 1, content.size(), file) ==
+      content.size();
+    ok = (std::fclose(file) == 0) && ok;
+  }
+  ok = ok && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+  if (!ok) std::remove(tmp_path.c_str());
+#endif
+
+  if (!ok)
+  { detail::throw_runtime_error("SLHAea::write_many(‘" + path + "’)"); }
+}
+
+} // namespace detail
+
+
+/**
+ * \brief Writes many Colls to files in parallel.
+ * \param first, last Input iterators to the initial and final
+ *   positions in a sequence of (path, Coll) pairs.
+ * \param format_threads Number of threads that convert the Colls to
+ *   text. If zero, one thread per hardware thread is used.
+ * \param io_threads Number of threads that write the files. If zero,
+ *   four threads are used.
+ * \throw std::runtime_error If a file could not be written.
+ *
+ * This function writes every Coll in the range [\p first, \p last)
+ * to the file whose path is given by the corresponding pair. The
+ * second element of the pairs can be a Coll, a pointer to a Coll, or
+ * a \c std::reference_wrapper of a Coll. The Colls are converted to
+ * text by a pool of worker threads into buffers that are reused for
+ * subsequent files. The buffers are then handed over to a separate
+ * pool of threads that write them to disk. Every file is first
+ * written to a uniquely named temporary file (see \c mkstemp()) in
+ * the same directory, which is flushed to disk with \c fsync() and
+ * then renamed to its final path, so that a file is either completely
+ * written or not touched at all, also after a system crash. Existing
+ * files keep their permissions, new files get mode 0644.
+ *
+ * If writing a file fails, no further files are started and the
+ * first error is thrown after all threads have been joined.
+ */
+template<class InputIterator> void
+write_many(InputIterator first, InputIterator last,
+           unsigned int format_threads = 0, unsigned int io_threads = 0)
+{
+  std::vector<std::pair<std::string, const Coll*> > jobs;
+  for (; first != last; ++first)
+  {
+    jobs.push_back(std::make_pair(std::string(first->first),
+                                  &detail::coll_ref(first->second)));
+  }
+  if (jobs.empty()) return;
+
+  if (format_threads == 0)
+  { format_threads = std::max(1u, std::thread::hardware_concurrency()); }
+  if (io_threads == 0) io_threads = 4;
+
+  typedef std::pair<std::size_t, std::string> formatted_type;
+  detail::blocking_queue<formatted_type> formatted(2 * io_threads);
+
+  std::vector<std::string> free_buffers;
+  std::mutex buffers_mutex;
+
+  std::atomic<std::size_t> next_job(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto record_error = [&] {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) error = std::current_exception();
+    failed = true;
+  };
+
+  auto format = [&] {
+    BOOST_TRY
+    {
+      for (std::size_t i = next_job++; i < jobs.size() && !failed;
+           i = next_job++)
+      {
+        std::string buffer;
+        {
+          std::lock_guard<std::mutex> lock(buffers_mutex);
+          if (!free_buffers.empty())
+          {
+            buffer.swap(free_buffers.back());
+            free_buffers.pop_back();
+          }
+        }
+
+        const Coll& coll = *jobs[i].second;
+        for (Coll::const_iterator block = coll.begin();
+             block != coll.end(); ++block)
+        {
+          for (Block::const_iterator line = block->begin();
+               line != block->end(); ++line)
+          {
+            buffer += line->str();
+            buffer += '\n';
+          }
+        }
+        formatted.push(formatted_type(i, std::move(buffer)));
+      }
+    }
+    BOOST_CATCH(...) { record_error(); }
+    BOOST_CATCH_END
+  };
+
+  auto write = [&](unsigned int id) {
+    const std::string tmp_suffix = ".tmp" + to_string(id);
+    formatted_type item;
+    while (formatted.pop(item))
+    {
+      BOOST_TRY
+      {
+        if (!failed)
+        {
+          detail::write_file_atomically(jobs[item.first].first,
+                                        item.second, tmp_suffix);
+        }
+      }
+      BOOST_CATCH(...) { record_error(); }
+      BOOST_CATCH_END
+
+      item.second.clear();
+      std::lock_guard<std::mutex> lock(buffers_mutex);
+      free_buffers.push_back(std::move(item.second));
+    }
+  };
+
+  std::vector<std::thread> writers;
+  for (unsigned int i = 0; i < io_threads; ++i)
+  { writers.push_back(std::thread(write, i)); }
+
+  std::vector<std::thread> formatters;
+  for (unsigned int i = 0; i < format_threads; ++i)
+  { formatters.push_back(std::thread(format)); }
+
+  for (std::thread& t : formatters) t.join();
+  formatted.close();
+  for (std::thread& t : writers) t.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
+namespace detail {
+
+// Unbounded multi-producer single-consumer queue after D. Vyukov.
+// push() is wait-free and may be called from any thread; pop() must
+// only be called from one thread at a time. The node at tail_ is
+// always a stub whose value has already been consumed. The links
+// between nodes are sequentially consistent, so that a consumer that
+// announces that it is going to sleep cannot miss a push.
+template<class T>
+class mpsc_queue
+{
+public:
+  mpsc_queue() : head_(new node), tail_(head_.load()) {}
+
+  ~mpsc_queue()
+  {
+    T item;
+    while (pop(item)) {}
+    delete tail_;
+  }
+
+  void
+  push(T&& item)
+  {
+    node* n = new node(std::move(item));
+    node* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n);
+  }
+
+  bool
+  pop(T& item)
+  {
+    node* next = tail_->next.load();
+    if (next == 0) return false;
+
+    item = std::move(next->value);
+    delete tail_;
+    tail_ = next;
+    return true;
+  }
+
+  bool
+  empty() const
+  { return tail_->next.load() == 0; }
+
+private:
+  mpsc_queue(const mpsc_queue&);
+  mpsc_queue& operator=(const mpsc_queue&);
+
+  struct node
+  {
+    node() : next(0) {}
+    explicit node(T&& v) : next(0), value(std::move(v)) {}
+
+    std::atomic<node*> next;
+    T value;
+  };
+
+  std::atomic<node*> head_;
+  node* tail_;
+};
+
+} // namespace detail
+
+
+/**
+ * Writes Blocks that are submitted concurrently by many threads to
+ * one output stream.
+ *
+ * Producer threads hand fully built Blocks or pre-serialized block
+ * text to submit(). Blocks are converted to text in the submitting
+ * thread and passed through a lock-free queue to a single writer
+ * thread that owns the output stream. At most \c capacity blocks are
+ * in flight at any time; submit() blocks while that limit is reached.
+ *
+ * By default blocks are written in the order in which they arrive.
+ * If a list of block names (e.g. the PDG codes of DECAY blocks) is
+ * given, blocks with these names are written in this order instead,
+ * and blocks whose name is not in the list are written as soon as
+ * they arrive. If all in-flight blocks are waiting for a block that
+ * has not been submitted yet, the writer gives up waiting for it and
+ * continues with the next block in the list, so that producers never
+ * deadlock. Names are compared case-insensitively.
+ *
+ * submit() must not be called concurrently with or after close().
+ */
+class ConcurrentWriter
+{
+public:
+  /**
+   * \brief Constructs a %ConcurrentWriter that writes blocks in the
+   *   order in which they are submitted.
+   * \param os Output stream the blocks are written to.
+   * \param capacity Maximal number of blocks in flight.
+   */
+  explicit
+  ConcurrentWriter(std::ostream& os, std::size_t capacity = 1024)
+    : os_(os), capacity_(std::max<std::size_t>(capacity, 1))
+  { start(); }
+
+  /**
+   * \brief Constructs a %ConcurrentWriter that writes blocks in a
+   *   requested order.
+   * \param os Output stream the blocks are written to.
+   * \param order Names of the blocks in the order they are written.
+   * \param capacity Maximal number of blocks in flight.
+   */
+  ConcurrentWriter(std::ostream& os, const std::vector<std::string>& order,
+                   std::size_t capacity = 1024)
+    : os_(os), capacity_(std::max<std::size_t>(capacity, 1))
+  {
+    for (std::size_t i = 0; i < order.size(); ++i)
+    { ranks_.insert(std::make_pair(detail::to_upper_copy(order[i]), i)); }
+    start();
+  }
+
+  /** Writes all remaining blocks and stops the writer thread. */
+  ~ConcurrentWriter()
+  {
+    BOOST_TRY { close(); }
+    BOOST_CATCH(...) {}
+    BOOST_CATCH_END
+  }
+
+  /**
+   * \brief Submits a block for writing.
+   * \param block Block to be written.
+   *
+   * If \p block has no name, the name is taken from its block
+   * definition. This function is thread-safe.
+   */
+  void
+  submit(const Block& block)
+  {
+    std::string text;
+    for (Block::const_iterator line = block.begin(); line != block.end();
+         ++line)
+    {
+      text += line->str();
+      text += '\n';
+    }
+
+    std::string name = block.name();
+    if (name.empty())
+    {
+      Block::const_iterator def = block.find_block_def();
+      if (def != block.end() && def->size() > 1) name = (*def)[1];
+    }
+    enqueue(rank(name), std::move(text));
+  }
+
+  /**
+   * \brief Submits the text of a block for writing.
+   * \param text Serialized block. If it does not end with a newline,
+   *   one is appended.
+   *
+   * The name of the block is taken from the first block definition in
+   * \p text. This function is thread-safe.
+   */
+  void
+  submit(std::string text)
+  {
+    if (!text.empty() && text[text.size()-1] != '\n') text += '\n';
+
+    std::string name;
+    for (std::size_t pos = 0; pos < text.size() && name.empty();)
+    {
+      const std::size_t end = text.find('\n', pos);
+      const Line line(text.substr(pos, end - pos));
+      if (line.is_block_def() && line.size() > 1) name = line[1];
+      pos = end + 1;
+    }
+    enqueue(rank(name), std::move(text));
+  }
+
+  /**
+   * \brief Writes all remaining blocks and stops the writer thread.
+   * \throw std::runtime_error If writing to the output stream failed.
+   *
+   * Blocks that are still waiting for their predecessors in the
+   * requested order are written in that order. Calling close() more
+   * than once has no effect.
+   */
+  void
+  close()
+  {
+    if (!writer_.joinable()) return;
+
+    closed_.store(true);
+    wake_writer();
+    writer_.join();
+    os_.flush();
+
+    if (failed_ || !os_)
+    { detail::throw_runtime_error("SLHAea::ConcurrentWriter::close()"); }
+  }
+
+private:
+  ConcurrentWriter(const ConcurrentWriter&);
+  ConcurrentWriter& operator=(const ConcurrentWriter&);
+
+  typedef std::pair<std::size_t, std::string> item_type;
+
+  static const std::size_t unranked = std::size_t(-1);
+
+  std::size_t
+  rank(const std::string& name) const
+  {
+    if (ranks_.empty()) return unranked;
+    boost::unordered_map<std::string, std::size_t>::const_iterator it =
+      ranks_.find(detail::to_upper_copy(name));
+    return it != ranks_.end() ? it->second : std::size_t(unranked);
+  }
+
+  void
+  start()
+  {
+    in_flight_.store(0);
+    waiting_producers_.store(0);
+    writer_waiting_.store(false);
+    closed_.store(false);
+    failed_ = false;
+    next_rank_ = 0;
+    writer_ = std::thread(&ConcurrentWriter::run, this);
+  }
+
+  // Reserves one of the capacity_ slots. Producers only take the
+  // mutex if the queue is full.
+  void
+  acquire_slot()
+  {
+    std::size_t n = in_flight_.load();
+    for (;;)
+    {
+      if (n < capacity_)
+      {
+        if (in_flight_.compare_exchange_weak(n, n + 1)) return;
+        continue;
+      }
+
+      ++waiting_producers_;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return in_flight_ < capacity_; });
+      }
+      --waiting_producers_;
+      n = in_flight_.load();
+    }
+  }
+
+  void
+  release_slot()
+  {
+    --in_flight_;
+    if (waiting_producers_.load() > 0)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      not_full_.notify_all();
+    }
+  }
+
+  void
+  enqueue(std::size_t rank, std::string&& text)
+  {
+    acquire_slot();
+    queue_.push(item_type(rank, std::move(text)));
+    if (writer_waiting_.load()) wake_writer();
+  }
+
+  void
+  wake_writer()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    not_empty_.notify_one();
+  }
+
+  void
+  write(const std::string& text)
+  {
+    if (!failed_)
+    {
+      os_.write(text.data(), static_cast<std::streamsize>(text.size()));
+      failed_ = !os_;
+    }
+    release_slot();
+  }
+
+  // Writes the pending blocks whose predecessors have been written.
+  void
+  write_ready()
+  {
+    while (!pending_.empty() && pending_.begin()->first <= next_rank_)
+    {
+      const std::size_t rank = pending_.begin()->first;
+      write(pending_.begin()->second);
+      pending_.erase(pending_.begin());
+      if (rank == next_rank_) ++next_rank_;
+    }
+  }
+
+  void
+  handle(item_type& item)
+  {
+    if (item.first == unranked || item.first < next_rank_)
+    {
+      write(item.second);
+      return;
+    }
+
+    pending_.insert(std::make_pair(item.first, std::string()))->second.swap(
+      item.second);
+
+    // If every slot is taken by a pending block, no producer can make
+    // progress, so stop waiting for the blocks that are missing.
+    if (pending_.size() >= capacity_)
+    { next_rank_ = pending_.begin()->first; }
+    write_ready();
+  }
+
+  void
+  run()
+  {
+    item_type item;
+    for (;;)
+    {
+      while (queue_.pop(item)) handle(item);
+
+      if (closed_.load())
+      {
+        if (!queue_.empty()) continue;
+        for (; !pending_.empty(); pending_.erase(pending_.begin()))
+        { write(pending_.begin()->second); }
+        return;
+      }
+
+      writer_waiting_.store(true);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] {
+          return !queue_.empty() || closed_.load(); });
+      }
+      writer_waiting_.store(false);
+    }
+  }
+
+private:
+  std::ostream& os_;
+  const std::size_t capacity_;
+  boost::unordered_map<std::string, std::size_t> ranks_;
+
+  detail::mpsc_queue<item_type> queue_;
+  std::atomic<std::size_t> in_flight_;
+  std::atomic<std::size_t> waiting_producers_;
+  std::atomic<bool> writer_waiting_;
+  std::atomic<bool> closed_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+
+  // Only accessed by the writer thread.
+  std::multimap<std::size_t, std::string> pending_;
+  std::size_t next_rank_;
+  bool failed_;
+
+  std::thread writer_;
+};
+#endif // SLHAEA_HAS_CXX11
+
+} // namespace SLHAea
+
+#endif // SLHAEA_CONCURRENT_H
@@ -0,0 +1,310 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// JsonWriter, which converts Blocks and Colls into JSON.
+
+#ifndef SLHAEA_JSON_H
+#define SLHAEA_JSON_H
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include "slhaea.h"
+
+namespace SLHAea {
+
+/**
+ * Streaming JSON writer for Blocks and Colls.
+ *
+ * A %JsonWriter writes Blocks as elements of one JSON array, in the
+ * order in which they are written:
+ *
+ * \code
+ * [{"name": "MASS", "def": ["BLOCK", "MASS"], "def_comment": "# masses",
+ *   "lines": [["25", "1.25E+02"], []],
+ *   "comments": [null, "# comment line"]}]
+ * \endcode
+ *
+ * \c "name" is the name of the Block, \c "def" contains the fields of
+ * the block definition and \c "lines" the data fields of all other
+ * Lines. The comment of the i-th Line is the i-th element of
+ * \c "comments" (or \c null if it has none) and the comment of the
+ * block definition is \c "def_comment", which is omitted if there is
+ * none. Blocks with the same name, e.g. the same BLOCK at different
+ * scales, are thus separate elements that can be told apart by their
+ * \c "def".
+ *
+ * If numeric output is enabled, every field of \c "def" and
+ * \c "lines" that is a number is written as a JSON number. This also
+ * applies to block names that are numbers, like the PDG code of a
+ * DECAY block, while \c "name" is always a string. Fields that are
+ * valid JSON numbers are copied verbatim. Fortran-style numbers (like
+ * \c "+1", \c "1." or \c "1.0D+02") are rewritten into \c "1",
+ * \c "1.0" or \c "1.0E+02" and are written as numbers only if the
+ * result is a valid JSON number. All other fields, e.g. \c "BLOCK",
+ * \c "inf" or \c "0x1A", are written as strings. The fields are
+ * written directly from the Lines into the output, no intermediate
+ * representation is built.
+ */
+class JsonWriter
+{
+public:
+  /**
+   * \brief Constructs a %JsonWriter that writes to an output stream.
+   * \param os Output stream the %JsonWriter writes to.
+   * \param numeric If true, numeric fields are written as numbers.
+   */
+  explicit
+  JsonWriter(std::ostream& os, bool numeric = false)
+    : os_(&os), buffer_(0), numeric_(numeric), blocks_(0), closed_(false)
+  { write("[", 1); }
+
+  /**
+   * \brief Constructs a %JsonWriter that appends to a string.
+   * \param buffer String the %JsonWriter appends to.
+   * \param numeric If true, numeric fields are written as numbers.
+   */
+  explicit
+  JsonWriter(std::string& buffer, bool numeric = false)
+    : os_(0), buffer_(&buffer), numeric_(numeric), blocks_(0),
+      closed_(false)
+  { write("[", 1); }
+
+  /** Closes the JSON array. */
+  ~JsonWriter()
+  { close(); }
+
+  /**
+   * \brief Writes a Block.
+   * \param block Block that is written.
+   * \return Reference to \c *this.
+   */
+  JsonWriter&
+  block(const Block& block)
+  {
+    if (blocks_++ > 0) write(",\n ", 3);
+    write("{\"name\": ", 9);
+    put_string(block.name());
+    write(", \"def\": [", 10);
+
+    std::string def_comment;
+    Block::const_iterator line = block.begin();
+    if (line != block.end() && line->is_block_def())
+    {
+      for (Line::const_iterator field = line->begin();
+           field != line->end(); ++field)
+      {
+        if ((*field)[0] == '#') def_comment = *field;
+        else put_field(*field, field != line->begin(), numeric_);
+      }
+      ++line;
+    }
+    write("]", 1);
+
+    if (!def_comment.empty())
+    {
+      write(", \"def_comment\": ", 17);
+      put_string(def_comment);
+    }
+
+    write(", \"lines\": [", 12);
+    const Block::const_iterator first_line = line;
+    for (Block::const_iterator it = first_line; it != block.end(); ++it)
+    {
+      if (it != first_line) write(", ", 2);
+      write("[", 1);
+      for (Line::const_iterator field = it->begin(); field != it->end();
+           ++field)
+      {
+        if ((*field)[0] == '#') break;
+        put_field(*field, field != it->begin(), numeric_);
+      }
+      write("]", 1);
+    }
+
+    write("], \"comments\": [", 16);
+    for (Block::const_iterator it = first_line; it != block.end(); ++it)
+    {
+      if (it != first_line) write(", ", 2);
+      if (!it->empty() && it->back()[0] == '#') put_string(it->back());
+      else write("null", 4);
+    }
+    write("]}", 2);
+    return *this;
+  }
+
+  /**
+   * \brief Writes all Blocks of a Coll.
+   * \param coll Coll whose Blocks are written.
+   * \return Reference to \c *this.
+   */
+  JsonWriter&
+  coll(const Coll& coll)
+  {
+    for (Coll::const_iterator it = coll.begin(); it != coll.end(); ++it)
+    { block(*it); }
+    return *this;
+  }
+
+  /**
+   * \brief Closes the JSON array.
+   *
+   * No Blocks can be written after the array has been closed.
+   * Calling close() more than once has no effect.
+   */
+  void
+  close()
+  {
+    if (closed_) return;
+    write("]\n", 2);
+    closed_ = true;
+  }
+
+private:
+  // NOTE: A %JsonWriter refers to a stream or string that it does not
+  //   own, so it must not be copied.
+  JsonWriter(const JsonWriter&);
+  JsonWriter& operator=(const JsonWriter&);
+
+  void
+  put_field(const std::string& field, bool separator, bool numeric)
+  {
+    if (separator) write(", ", 2);
+    if (!numeric) put_string(field);
+    else if (is_json_number(field)) write(field.data(), field.size());
+    else put_number(field);
+  }
+
+  void
+  put_number(const std::string& field)
+  {
+    std::string number = field;
+    std::replace(number.begin(), number.end(), 'D', 'E');
+    std::replace(number.begin(), number.end(), 'd', 'e');
+
+    std::string::size_type i = 0;
+    if (number[0] == '+') number.erase(0, 1);
+    else if (number[0] == '-') i = 1;
+
+    // Strip leading zeros and add the digits that JSON requires
+    // around the decimal point.
+    while (number.size() > i + 1 && number[i] == '0' &&
+           number[i+1] >= '0' && number[i+1] <= '9') number.erase(i, 1);
+    if (number.size() > i && number[i] == '.') number.insert(i, 1, '0');
+
+    const std::string::size_type point = number.find('.', i);
+    if (point != std::string::npos && (point + 1 == number.size() ||
+        number[point+1] < '0' || number[point+1] > '9'))
+    { number.insert(point + 1, 1, '0'); }
+
+    if (is_json_number(number)) write(number.data(), number.size());
+    else put_string(field);
+  }
+
+  void
+  put_string(const std::string& str)
+  {
+    static const char hex[] = "0123456789abcdef";
+
+    write("\"", 1);
+    std::string::size_type begin = 0;
+    for (std::string::size_type i = 0; i < str.size(); ++i)
+    {
+      const unsigned char c = static_cast<unsigned char>(str[i]);
+      if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+      write(str.data() + begin, i - begin);
+      begin = i + 1;
+
+      char escape[6] = { '\\', static_cast<char>(c), 0, 0, 0, 0 };
+      std::size_t length = 2;
+      switch (c)
+      {
+        case '"': case '\\': break;
+        case '\t': escape[1] = 't'; break;
+        case '\n': escape[1] = 'n'; break;
+        case '\r': escape[1] = 'r'; break;
+        default:
+          escape[1] = 'u';
+          escape[2] = escape[3] = '0';
+          escape[4] = hex[c >> 4];
+          escape[5] = hex[c & 0xf];
+          length = 6;
+      }
+      write(escape, length);
+    }
+    write(str.data() + begin, str.size() - begin);
+    write("\"", 1);
+  }
+
+  // Checks the JSON number grammar:
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  static bool
+  is_json_number(const std::string& field)
+  {
+    const char* it = field.c_str();
+    if (*it == '-') ++it;
+
+    if (*it == '0') ++it;
+    else if (!skip_digits(it)) return false;
+
+    if (*it == '.')
+    {
+      ++it;
+      if (!skip_digits(it)) return false;
+    }
+    if (*it == 'e' || *it == 'E')
+    {
+      ++it;
+      if (*it == '+' || *it == '-') ++it;
+      if (!skip_digits(it)) return false;
+    }
+    return *it == '\0';
+  }
+
+  static bool
+  skip_digits(const char*& it)
+  {
+    const char* const first = it;
+    while (*it >= '0' && *it <= '9') ++it;
+    return it != first;
+  }
+
+  void
+  write(const char* str, std::size_t length)
+  {
+    if (buffer_) buffer_->append(str, length);
+    else os_->write(str, static_cast<std::streamsize>(length));
+  }
+
+private:
+  std::ostream* os_;
+  std::string* buffer_;
+  bool numeric_;
+  std::size_t blocks_;
+  bool closed_;
+};
+
+
+/**
+ * \brief Converts a Coll into JSON.
+ * \param coll Coll that is converted.
+ * \param numeric If true, numeric fields are written as numbers.
+ * \return JSON representation of \p coll.
+ * \sa JsonWriter
+ */
+inline std::string
+to_json(const Coll& coll, bool numeric = false)
+{
+  std::string result;
+  JsonWriter(result, numeric).coll(coll);
+  return result;
+}
+
+} // namespace SLHAea
+
+#endif // SLHAEA_JSON_H
@@ -0,0 +1,397 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// ShardedColl, a read-only Coll for documents with very many Blocks.
+// It is not part of slhaea.h since its parallel read() needs <thread>.
+
+#ifndef SLHAEA_SHARDED_H
+#define SLHAEA_SHARDED_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "slhaea.h"
+
+#ifdef SLHAEA_HAS_CXX11
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace SLHAea {
+
+/**
+ * Read-only container of Blocks that are partitioned into shards by
+ * their name.
+ *
+ * A %ShardedColl is meant for documents with very many Blocks, such
+ * as merged decay databases. Every Block is stored in one of several
+ * shards, chosen by a hash of its (case-insensitive) name, so that all
+ * Blocks with the same name are in the same shard. Each shard is a
+ * Coll of its own together with a hash index of the names of its
+ * Blocks. A global ordering vector records the shard and position of
+ * every Block in document order, which is the order of iteration and
+ * of str().
+ *
+ * read() first locates the Blocks in the input with a cheap scan and
+ * then parses the shards and builds their indices in parallel, one
+ * shard per task. Without C++11 the shards are processed one after
+ * another.
+ *
+ * The Blocks are only accessible read-only, since renaming a Block
+ * would invalidate the index of its shard.
+ */
+class ShardedColl
+{
+public:
+  typedef Coll::value_type      value_type;
+  typedef Coll::const_reference const_reference;
+  typedef Coll::size_type       size_type;
+  typedef Coll::key_type        key_type;
+
+  /** Random access iterator over the Blocks in document order. */
+  class const_iterator
+    : public boost::iterator_facade<const_iterator, const value_type,
+        boost::random_access_traversal_tag>
+  {
+  public:
+    const_iterator() : coll_(0), index_(0) {}
+
+    const_iterator(const ShardedColl* coll, size_type index)
+      : coll_(coll), index_(index) {}
+
+  private:
+    friend class boost::iterator_core_access;
+
+    const value_type&
+    dereference() const
+    {
+      const position& where = coll_->order_[index_];
+      return coll_->shards_[where.first].blocks.begin()[where.second];
+    }
+
+    bool
+    equal(const const_iterator& other) const
+    { return index_ == other.index_; }
+
+    void
+    increment()
+    { ++index_; }
+
+    void
+    decrement()
+    { --index_; }
+
+    void
+    advance(std::ptrdiff_t n)
+    { index_ += n; }
+
+    std::ptrdiff_t
+    distance_to(const const_iterator& other) const
+    {
+      return static_cast<std::ptrdiff_t>(other.index_) -
+             static_cast<std::ptrdiff_t>(index_);
+    }
+
+  private:
+    const ShardedColl* coll_;
+    size_type index_;
+  };
+
+  /**
+   * \brief Constructs an empty %ShardedColl.
+   * \param shards Number of shards. If zero, one shard is used.
+   */
+  explicit
+  ShardedColl(size_type shards = 16)
+    : shards_(std::max<size_type>(shards, 1)) {}
+
+  /**
+   * \brief Adds content from a memory buffer to the %ShardedColl.
+   * \param first, last Pointers to the initial and final positions of
+   *   the buffer.
+   * \param threads Number of threads that parse the shards. If zero,
+   *   one thread per hardware thread is used.
+   * \returns Reference to \c *this.
+   *
+   * The Blocks are parsed like by Coll::read(const char*, const
+   * char*) and are appended to the %ShardedColl.
+   */
+  ShardedColl&
+  read(const char* first, const char* last, unsigned int threads = 0)
+  {
+    std::vector<std::vector<block_range> > jobs(shards_.size());
+    std::vector<std::size_t> shard_sizes(shards_.size());
+    for (size_type s = 0; s < shards_.size(); ++s)
+    { shard_sizes[s] = shards_[s].blocks.size(); }
+
+    block_range* range = 0;
+    bool block_def = false;
+    for (const char* line = first; line != last;)
+    {
+      const char* line_end = std::find(line, last, '\n');
+      if (detail::count_fields(line, line_end, block_def) != 0 &&
+          (block_def || range == 0))
+      {
+        const std::string name = block_def ?
+          Line(std::string(line, line_end))[1] : std::string();
+        const size_type s = shard_of(name);
+
+        jobs[s].push_back(block_range());
+        range = &jobs[s].back();
+        range->first = line;
+        range->position = order_.size();
+        order_.push_back(position(s, shard_sizes[s]++));
+      }
+      line = (line_end == last) ? last : line_end + 1;
+      if (range) range->last = line;
+    }
+
+    parse_shards(jobs, threads);
+    return *this;
+  }
+
+  /**
+   * \brief Adds content from an input stream to the %ShardedColl.
+   * \param is Input stream to read content from.
+   * \param threads Number of threads that parse the shards. If zero,
+   *   one thread per hardware thread is used.
+   * \returns Reference to \c *this.
+   *
+   * The whole content of \p is is read into memory first.
+   */
+  ShardedColl&
+  read(std::istream& is, unsigned int threads = 0)
+  {
+    const std::string buffer((std::istreambuf_iterator<char>(is)),
+                             std::istreambuf_iterator<char>());
+    return read(buffer.data(), buffer.data() + buffer.size(), threads);
+  }
+
+  /**
+   * \brief Appends a Block to the %ShardedColl.
+   * \param block Block that is appended.
+   */
+  void
+  push_back(const value_type& block)
+  {
+    const size_type s = shard_of(block.name());
+    shard& target = shards_[s];
+
+    target.index[detail::to_upper_copy(block.name())].push_back(
+      order_.size());
+    order_.push_back(position(s, target.blocks.size()));
+    target.blocks.push_back(block);
+  }
+
+  /**
+   * \brief Locates a Block in the %ShardedColl.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) reference to the first Block with
+   *   the name \p blockName.
+   * \throw std::out_of_range If no Block has the name \p blockName.
+   */
+  const_reference
+  at(const key_type& blockName) const
+  {
+    const_iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    detail::throw_out_of_range("SLHAea::ShardedColl::at(‘" + blockName +
+                            "’)");
+  }
+
+  /**
+   * \brief Accesses a single field in the %ShardedColl.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read-only (constant) reference to the field referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing field.
+   */
+  Line::const_reference
+  field(const Key& key) const
+  { return at(key.block).at(key.line).at(key.field); }
+
+  /**
+   * \brief Tries to locate a Block in the %ShardedColl.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) iterator to the first Block with the
+   *   name \p blockName or end() if there is none.
+   *
+   * Only the index of a single shard is consulted.
+   */
+  const_iterator
+  find(const key_type& blockName) const
+  {
+    const positions_type* positions = lookup(blockName);
+    return positions ? const_iterator(this, positions->front()) : end();
+  }
+
+  /**
+   * \brief Counts all Blocks with a given name.
+   * \param blockName Name of the Blocks that will be counted.
+   */
+  size_type
+  count(const key_type& blockName) const
+  {
+    const positions_type* positions = lookup(blockName);
+    return positions ? positions->size() : 0;
+  }
+
+  /** Returns a read-only (constant) iterator to the first Block. */
+  const_iterator
+  begin() const
+  { return const_iterator(this, 0); }
+
+  /** Returns a read-only (constant) iterator past the last Block. */
+  const_iterator
+  end() const
+  { return const_iterator(this, order_.size()); }
+
+  /** Returns the number of Blocks in the %ShardedColl. */
+  size_type
+  size() const
+  { return order_.size(); }
+
+  /** Returns true if the %ShardedColl contains no Blocks. */
+  bool
+  empty() const
+  { return order_.empty(); }
+
+  /** Returns the number of shards. */
+  size_type
+  shard_count() const
+  { return shards_.size(); }
+
+  /**
+   * \brief Returns the Blocks of a shard.
+   * \param n Index of the shard.
+   */
+  const Coll&
+  shard_blocks(size_type n) const
+  { return shards_.at(n).blocks; }
+
+  /** Erases all Blocks. */
+  void
+  clear()
+  {
+    for (std::vector<shard>::iterator s = shards_.begin(); s != shards_.end();
+         ++s)
+    {
+      s->blocks.clear();
+      s->index.clear();
+    }
+    order_.clear();
+  }
+
+  /** Returns a string representation of the Blocks in document order. */
+  std::string
+  str() const
+  {
+    std::string result;
+    for (const_iterator block = begin(); block != end(); ++block)
+    { result += block->str(); }
+    return result;
+  }
+
+private:
+  typedef std::pair<size_type, size_type> position;
+  typedef std::vector<size_type> positions_type;
+
+  struct shard
+  {
+    Coll blocks;
+    boost::unordered_map<std::string, positions_type> index;
+  };
+
+  struct block_range
+  {
+    const char* first;
+    const char* last;
+    size_type position;
+  };
+
+  size_type
+  shard_of(const std::string& name) const
+  {
+    const std::size_t hash =
+      boost::hash<std::string>()(detail::to_upper_copy(name));
+    return hash % shards_.size();
+  }
+
+  const positions_type*
+  lookup(const key_type& blockName) const
+  {
+    const shard& s = shards_[shard_of(blockName)];
+    boost::unordered_map<std::string, positions_type>::const_iterator it =
+      s.index.find(detail::to_upper_copy(blockName));
+    return it != s.index.end() ? &it->second : 0;
+  }
+
+  void
+  parse_shard(size_type s, const std::vector<block_range>& ranges)
+  {
+    shard& target = shards_[s];
+    for (std::vector<block_range>::const_iterator range = ranges.begin();
+         range != ranges.end(); ++range)
+    {
+      target.blocks.read(range->first, range->last);
+      target.index[detail::to_upper_copy(target.blocks.back().name())]
+        .push_back(range->position);
+    }
+  }
+
+  void
+  parse_shards(const std::vector<std::vector<block_range> >& jobs,
+               unsigned int threads)
+  {
+#ifdef SLHAEA_HAS_CXX11
+    if (threads == 0)
+    { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    threads = std::min<unsigned int>(threads, jobs.size());
+
+    std::atomic<size_type> next_shard(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto parse = [&] {
+      BOOST_TRY
+      {
+        for (size_type s = next_shard++; s < jobs.size(); s = next_shard++)
+        { parse_shard(s, jobs[s]); }
+      }
+      BOOST_CATCH(...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+      }
+      BOOST_CATCH_END
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i)
+    { workers.push_back(std::thread(parse)); }
+    parse();
+    for (std::thread& t : workers) t.join();
+
+    if (error) std::rethrow_exception(error);
+#else
+    (void) threads;
+    for (size_type s = 0; s < jobs.size(); ++s) parse_shard(s, jobs[s]);
+#endif
+  }
+
+private:
+  std::vector<shard> shards_;
+  std::vector<position> order_;
+};
+
+} // namespace SLHAea
+
+#endif // SLHAEA_SHARDED_H
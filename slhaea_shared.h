@@ -0,0 +1,772 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// SharedColl, a read-only Coll in a POSIX shared memory segment that
+// can be attached by many processes.
+
+#ifndef SLHAEA_SHARED_H
+#define SLHAEA_SHARED_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/utility/string_ref.hpp>
+#include "slhaea.h"
+
+#ifdef SLHAEA_HAS_CXX11
+#include <atomic>
+#endif
+
+#ifdef SLHAEA_HAS_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SLHAea {
+
+#ifdef SLHAEA_HAS_POSIX
+namespace detail {
+
+struct shared_header
+{
+  char magic[8];
+  std::size_t size;
+  std::size_t block_count;
+  std::size_t line_count;
+  std::size_t field_count;
+};
+
+struct shared_string
+{
+  std::size_t offset;
+  std::size_t length;
+};
+
+struct shared_block
+{
+  shared_string name;
+  std::size_t first_line;
+  std::size_t line_count;
+};
+
+struct shared_line
+{
+  shared_string text;
+  std::size_t first_field;
+  std::size_t field_count;
+};
+
+struct shared_layout
+{
+  shared_layout()
+    : header(0), blocks(0), lines(0), fields(0), chars(0) {}
+
+  explicit
+  shared_layout(const char* base)
+    : header(reinterpret_cast<const shared_header*>(base)),
+      blocks(reinterpret_cast<const shared_block*>(header + 1)),
+      lines(reinterpret_cast<const shared_line*>(
+        blocks + header->block_count)),
+      fields(reinterpret_cast<const shared_string*>(
+        lines + header->line_count)),
+      chars(reinterpret_cast<const char*>(fields + header->field_count)) {}
+
+  const shared_header* header;
+  const shared_block* blocks;
+  const shared_line* lines;
+  const shared_string* fields;
+  const char* chars;
+};
+
+// Orders the writes to a shared memory segment before the magic
+// number that publishes it, and the check of the magic number before
+// the reads of the content.
+inline void
+shared_fence()
+{
+#ifdef SLHAEA_HAS_CXX11
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#else
+  __sync_synchronize();
+#endif
+}
+
+inline boost::string_ref
+to_string_ref(const char* chars, const shared_string& str)
+{ return boost::string_ref(chars + str.offset, str.length); }
+
+template<class Container> typename Container::value_type
+element(const Container& cont, std::size_t index)
+{ return cont[index]; }
+
+template<class Container> typename Container::value_type
+element(const Container* cont, std::size_t index)
+{ return (*cont)[index]; }
+
+// NOTE: Views are stored by value in their iterators, since they are
+//   often temporaries (e.g. the result of SharedColl::at()).
+template<class Container, class Value>
+class index_iterator
+  : public boost::iterator_facade<index_iterator<Container, Value>, Value,
+      boost::random_access_traversal_tag, Value>
+{
+public:
+  index_iterator() : cont_(), index_(0) {}
+
+  index_iterator(const Container& cont, std::size_t index)
+    : cont_(cont), index_(index) {}
+
+private:
+  friend class boost::iterator_core_access;
+
+  Value
+  dereference() const
+  { return element(cont_, index_); }
+
+  bool
+  equal(const index_iterator& other) const
+  { return index_ == other.index_; }
+
+  void
+  increment()
+  { ++index_; }
+
+  void
+  decrement()
+  { --index_; }
+
+  void
+  advance(std::ptrdiff_t n)
+  { index_ += n; }
+
+  std::ptrdiff_t
+  distance_to(const index_iterator& other) const
+  {
+    return static_cast<std::ptrdiff_t>(other.index_) -
+           static_cast<std::ptrdiff_t>(index_);
+  }
+
+private:
+  Container cont_;
+  std::size_t index_;
+};
+
+} // namespace detail
+
+
+/**
+ * Read-only view of a Line that is stored in a SharedColl.
+ * This class provides the const interface of Line for a line that is
+ * stored in a shared memory segment. Its fields are returned as
+ * \c boost::string_ref objects that point directly into the segment.
+ */
+class SharedLine
+{
+public:
+  typedef boost::string_ref value_type;
+  typedef boost::string_ref const_reference;
+  typedef std::size_t       size_type;
+  typedef detail::index_iterator<SharedLine, value_type> const_iterator;
+  typedef const_iterator    iterator;
+
+  SharedLine() : layout_(0), line_(0) {}
+
+  SharedLine(const detail::shared_layout* layout,
+             const detail::shared_line* line)
+    : layout_(layout), line_(line) {}
+
+  /** Returns the formatted string representation of the %SharedLine. */
+  boost::string_ref
+  str() const
+  { return detail::to_string_ref(layout_->chars, line_->text); }
+
+  /** Returns a Line with the same content and formatting. */
+  Line
+  to_line() const
+  { return Line(str().to_string()); }
+
+  /**
+   * \brief Subscript access to the fields of the %SharedLine.
+   * \param n Index of the field which should be accessed.
+   * \return Reference to the field in the shared memory segment.
+   */
+  const_reference
+  operator[](size_type n) const
+  {
+    return detail::to_string_ref(layout_->chars,
+      layout_->fields[line_->first_field + n]);
+  }
+
+  /**
+   * \brief Provides access to the fields of the %SharedLine.
+   * \param n Index of the field which should be accessed.
+   * \return Reference to the field in the shared memory segment.
+   * \throw std::out_of_range If \p n is an invalid index.
+   */
+  const_reference
+  at(size_type n) const
+  {
+    if (n < size()) return (*this)[n];
+    detail::throw_out_of_range("SLHAea::SharedLine::at(‘" + to_string(n) +
+                            "’)");
+  }
+
+  /** Returns the first field of the %SharedLine. */
+  const_reference
+  front() const
+  { return (*this)[0]; }
+
+  /** Returns the last field of the %SharedLine. */
+  const_reference
+  back() const
+  { return (*this)[size() - 1]; }
+
+  /** Returns an iterator that points to the first field. */
+  const_iterator
+  begin() const
+  { return const_iterator(*this, 0); }
+
+  /** Returns an iterator that points one past the last field. */
+  const_iterator
+  end() const
+  { return const_iterator(*this, size()); }
+
+  /** \sa Line::is_block_def() */
+  bool
+  is_block_def() const
+  {
+    return size() > 1 && is_block_specifier(front()) &&
+      !is_comment((*this)[1]);
+  }
+
+  /** \sa Line::is_comment_line() */
+  bool
+  is_comment_line() const
+  { return !empty() && is_comment(front()); }
+
+  /** \sa Line::is_data_line() */
+  bool
+  is_data_line() const
+  { return !empty() && !is_comment(front()) && !is_block_specifier(front()); }
+
+  /** Returns the number of fields in the %SharedLine. */
+  size_type
+  size() const
+  { return line_->field_count; }
+
+  /** Returns true if the %SharedLine is empty. */
+  bool
+  empty() const
+  { return size() == 0; }
+
+private:
+  static bool
+  is_block_specifier(const value_type& field)
+  {
+    return boost::iequals(field, boost::string_ref("BLOCK")) ||
+           boost::iequals(field, boost::string_ref("DECAY"));
+  }
+
+  static bool
+  is_comment(const value_type& field)
+  { return !field.empty() && field[0] == '#'; }
+
+private:
+  const detail::shared_layout* layout_;
+  const detail::shared_line* line_;
+};
+
+
+/**
+ * Read-only view of a Block that is stored in a SharedColl.
+ * This class provides the const lookup interface of Block for a block
+ * that is stored in a shared memory segment.
+ */
+class SharedBlock
+{
+public:
+  typedef Block::key_type  key_type;
+  typedef SharedLine       value_type;
+  typedef SharedLine       const_reference;
+  typedef std::size_t      size_type;
+  typedef detail::index_iterator<SharedBlock, value_type> const_iterator;
+  typedef const_iterator   iterator;
+
+  SharedBlock() : layout_(0), block_(0) {}
+
+  SharedBlock(const detail::shared_layout* layout,
+              const detail::shared_block* block)
+    : layout_(layout), block_(block) {}
+
+  /** Returns the name of the %SharedBlock. */
+  boost::string_ref
+  name() const
+  { return detail::to_string_ref(layout_->chars, block_->name); }
+
+  /** Returns a Block with the same name and content. */
+  Block
+  to_block() const
+  {
+    Block block(name().to_string());
+    for (const_iterator line = begin(); line != end(); ++line)
+    { block.push_back(line->to_line()); }
+    return block;
+  }
+
+  /**
+   * \brief Subscript access to the Lines of the %SharedBlock.
+   * \param n Index of the Line which should be accessed.
+   * \return View of the accessed Line.
+   */
+  const_reference
+  operator[](size_type n) const
+  { return value_type(layout_, layout_->lines + block_->first_line + n); }
+
+  /**
+   * \brief Locates a Line in the %SharedBlock.
+   * \param key First strings of the Line to be located.
+   * \return View of the sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   * \sa Block::at()
+   */
+  const_reference
+  at(const key_type& key) const
+  {
+    const_iterator line = find(key);
+    if (line != end()) return *line;
+
+    detail::throw_out_of_range(
+      "SLHAea::SharedBlock::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /** Returns an iterator that points to the first Line. */
+  const_iterator
+  begin() const
+  { return const_iterator(*this, 0); }
+
+  /** Returns an iterator that points one past the last Line. */
+  const_iterator
+  end() const
+  { return const_iterator(*this, size()); }
+
+  /**
+   * \brief Tries to locate a Line in the %SharedBlock.
+   * \param key First strings of the Line to be located.
+   * \return Iterator pointing to sought-after element, or end() if not
+   *   found.
+   * \sa Block::find()
+   */
+  const_iterator
+  find(const key_type& key) const
+  { return std::find_if(begin(), end(), key_matches(key)); }
+
+  /**
+   * Returns an iterator that points to the first Line in the
+   * %SharedBlock which is a block definition, or end() if there is no
+   * such Line.
+   */
+  const_iterator
+  find_block_def() const
+  {
+    for (const_iterator line = begin(); line != end(); ++line)
+    { if (line->is_block_def()) return line; }
+    return end();
+  }
+
+  /** Counts all Lines that match a given key. */
+  size_type
+  count(const key_type& key) const
+  { return std::count_if(begin(), end(), key_matches(key)); }
+
+  /** Returns the number of Lines in the %SharedBlock. */
+  size_type
+  size() const
+  { return block_->line_count; }
+
+  /** Returns true if the %SharedBlock is empty. */
+  bool
+  empty() const
+  { return size() == 0; }
+
+  /** Unary predicate that checks if a provided key matches a Line. */
+  struct key_matches
+  {
+    explicit
+    key_matches(const key_type& key) : parts_(key.begin(), key.end()) {}
+
+    bool
+    operator()(const value_type& line) const
+    {
+      if (parts_.empty() || parts_.size() > line.size()) return false;
+
+      for (size_type i = 0; i < parts_.size(); ++i)
+      {
+        if (!parts_[i](line[i])) return false;
+      }
+      return true;
+    }
+
+  private:
+    std::vector<detail::key_pattern> parts_;
+  };
+
+private:
+  const detail::shared_layout* layout_;
+  const detail::shared_block* block_;
+};
+
+
+/**
+ * Read-only Coll in a POSIX shared memory segment.
+ * This class stores the content of a Coll in a shared memory segment
+ * that can be attached by any number of processes on the same host.
+ * Inside the segment, Blocks, Lines, and fields are represented by
+ * flat tables that refer to each other by offsets instead of
+ * pointers, so the segment can be mapped at any address. Attaching a
+ * segment neither parses nor copies its content, so the memory is
+ * only paid once per host.
+ *
+ * Segments are created with create() and removed with remove(). A
+ * %SharedColl attaches an existing segment and provides the const
+ * lookup interface of Coll (at(), find(), count(), block(), line(),
+ * field(), and iteration). Blocks and Lines are returned as the
+ * lightweight views SharedBlock and SharedLine and fields as
+ * \c boost::string_ref objects that point into the segment.
+ */
+class SharedColl
+{
+public:
+  typedef std::string  key_type;
+  typedef SharedBlock  value_type;
+  typedef SharedBlock  const_reference;
+  typedef std::size_t  size_type;
+  typedef detail::index_iterator<const SharedColl*, value_type>
+    const_iterator;
+  typedef const_iterator iterator;
+
+  /**
+   * \brief Attaches an existing shared memory segment.
+   * \param name Name of the segment.
+   * \throw std::runtime_error If the segment cannot be attached.
+   */
+  explicit
+  SharedColl(const std::string& name)
+    : base_(0), size_(0), layout_()
+  {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) fail("SharedColl", name);
+
+    struct stat status;
+    if (fstat(fd, &status) == -1 ||
+        static_cast<std::size_t>(status.st_size) <
+          sizeof(detail::shared_header))
+    {
+      close(fd);
+      fail("SharedColl", name);
+    }
+
+    size_ = status.st_size;
+    void* base = mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) fail("SharedColl", name);
+    base_ = static_cast<const char*>(base);
+
+    const detail::shared_header* header =
+      reinterpret_cast<const detail::shared_header*>(base_);
+    const bool published =
+      std::memcmp(header->magic, magic(), sizeof(header->magic)) == 0;
+    detail::shared_fence();
+    if (!published || header->size != size_)
+    {
+      munmap(base, size_);
+      fail("SharedColl", name);
+    }
+    layout_ = detail::shared_layout(base_);
+  }
+
+  /** Detaches the shared memory segment. */
+  ~SharedColl()
+  { munmap(const_cast<char*>(base_), size_); }
+
+  /**
+   * \brief Creates a shared memory segment with the content of a Coll.
+   * \param name Name of the segment. It must begin with a slash.
+   * \param coll %Coll whose content is stored in the segment.
+   * \throw std::runtime_error If the segment cannot be created.
+   *
+   * An existing segment with the same name is replaced. Processes
+   * that already attached the old segment keep their mapping. The
+   * magic number in the header of the segment is written after the
+   * content, so that a process that attaches the segment while it
+   * is created either fails with \c std::runtime_error or sees the
+   * complete content, but never a partial segment.
+   */
+  static void
+  create(const std::string& name, const Coll& coll)
+  {
+    std::vector<std::string> texts;
+    std::vector<std::vector<std::size_t> > positions;
+    std::size_t line_count = 0, field_count = 0, char_count = 0;
+
+    for (Coll::const_iterator block = coll.begin(); block != coll.end();
+         ++block)
+    {
+      char_count += block->name().length();
+      for (Block::const_iterator line = block->begin();
+           line != block->end(); ++line)
+      {
+        positions.push_back(std::vector<std::size_t>());
+        texts.push_back(line->format(&positions.back()));
+        char_count += texts.back().length();
+        field_count += positions.back().size();
+        ++line_count;
+      }
+    }
+
+    const std::size_t size = sizeof(detail::shared_header) +
+      coll.size() * sizeof(detail::shared_block) +
+      line_count * sizeof(detail::shared_line) +
+      field_count * sizeof(detail::shared_string) + char_count;
+
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) fail("create", name);
+    if (ftruncate(fd, size) == -1)
+    {
+      close(fd);
+      shm_unlink(name.c_str());
+      fail("create", name);
+    }
+
+    void* mapping = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+      shm_unlink(name.c_str());
+      fail("create", name);
+    }
+
+    char* base = static_cast<char*>(mapping);
+    detail::shared_header* header =
+      reinterpret_cast<detail::shared_header*>(base);
+    header->size = size;
+    header->block_count = coll.size();
+    header->line_count = line_count;
+    header->field_count = field_count;
+
+    const detail::shared_layout layout(base);
+    detail::shared_block* blocks =
+      const_cast<detail::shared_block*>(layout.blocks);
+    detail::shared_line* lines =
+      const_cast<detail::shared_line*>(layout.lines);
+    detail::shared_string* fields =
+      const_cast<detail::shared_string*>(layout.fields);
+    char* chars = const_cast<char*>(layout.chars);
+
+    std::size_t char_pos = 0, line_pos = 0, field_pos = 0;
+    for (Coll::const_iterator block = coll.begin(); block != coll.end();
+         ++block, ++blocks)
+    {
+      blocks->name = store(chars, char_pos, block->name());
+      blocks->first_line = line_pos;
+      blocks->line_count = block->size();
+
+      for (Block::const_iterator line = block->begin();
+           line != block->end(); ++line, ++line_pos)
+      {
+        const std::size_t text_offset = char_pos;
+        lines[line_pos].text = store(chars, char_pos, texts[line_pos]);
+        lines[line_pos].first_field = field_pos;
+        lines[line_pos].field_count = positions[line_pos].size();
+
+        for (std::size_t j = 0; j < positions[line_pos].size(); ++j)
+        {
+          fields[field_pos].offset = text_offset + positions[line_pos][j];
+          fields[field_pos].length = (*line)[j].length();
+          ++field_pos;
+        }
+      }
+    }
+
+    detail::shared_fence();
+    std::memcpy(header->magic, magic(), sizeof(header->magic));
+    munmap(mapping, size);
+  }
+
+  /**
+   * \brief Removes a shared memory segment.
+   * \param name Name of the segment.
+   * \return True if the segment was removed.
+   *
+   * Processes that attached the segment keep their mapping until they
+   * detach it.
+   */
+  static bool
+  remove(const std::string& name)
+  { return shm_unlink(name.c_str()) == 0; }
+
+  /** Returns a Coll with the same content. */
+  Coll
+  to_coll() const
+  {
+    Coll coll;
+    for (const_iterator block = begin(); block != end(); ++block)
+    { coll.push_back(block->to_block()); }
+    return coll;
+  }
+
+  /**
+   * \brief Subscript access to the Blocks of the %SharedColl.
+   * \param n Index of the Block which should be accessed.
+   * \return View of the accessed Block.
+   */
+  const_reference
+  operator[](size_type n) const
+  { return value_type(&layout_, layout_.blocks + n); }
+
+  /**
+   * \brief Locates a Block in the %SharedColl.
+   * \param blockName Name of the Block to be located.
+   * \return View of the sought-after Block.
+   * \throw std::out_of_range If no Block with the name \p blockName
+   *   exists.
+   */
+  const_reference
+  at(const key_type& blockName) const
+  {
+    const_iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    detail::throw_out_of_range("SLHAea::SharedColl::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Accesses a Block in the %SharedColl.
+   * \param key Key that refers to the Block that should be accessed.
+   * \throw std::out_of_range If \p key refers to a non-existing Block.
+   */
+  const_reference
+  block(const Key& key) const
+  { return at(key.block); }
+
+  /**
+   * \brief Accesses a single Line in the %SharedColl.
+   * \param key Key that refers to the Line that should be accessed.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  SharedBlock::const_reference
+  line(const Key& key) const
+  { return block(key).at(key.line); }
+
+  /**
+   * \brief Accesses a single field in the %SharedColl.
+   * \param key Key that refers to the field that should be accessed.
+   * \throw std::out_of_range If \p key refers to a non-existing field.
+   */
+  SharedLine::const_reference
+  field(const Key& key) const
+  { return line(key).at(key.field); }
+
+  /** Returns an iterator that points to the first Block. */
+  const_iterator
+  begin() const
+  { return const_iterator(this, 0); }
+
+  /** Returns an iterator that points one past the last Block. */
+  const_iterator
+  end() const
+  { return const_iterator(this, size()); }
+
+  /**
+   * \brief Tries to locate a Block in the %SharedColl.
+   * \param blockName Name of the Block to be located.
+   * \return Iterator pointing to sought-after element, or end() if not
+   *   found.
+   */
+  const_iterator
+  find(const key_type& blockName) const
+  {
+    const boost::string_ref name(blockName);
+    for (const_iterator block = begin(); block != end(); ++block)
+    { if (boost::iequals(name, block->name())) return block; }
+    return end();
+  }
+
+  /** Counts all Blocks with a given name. */
+  size_type
+  count(const key_type& blockName) const
+  {
+    const boost::string_ref name(blockName);
+    size_type count = 0;
+    for (const_iterator block = begin(); block != end(); ++block)
+    { if (boost::iequals(name, block->name())) ++count; }
+    return count;
+  }
+
+  /** Returns the number of Blocks in the %SharedColl. */
+  size_type
+  size() const
+  { return layout_.header->block_count; }
+
+  /** Returns true if the %SharedColl is empty. */
+  bool
+  empty() const
+  { return size() == 0; }
+
+private:
+  // NOTE: A %SharedColl owns a mapping of the segment, so it must
+  //   not be copied.
+  SharedColl(const SharedColl&);
+  SharedColl& operator=(const SharedColl&);
+
+  static const char*
+  magic()
+  { return "SLHAea\001\000"; }
+
+  static detail::shared_string
+  store(char* chars, std::size_t& pos, const std::string& str)
+  {
+    detail::shared_string result = { pos, str.length() };
+    std::memcpy(chars + pos, str.data(), str.length());
+    pos += str.length();
+    return result;
+  }
+
+  static void
+  fail(const std::string& function, const std::string& name)
+  {
+    detail::throw_runtime_error("SLHAea::SharedColl::" + function + "(‘" +
+                             name + "’)");
+  }
+
+private:
+  const char* base_;
+  std::size_t size_;
+  detail::shared_layout layout_;
+};
+
+inline std::ostream&
+operator<<(std::ostream& os, const SharedColl& coll)
+{
+  for (SharedColl::const_iterator block = coll.begin(); block != coll.end();
+       ++block)
+  {
+    for (SharedBlock::const_iterator line = block->begin();
+         line != block->end(); ++line)
+    { os << line->str() << '\n'; }
+  }
+  return os;
+}
+#endif // SLHAEA_HAS_POSIX
+
+} // namespace SLHAea
+
+#endif // SLHAEA_SHARED_H
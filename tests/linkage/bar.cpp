@@ -1,8 +1,14 @@
 #include "slhaea.h"
+#include "slhaea_archive.h"
+#include "slhaea_concurrent.h"
+#include "slhaea_json.h"
+#include "slhaea_sharded.h"
+#include "slhaea_shared.h"
 #include "foobar.h"
 
 SLHAea::Line bar()
 {
-  SLHAea::Line line(" 1 bar");
+  SLHAea::Line line(" 1");
+  line << 0.5 << "# bar";
   return line;
 }
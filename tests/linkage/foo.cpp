@@ -1,4 +1,9 @@
 #include "slhaea.h"
+#include "slhaea_archive.h"
+#include "slhaea_concurrent.h"
+#include "slhaea_json.h"
+#include "slhaea_sharded.h"
+#include "slhaea_shared.h"
 #include "foobar.h"
 
 SLHAea::Line foo()
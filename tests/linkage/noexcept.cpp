@@ -0,0 +1,35 @@
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include "slhaea.h"
+
+// With -fno-exceptions Boost defines BOOST_NO_EXCEPTIONS and the user
+// must supply boost::throw_exception().
+namespace boost {
+
+void
+throw_exception(const std::exception& e)
+{
+  std::cerr << e.what() << std::endl;
+  std::abort();
+}
+
+void
+throw_exception(const std::exception& e, const source_location&)
+{ throw_exception(e); }
+
+} // namespace boost
+
+int main()
+{
+  SLHAea::Coll input = SLHAea::Coll::from_str("BLOCK MASS\n 25 125.0\n");
+  SLHAea::Key key("", SLHAea::Block::key_type(), 0);
+  double mass = 0.;
+
+  if (key.try_str("MASS;25;1"))
+  {
+    const std::string* field = input.try_field(key);
+    if (field && SLHAea::try_to(*field, mass)) std::cout << mass << std::endl;
+  }
+  return input.find("SMINPUTS") != input.end() ? 1 : 0;
+}
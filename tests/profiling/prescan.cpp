@@ -0,0 +1,54 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+// Compares reading a Coll from a stream (containers grow while the
+// input is parsed) with reading it from a memory buffer (containers
+// are presized by a first pass over the buffer).
+int main(int argc, char* argv[])
+{
+  int iterations = 100;
+  if (argc > 1)
+  {
+    istringstream iss(argv[1]);
+    iss >> iterations;
+  }
+
+  ifstream ifs("input.txt");
+  const string input((istreambuf_iterator<char>(ifs)),
+                     istreambuf_iterator<char>());
+
+  clock_t start = clock();
+  for (int i = 0; i < iterations; ++i)
+  {
+    istringstream iss(input);
+    Coll coll(iss);
+  }
+  const double stream_time = double(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < iterations; ++i)
+  {
+    Coll coll;
+    coll.read(input.data(), input.data() + input.size());
+  }
+  const double buffer_time = double(clock() - start) / CLOCKS_PER_SEC;
+
+  cout << "iterations:        " << iterations << "\n"
+       << "stream (growing):  " << stream_time << " s\n"
+       << "buffer (presized): " << buffer_time << " s\n";
+}
@@ -1,2 +1,7 @@
 #include "slhaea.h"
+#include "slhaea_archive.h"
+#include "slhaea_concurrent.h"
+#include "slhaea_json.h"
+#include "slhaea_sharded.h"
+#include "slhaea_shared.h"
 int main() {}
@@ -0,0 +1,196 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include "slhaea_archive.h"
+
+using namespace std;
+using namespace SLHAea;
+
+#if defined(SLHAEA_HAS_CXX11) && defined(SLHAEA_HAS_POSIX)
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(TestScanArchive)
+
+namespace {
+
+Coll
+point(int id)
+{
+  Coll coll;
+  coll.str("BLOCK MINPAR\n"
+           "    1    " + to_string(100 + id) + "\n"
+           "BLOCK MASS\n"
+           "    25   1.25E+02\n");
+  return coll;
+}
+
+} // namespace
+
+struct F {
+  F() : path("slhaea_ut_archive_" + to_string(getpid())) {}
+  ~F() { remove(path.c_str()); }
+
+  string path;
+};
+
+BOOST_FIXTURE_TEST_CASE(testAppendGet, F)
+{
+  {
+    ScanArchive archive(path, 256);
+    BOOST_CHECK_EQUAL(archive.size(), 0);
+
+    for (int i = 0; i < 10; ++i) archive.append(i, point(i));
+    archive.append(42, Coll());
+    BOOST_CHECK_THROW(archive.append(3, point(3)), invalid_argument);
+
+    BOOST_CHECK_EQUAL(archive.size(), 11);
+    BOOST_CHECK(archive.contains(42));
+    BOOST_CHECK(!archive.contains(10));
+    BOOST_CHECK_EQUAL(archive.get(7), point(7));
+    BOOST_CHECK_EQUAL(archive.str(3), point(3).str());
+    BOOST_CHECK(archive.get(42).empty());
+    BOOST_CHECK_THROW(archive.get(10), out_of_range);
+
+    Coll big;
+    for (int i = 0; i < 20; ++i) big.push_back(point(i).front());
+    archive.append(100, big);
+    archive.append(101, point(101));
+    BOOST_CHECK_EQUAL(archive.get(100), big);
+  }
+
+  const ScanArchive archive(path, 1024);
+  BOOST_CHECK_EQUAL(archive.segment_size(), 256);
+  BOOST_CHECK_EQUAL(archive.size(), 13);
+  BOOST_CHECK_EQUAL(archive.point_ids().back(), 101);
+  BOOST_CHECK_EQUAL(archive.get(0), point(0));
+  BOOST_CHECK_EQUAL(archive.get(101), point(101));
+  BOOST_CHECK_EQUAL(archive.get(100).size(), 20);
+}
+
+BOOST_FIXTURE_TEST_CASE(testConcurrentAppenders, F)
+{
+  const int threads = 4, points = 50;
+  {
+    ScanArchive archive(path, 512);
+    vector<thread> appenders;
+    for (int t = 0; t < threads; ++t)
+    {
+      appenders.push_back(thread([&archive, t] {
+        ScanArchive::Appender appender(archive);
+        for (int i = t; i < threads * points; i += threads)
+        { appender.append(i, point(i)); }
+      }));
+    }
+    for (size_t t = 0; t < appenders.size(); ++t) appenders[t].join();
+    BOOST_CHECK_EQUAL(archive.size(), threads * points);
+    archive.sync();
+  }
+
+  ScanArchive archive(path);
+  BOOST_REQUIRE_EQUAL(archive.size(), threads * points);
+  for (int i = 0; i < threads * points; ++i)
+  { BOOST_CHECK_EQUAL(archive.get(i), point(i)); }
+
+  ScanArchive::Appender appender(archive);
+  appender.append(1000, point(1000));
+  BOOST_CHECK_THROW(appender.append(1, point(1)), invalid_argument);
+  BOOST_CHECK_EQUAL(archive.get(1000), point(1000));
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadOnly, F)
+{
+  BOOST_CHECK_THROW(ScanArchive(path, ScanArchive::read_only),
+                    runtime_error);
+  BOOST_CHECK(access(path.c_str(), F_OK) != 0);
+
+  {
+    ScanArchive writer(path, 256);
+    writer.append(1, point(1));
+
+    // Only one writer at a time, but any number of readers.
+    BOOST_CHECK_THROW(ScanArchive(path, ScanArchive::read_write),
+                      runtime_error);
+    const ScanArchive reader(path, ScanArchive::read_only);
+    BOOST_CHECK_EQUAL(reader.get(1), point(1));
+  }
+
+  ScanArchive reader(path, ScanArchive::read_only);
+  BOOST_CHECK_EQUAL(reader.size(), 1);
+  BOOST_CHECK_THROW(reader.append(2, point(2)), runtime_error);
+  ScanArchive::Appender appender(reader);
+  BOOST_CHECK_THROW(appender.append(2, point(2)), runtime_error);
+  BOOST_CHECK(!reader.contains(2));
+
+  ScanArchive writer(path, ScanArchive::read_write);
+  writer.append(2, point(2));
+  BOOST_CHECK_EQUAL(writer.size(), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(testTornRecord, F)
+{
+  {
+    ScanArchive archive(path, 4096);
+    for (int i = 0; i < 3; ++i) archive.append(i, point(i));
+  }
+
+  // Overwrite a byte of the text of the last record as if writing it
+  // had been interrupted.
+  const string text = point(2).str();
+  FILE* file = fopen(path.c_str(), "r+b");
+  BOOST_REQUIRE(file != 0);
+  BOOST_REQUIRE_EQUAL(fseek(file, 0, SEEK_END), 0);
+  const long end = ftell(file);
+  BOOST_REQUIRE_EQUAL(fseek(file, end - 2, SEEK_SET), 0);
+  fputc('X', file);
+  fclose(file);
+
+  {
+    const ScanArchive archive(path, ScanArchive::read_only);
+    BOOST_CHECK_EQUAL(archive.size(), 2);
+    BOOST_CHECK(!archive.contains(2));
+    BOOST_CHECK_EQUAL(archive.get(1), point(1));
+  }
+
+  // A record that is damaged after the archive was opened is detected
+  // when it is read.
+  const ScanArchive archive(path, ScanArchive::read_only);
+  file = fopen(path.c_str(), "r+b");
+  BOOST_REQUIRE(file != 0);
+  BOOST_REQUIRE_EQUAL(fseek(file, end - 2 * long(text.size()) - 20,
+                            SEEK_SET), 0);
+  fputc('X', file);
+  fclose(file);
+  BOOST_CHECK_THROW(archive.get(1), runtime_error);
+  BOOST_CHECK_EQUAL(archive.get(0), point(0));
+}
+
+BOOST_AUTO_TEST_CASE(testOpenFailure)
+{
+  BOOST_CHECK_THROW(ScanArchive("/slhaea_ut_no_such_dir/archive"),
+                    runtime_error);
+
+  BOOST_TRY
+  {
+    ScanArchive("/slhaea_ut_no_such_dir/archive", ScanArchive::read_only);
+    BOOST_ERROR("no exception thrown");
+  }
+  BOOST_CATCH(const runtime_error& e)
+  {
+    BOOST_CHECK_EQUAL(string(e.what()), "SLHAea::ScanArchive::ScanArchive"
+                      "(‘/slhaea_ut_no_such_dir/archive’)");
+  }
+  BOOST_CATCH_END
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -40,6 +40,24 @@ BOOST_AUTO_TEST_CASE(testTo)
   BOOST_CHECK_CLOSE(to<float>("10.51234"), 10.51234, float_eps);
 }
 
+BOOST_AUTO_TEST_CASE(testTryTo)
+{
+  int i = 0;
+  BOOST_CHECK(try_to("-12", i));
+  BOOST_CHECK_EQUAL(i, -12);
+  BOOST_CHECK(!try_to("1.5", i));
+  BOOST_CHECK(!try_to("", i));
+
+  double d = 0.;
+  BOOST_CHECK(try_to(string("2.5e2"), d));
+  BOOST_CHECK_EQUAL(d, 250.);
+  BOOST_CHECK(!try_to("2.5x", d));
+
+  string s;
+  BOOST_CHECK(try_to(42, s));
+  BOOST_CHECK_EQUAL(s, "42");
+}
+
 BOOST_AUTO_TEST_CASE(testToString)
 {
   BOOST_CHECK_EQUAL(to_string("foo"), "foo");
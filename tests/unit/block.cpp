@@ -715,6 +715,133 @@ BOOST_AUTO_TEST_CASE(testReformat)
     "# 3 3 3\n");
 }
 
+BOOST_AUTO_TEST_CASE(testAlignColumns)
+{
+  Block b1("t1");
+  b1[""] = " BLOCK t1 # comment";
+  b1[""] = "1 1 # one";
+  b1[""] = "  # 3 3 3";
+  b1[""] = " 22 -2.5E+01 22 # two";
+  b1[""] = " 1000022  3";
+  b1[""] = "";
+
+  b1.align_columns();
+  BOOST_CHECK_EQUAL(b1.str(),
+    "BLOCK t1    # comment\n"
+    "    1           1               # one\n"
+    "# 3 3 3\n"
+    "    22         -2.5E+01     22  # two\n"
+    "    1000022     3\n"
+    "\n");
+
+  Block b2("t2");
+  b2[""] = "  -1 -2 # a";
+  Block b3(b2);
+  b2.align_columns();
+  b3.reformat();
+  BOOST_CHECK_EQUAL(b2.str(), b3.str());
+}
+
+namespace {
+
+struct scale
+{
+  explicit scale(double factor) : factor_(factor) {}
+  double operator()(double x) const { return factor_ * x; }
+  double factor_;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testTransformColumn)
+{
+  Block b1;
+  b1.str("BLOCK MASS Q= 1.0\n"
+         "    6     1.73E+02   # top\n"
+         "    25    1.25D+02   3\n"
+         "    35    x\n"
+         "# 1 2");
+
+  BOOST_CHECK_EQUAL(b1.transform_column(1, scale(-1e-3), 3), 2);
+  BOOST_CHECK_EQUAL(b1.str(),
+    "BLOCK MASS Q= 1.0\n"
+    "    6    -1.730e-01   # top\n"
+    "    25   -1.250e-01   3\n"
+    "    35    x\n"
+    "# 1 2\n");
+
+  BOOST_CHECK_EQUAL(b1.transform_column(0, scale(2.), 1), 3);
+  BOOST_CHECK_EQUAL(b1.at("5.0e+01")[2], "3");
+  BOOST_CHECK_EQUAL(b1.transform_column(2, scale(2.)), 1);
+  BOOST_CHECK_EQUAL(b1.at("5.0e+01")[2], "6.000000000000000e+00");
+  BOOST_CHECK_EQUAL(b1.transform_column(3, scale(2.)), 0);
+  BOOST_CHECK_EQUAL(b1.back().str(), "# 1 2");
+}
+
+BOOST_AUTO_TEST_CASE(testFreeze)
+{
+  Block b1;
+  b1[""] << "BLOCK" << "t1";
+  for (int i = 0; i < 40; ++i) b1[""] << 2 * i << "x";
+  const Block& cb1 = b1;
+
+  Line& l1 = b1.at("4");
+  for (int i = 0; i < 3; ++i)
+  { BOOST_CHECK(cb1.find(vector<string>(1, "1")) == cb1.end()); }
+  l1[0] = "1";
+  BOOST_CHECK(cb1.find(vector<string>(1, "1")) == cb1.begin() + 3);
+  BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, "1")), 1);
+
+  BOOST_CHECK(!cb1.frozen());
+  b1.freeze();
+  BOOST_CHECK(cb1.frozen());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK(cb1.find(vector<string>(1, "1")) == cb1.begin() + 3);
+    BOOST_CHECK(cb1.find(vector<string>(1, "4")) == cb1.end());
+    BOOST_CHECK(cb1.find(vector<string>(1, "78")) == cb1.end() - 1);
+    BOOST_CHECK(cb1.find(vector<string>(1, "block")) == cb1.begin());
+    BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, "3")), 0);
+    BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, "(any)")), 41);
+    BOOST_CHECK_EQUAL(cb1.at("1").at(1), "x");
+  }
+  BOOST_CHECK(cb1.frozen());
+
+  b1.begin()[5][0] = "3";
+  BOOST_CHECK(cb1.frozen());
+  BOOST_CHECK(cb1.find(vector<string>(1, "3")) == cb1.begin() + 5);
+
+  b1.push_back("5 y");
+  b1.insert(b1.begin() + 1, Line("7 z"));
+  BOOST_CHECK(cb1.frozen());
+  BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, "5")), 1);
+  BOOST_CHECK(cb1.find(vector<string>(1, "7")) == cb1.begin() + 1);
+  BOOST_CHECK(cb1.find(vector<string>(1, "3")) == cb1.begin() + 6);
+
+  b1.back()[0] = "X";
+  BOOST_CHECK_EQUAL(cb1.at("x").at(1), "y");
+  b1.at("x")[0] = "W";
+  b1.at("w")[0] = "V";
+  BOOST_CHECK_THROW(cb1.at("x"), out_of_range);
+  BOOST_CHECK_EQUAL(cb1.at("v").at(1), "y");
+
+  b1.erase(b1.begin() + 1);
+  BOOST_CHECK(cb1.frozen());
+  BOOST_CHECK(cb1.find(vector<string>(1, "7")) == cb1.end());
+  BOOST_CHECK(cb1.find(vector<string>(1, "3")) == cb1.begin() + 5);
+
+  Block b2(b1);
+  BOOST_CHECK(!b2.frozen());
+  b2.erase_first(vector<string>(1, "v"));
+  BOOST_CHECK_THROW(b2.at("v"), out_of_range);
+  BOOST_CHECK_EQUAL(cb1.at("v").at(1), "y");
+
+  b1.thaw();
+  BOOST_CHECK(!cb1.frozen());
+  BOOST_CHECK_EQUAL(cb1.at("v").at(1), "y");
+}
+
 BOOST_AUTO_TEST_CASE(testUnComment)
 {
   Block b1("t1");
@@ -797,6 +924,104 @@ BOOST_AUTO_TEST_CASE(testKeyMatches)
   BOOST_CHECK_EQUAL(pred(l1), false);
 }
 
+BOOST_AUTO_TEST_CASE(testKeyPatterns)
+{
+  Line l1("1000011 -13 x?");
+  vector<string> key(1);
+  Block::key_matches pred(key);
+
+  const char* const matching[] = { "1000*", "*11", "1*0*1", "10000?11",
+    "{11,1000011}", "{1000001|1000011}", "*", "100001?1?" };
+  for (size_t i = 0; i < sizeof(matching) / sizeof(*matching); ++i)
+  {
+    key[0] = pattern(matching[i]);
+    pred.set_key(key);
+    BOOST_CHECK_MESSAGE(pred(l1), matching[i]);
+  }
+
+  const char* const failing[] = { "1000", "2*", "*12", "10000?12",
+    "{11,13}", "1000011?2", "{" };
+  for (size_t i = 0; i < sizeof(failing) / sizeof(*failing); ++i)
+  {
+    key[0] = pattern(failing[i]);
+    pred.set_key(key);
+    BOOST_CHECK_MESSAGE(!pred(l1), failing[i]);
+  }
+
+  key[0] = "(any)";
+  key.push_back(pattern("-?{11,13,15}"));
+  pred.set_key(key);
+  BOOST_CHECK_EQUAL(pred(l1), true);
+  l1[1] = "13";
+  BOOST_CHECK_EQUAL(pred(l1), true);
+  l1[1] = "+13";
+  BOOST_CHECK_EQUAL(pred(l1), false);
+
+  key[1] = pattern("1{1,3}");
+  key.push_back(pattern("X?"));
+  pred.set_key(key);
+  BOOST_CHECK_EQUAL(pred(l1), false);
+  l1[1] = "13";
+  BOOST_CHECK_EQUAL(pred(l1), false);
+  key[2] = pattern("?X?");
+  pred.set_key(key);
+  BOOST_CHECK_EQUAL(pred(l1), false);
+  key[2] = pattern("x*");
+  pred.set_key(key);
+  BOOST_CHECK_EQUAL(pred(l1), true);
+
+  Block b1;
+  b1[""] << "BLOCK" << "t1";
+  for (int i = 0; i < 40; ++i) b1[""] << 1000001 + i << -11 - 2 * (i % 3);
+  const Block& cb1 = b1;
+
+  vector<string> k1(1, pattern("100000*"));
+  for (int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK_EQUAL(cb1.count(k1), 9);
+    BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, pattern("10000{1,2}*"))),
+                      20);
+    BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, pattern("2*"))), 0);
+    BOOST_CHECK(cb1.find(vector<string>(1, pattern("*12"))) ==
+                cb1.begin() + 12);
+    BOOST_CHECK(b1.find(vector<string>(1, pattern("b*"))) == b1.begin());
+    BOOST_CHECK(cb1.find(vector<string>(1, pattern("10000?5"))) ==
+                cb1.end());
+    if (i == 1) b1.freeze();
+  }
+
+  b1.begin()[3][0] = "2000003";
+  BOOST_CHECK_EQUAL(cb1.count(k1), 8);
+  BOOST_CHECK(cb1.find(vector<string>(1, pattern("2*"))) == cb1.begin() + 3);
+
+  key.assign(1, pattern("1000*"));
+  key.push_back("-15");
+  BOOST_CHECK_EQUAL(cb1.at(key)[0], "1000006");
+  BOOST_CHECK_EQUAL(b1.erase(key), 12);
+  BOOST_CHECK_EQUAL(cb1.count(key), 0);
+
+  // Without the marker "*", "?" and braces are ordinary characters.
+  b1.freeze();
+  BOOST_CHECK_EQUAL(cb1.count(vector<string>(1, "1000*")), 0);
+  b1[""] << "1000*" << 1;
+  b1[""] << "2{1,2}?" << 2;
+  BOOST_CHECK_EQUAL(cb1.size(), 31);
+  BOOST_CHECK_EQUAL(cb1.at("1000*")[1], "1");
+  BOOST_CHECK_EQUAL(cb1.at("2{1,2}?")[1], "2");
+  BOOST_CHECK_EQUAL(cb1.count(k1), 6);
+  key.assign(1, "*");
+  BOOST_CHECK(cb1.find(key) == cb1.end());
+
+  l1 = "1 x? 1{1,3}";
+  key.assign(1, "(any)");
+  key.push_back("X?");
+  key.push_back("1{1,3}");
+  pred.set_key(key);
+  BOOST_CHECK_EQUAL(pred(l1), true);
+  l1[1] = "x";
+  BOOST_CHECK_EQUAL(pred(l1), false);
+}
+
 BOOST_AUTO_TEST_CASE(testInEquality)
 {
   Block b1("t1");
@@ -905,4 +1130,42 @@ BOOST_AUTO_TEST_CASE(testOrder)
   BOOST_CHECK_EQUAL(vb1[2], b1);
 }
 
+BOOST_AUTO_TEST_CASE(testHandles)
+{
+  Block b1 = Block::from_str("BLOCK test\n 1 1\n 2 2\n 3 3");
+  const Block::handle_type h1 = b1.handle(b1.begin() + 1);
+  const Block::handle_type h2 = b1.handle(b1.begin() + 2);
+  const Block::handle_type h3 = b1.handle(b1.begin() + 3);
+
+  BOOST_CHECK(h1 == b1.handle(b1.begin() + 1));
+  BOOST_CHECK(h1 != h2);
+  BOOST_CHECK(b1.resolve(Block::handle_type()) == 0);
+  BOOST_CHECK_EQUAL(b1.resolve(h1)->str(), " 1 1");
+
+  b1.insert(b1.begin() + 1, Line(" 0 0"));
+  b1.push_back(" 4 4");
+  b1[""] << 5 << 5;
+  BOOST_CHECK_EQUAL(b1.resolve(h1)->str(), " 1 1");
+  BOOST_CHECK_EQUAL(b1.resolve(h3)->str(), " 3 3");
+
+  b1.erase(b1.begin() + 3);
+  BOOST_CHECK(b1.resolve(h2) == 0);
+  BOOST_CHECK_EQUAL(b1.resolve(h1)->str(), " 1 1");
+  BOOST_CHECK_EQUAL(b1.resolve(h3)->str(), " 3 3");
+
+  const Block::handle_type h4 = b1.handle(b1.end() - 1);
+  BOOST_CHECK(h4.slot == h2.slot);
+  BOOST_CHECK(b1.resolve(h2) == 0);
+  b1.erase(b1.begin() + 1, b1.begin() + 3);
+  b1.pop_back();
+  BOOST_CHECK(b1.resolve(h1) == 0);
+  BOOST_CHECK(b1.resolve(h4) == 0);
+  BOOST_CHECK_EQUAL(b1.resolve(h3)->str(), " 3 3");
+
+  const Block b2 = b1;
+  BOOST_CHECK_EQUAL(b2.resolve(h3)->str(), " 3 3");
+  b1.clear();
+  BOOST_CHECK(b1.resolve(h3) == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <boost/concept/assert.hpp>
 #include <boost/test/unit_test.hpp>
 #include "slhaea.h"
@@ -650,6 +651,37 @@ BOOST_AUTO_TEST_CASE(testReformat) {
                     "    1   2   3   4\n");
 }
 
+namespace {
+
+double
+halve(double x)
+{ return x / 2.; }
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testTransformColumn) {
+  Coll c1;
+  c1.str("BLOCK MASS\n"
+         "  6  1.7E+02\n"
+         "DECAY 6 1.4\n"
+         "  1.0  2  5  24\n"
+         "DECAY 25 4.1E-03\n"
+         "  0.6  2  5  -5\n"
+         "  0.4  2  4  -4\n");
+  c1.enable_journal();
+
+  BOOST_CHECK_EQUAL(c1.transform_column(vector<string>(1, "decay"), 0,
+                                        halve, 2), 3);
+  BOOST_CHECK_EQUAL(c1.field("6;5.00e-01;3"), "24");
+  BOOST_CHECK_EQUAL(c1.field("25;(any),2,4;0"), "2.00e-01");
+  BOOST_CHECK_EQUAL(c1.field("6;DECAY;2"), "1.4");
+  BOOST_CHECK_EQUAL(c1.drain_changes().size(), 3);
+
+  BOOST_CHECK_EQUAL(c1.transform_column(pattern("m*"), 1, halve, 1), 1);
+  BOOST_CHECK_EQUAL(c1.field("MASS;6;1"), "8.5e+01");
+  BOOST_CHECK_EQUAL(c1.transform_column("SPINFO", 1, halve), 0);
+}
+
 BOOST_FIXTURE_TEST_CASE(testUnComment, F) {
   Coll c1;
   c1.str(fs1);
@@ -685,6 +717,58 @@ BOOST_AUTO_TEST_CASE(testKeyMatches) {
 
   pred.set_key("");
   BOOST_CHECK_EQUAL(pred(b1), false);
+
+  pred.set_key(pattern("test*"));
+  BOOST_CHECK_EQUAL(pred(b1), true);
+
+  pred.set_key(pattern("{test1,test3}"));
+  BOOST_CHECK_EQUAL(pred(b1), false);
+
+  pred.set_key("test*");
+  BOOST_CHECK_EQUAL(pred(b1), false);
+  b1.name("Test*");
+  BOOST_CHECK_EQUAL(pred(b1), true);
+}
+
+BOOST_AUTO_TEST_CASE(testNamePatterns) {
+  Coll c1;
+  for (int i = 1; i <= 4; ++i) c1.push_back("BLOCK NMIX" + to_string(i));
+  c1.push_back("BLOCK UMIX");
+  c1.push_back("BLOCK VMIX");
+  for (int i = 0; i < 20; ++i) c1.push_back("DECAY " + to_string(1000001 + i));
+  const Coll& cc1 = c1;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK_EQUAL(cc1.count(pattern("nmix*")), 4);
+    BOOST_CHECK_EQUAL(cc1.count(pattern("{UMIX,VMIX}")), 2);
+    BOOST_CHECK_EQUAL(cc1.count(pattern("100001*")), 10);
+    BOOST_CHECK_EQUAL(cc1.at(pattern("*MIX")).name(), "UMIX");
+    BOOST_CHECK(c1.find(pattern("*1")) == c1.begin());
+    BOOST_CHECK(cc1.find(pattern("X*")) == cc1.end());
+    if (i == 1) c1.freeze();
+  }
+
+  c1.at("NMIX1").name("XMIX");
+  BOOST_CHECK(cc1.find(pattern("X*")) == cc1.begin());
+  BOOST_CHECK_EQUAL(cc1.count(pattern("nmix*")), 3);
+  BOOST_CHECK_EQUAL(cc1.field(pattern("{U,V}MIX") + ";(any);0"), "BLOCK");
+  BOOST_CHECK_EQUAL(c1.erase(pattern("1000*")), 20);
+  BOOST_CHECK_EQUAL(cc1.size(), 6);
+
+  // Names without the marker are compared literally and patterns do
+  // not create new Blocks.
+  c1.freeze();
+  BOOST_CHECK(cc1.find("X*") == cc1.end());
+  BOOST_CHECK_EQUAL(c1[pattern("X*")].name(), "XMIX");
+  c1.erase("XMIX");
+  BOOST_CHECK_THROW(c1[pattern("X*")], std::out_of_range);
+  BOOST_CHECK_EQUAL(cc1.size(), 5);
+  c1["X*"][""] << "BLOCK" << "X*";
+  BOOST_CHECK_EQUAL(cc1.size(), 6);
+  BOOST_CHECK_EQUAL(cc1.at("x*").name(), "X*");
+  BOOST_CHECK_EQUAL(cc1.count(pattern("X*")), 1);
+  BOOST_CHECK_EQUAL(cc1.count("{UMIX,VMIX}"), 0);
 }
 
 BOOST_AUTO_TEST_CASE(testKeyMatchesBlockDef) {
@@ -770,4 +854,545 @@ BOOST_FIXTURE_TEST_CASE(testInEquality, F) {
   BOOST_CHECK_EQUAL(c2, c1);
 }
 
+BOOST_FIXTURE_TEST_CASE(testTransactions, F) {
+  Coll c1;
+  c1.str(fs2);
+  const Coll orig = c1;
+
+  Coll::checkpoint_type cp = c1.checkpoint();
+  c1["test1"]["1"][1] = "11";
+  c1["test1"].push_back(" 1  3");
+  c1.field("test2;2,2;1") = "22";
+  c1.line("test3;3,1;0").str(" 33 11");
+  c1.erase_first("test4");
+  c1.push_front("BLOCK test0");
+  c1["test5"]["5"] << 5;
+  c1.erase(c1.find("test1"));
+  BOOST_CHECK_NE(c1, orig);
+
+  c1.rollback(cp);
+  BOOST_CHECK_EQUAL(c1, orig);
+  BOOST_CHECK_EQUAL(c1.str(), orig.str());
+
+  c1.erase("test2");
+  Coll::checkpoint_type cp2 = c1.checkpoint();
+  c1.at("test3").front()[1] = "foo";
+  c1.pop_back();
+  c1.rollback(cp2);
+  BOOST_CHECK_EQUAL(c1.size(), 3);
+  BOOST_CHECK_EQUAL(c1.at("test3").front()[1], "test3");
+  c1.commit(cp2);
+  BOOST_CHECK_THROW(c1.rollback(cp2), out_of_range);
+
+  for (Coll::iterator it = c1.begin(); it != c1.end(); ++it) it->clear();
+  c1.reformat();
+  c1.clear();
+  c1.rollback(cp);
+  BOOST_CHECK_EQUAL(c1, orig);
+
+  c1.push_back("BLOCK test5");
+  c1.commit(cp);
+  BOOST_CHECK_EQUAL(c1.size(), orig.size() + 1);
+  BOOST_CHECK_THROW(c1.commit(cp), out_of_range);
+
+  Coll c2;
+  cp = c1.checkpoint();
+  c1.swap(c2);
+  c1.rollback(cp);
+  BOOST_CHECK_EQUAL(c1.size(), orig.size() + 1);
+  c1.commit(cp);
+
+  const Coll orig1 = c1;
+  Block& test3 = c1.at("test3");
+  cp = c1.checkpoint();
+  for (Block::iterator line = test3.begin(); line != test3.end(); ++line) {
+    if (line->is_data_line()) *line->begin() += "0";
+  }
+  test3.insert(test3.begin() + 1, Line(" 4 4"));
+  test3.erase(test3.begin() + 2);
+  test3.name("test6");
+  c1.insert(c1.begin() + 1, Block("test7"));
+  c1.front().back().swap(test3.back());
+  const std::string fs3 = " 5 5\nBLOCK test8\n 1 1\n";
+  c1.read(fs3.data(), fs3.data() + fs3.size());
+  Coll::checkpoint_type cp3 = c1.checkpoint();
+  c1.back().back()[1] = "9";
+  c1.rollback(cp3);
+  BOOST_CHECK_EQUAL(c1.back().back()[1], "1");
+  c1.rollback(cp);
+  BOOST_CHECK_EQUAL(c1, orig1);
+  BOOST_CHECK_EQUAL(c1.str(), orig1.str());
+  c1.commit(cp);
+
+  Coll c3 = Coll::from_str(fs1);
+  cp = c3.checkpoint();
+  c3["test1"]["1"][1] = "11";
+  Coll c4(c3);
+  BOOST_CHECK_THROW(c4.rollback(cp), out_of_range);
+  c4 = orig;
+  BOOST_CHECK_THROW(c4.commit(cp), out_of_range);
+
+  c3 = orig;
+  BOOST_CHECK_EQUAL(c3, orig);
+  c3.rollback(cp);
+  BOOST_CHECK_EQUAL(c3, Coll::from_str(fs1));
+  c3.commit(cp);
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadBuffer, F) {
+  const char* inputs[] = {
+    "", " \n\t\n", "1 2\n# comment\n\nBLOCK test\n 1 2", "Block\nDECAY 1 2\n",
+    "BLOCK #test\n 1 2#3\r\nBLOCK test2 Q= 5\r\n  3  4  \n"
+  };
+  vector<string> strings(inputs, inputs + sizeof(inputs) / sizeof(*inputs));
+  strings.push_back(fs1);
+  strings.push_back(fs2);
+  strings.push_back(fs2 + fs1);
+
+  for (vector<string>::const_iterator s = strings.begin();
+       s != strings.end(); ++s) {
+    stringstream ss(*s);
+    const Coll c1(ss);
+    Coll c2;
+    c2.read(s->data(), s->data() + s->size());
+    BOOST_CHECK_EQUAL(c1, c2);
+    BOOST_CHECK_EQUAL(c1.str(), c2.str());
+    BOOST_CHECK_EQUAL(c1, Coll::from_str(*s));
+  }
+
+  Coll c3 = Coll::from_str(fs1);
+  c3.read(fs2.data(), fs2.data() + fs2.size());
+  BOOST_CHECK_EQUAL(c3, Coll::from_str(fs1 + fs2));
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadUntil, F) {
+  vector<Key> keys;
+  keys.push_back(Key("TEST2;2;1"));
+  keys.push_back(Key("test1;;0"));
+
+  stringstream ss1(fs2);
+  Coll c1;
+  const streamsize n1 = c1.read_until(ss1, keys);
+  BOOST_CHECK_EQUAL(n1, fs2.find(" 2  2\n"));
+  BOOST_CHECK_EQUAL(c1.size(), 2);
+  BOOST_CHECK_EQUAL(c1.field("test2;2;1"), "1");
+  BOOST_CHECK_EQUAL(c1.at("test2").size(), 2);
+
+  c1.read(ss1);
+  BOOST_CHECK_EQUAL(c1.size(), 5);
+  BOOST_CHECK_EQUAL(c1.begin()[2].name(), "");
+  BOOST_CHECK_EQUAL(c1.begin()[2].str(), " 2  2\n");
+
+  keys.push_back(Key("test4;4,2;0"));
+  stringstream ss2(fs2);
+  Coll c2;
+  BOOST_CHECK_EQUAL(c2.read_until(ss2, keys), streamsize(fs2.size()));
+  BOOST_CHECK_EQUAL(c2, Coll::from_str(fs2));
+
+  keys.push_back(Key("test5;1;0"));
+  stringstream ss3(fs2.substr(0, fs2.size() - 1));
+  Coll c3;
+  BOOST_CHECK_EQUAL(c3.read_until(ss3, keys), streamsize(fs2.size() - 1));
+  BOOST_CHECK_EQUAL(c3, Coll::from_str(fs2));
+
+  stringstream ss4(fs2);
+  Coll c4;
+  BOOST_CHECK_EQUAL(c4.read_until(ss4, vector<Key>()), 0);
+  BOOST_CHECK(c4.empty());
+}
+
+struct DiffCollector {
+  explicit DiffCollector(vector<BlockDifference>& d) : diffs(&d) {}
+  void operator()(const BlockDifference& d) const { diffs->push_back(d); }
+  vector<BlockDifference>* diffs;
+};
+
+// Stream buffer that cannot seek, like the one of a pipe.
+struct UnseekableBuf : streambuf {
+  explicit UnseekableBuf(const string& s) : str(s)
+  { setg(&str[0], &str[0], &str[0] + str.size()); }
+  string str;
+};
+
+BOOST_FIXTURE_TEST_CASE(testStreamDiff, F) {
+  vector<BlockDifference> diffs;
+  DiffCollector collect(diffs);
+
+  stringstream ss1(fs2), ss2(fs2);
+  BOOST_CHECK_EQUAL(stream_diff(ss1, ss2, collect), 0);
+  BOOST_CHECK(diffs.empty());
+
+  Coll c1 = Coll::from_str(fs2);
+  c1.field("test2;2,2;1") = "3";
+  stringstream ss3(fs2), ss4(c1.str());
+  BOOST_CHECK_EQUAL(stream_diff(ss3, ss4, collect), 1);
+  BOOST_REQUIRE_EQUAL(diffs.size(), 1);
+  BOOST_CHECK_EQUAL(diffs[0].kind, BlockDifference::modified);
+  BOOST_CHECK_EQUAL(diffs[0].old_block, Coll::from_str(fs2).at("test2"));
+  BOOST_CHECK_EQUAL(diffs[0].new_block, c1.at("test2"));
+
+  Coll c2;
+  c2.push_back(c1.at("test3"));
+  c2.push_back("BLOCK test5\n 5 1");
+  c2.push_back(c1.at("test1"));
+  c2.push_back(c1.at("test2"));
+  c2.push_back("block TEST3\n 3 1");
+  diffs.clear();
+  stringstream ss5(fs2), ss6(c2.str());
+  BOOST_CHECK_EQUAL(stream_diff(ss5, ss6, collect), 4);
+  BOOST_REQUIRE_EQUAL(diffs.size(), 4);
+  BOOST_CHECK_EQUAL(diffs[0].kind, BlockDifference::modified);
+  BOOST_CHECK_EQUAL(diffs[0].old_block.name(), "test2");
+  BOOST_CHECK_EQUAL(diffs[0].new_block, c1.at("test2"));
+  BOOST_CHECK_EQUAL(diffs[1].kind, BlockDifference::erased);
+  BOOST_CHECK_EQUAL(diffs[1].old_block, Coll::from_str(fs2).at("test4"));
+  BOOST_CHECK(diffs[1].new_block.empty());
+  BOOST_CHECK_EQUAL(diffs[2].kind, BlockDifference::inserted);
+  BOOST_CHECK_EQUAL(diffs[2].new_block.name(), "test5");
+  BOOST_CHECK_EQUAL(diffs[3].kind, BlockDifference::inserted);
+  BOOST_CHECK_EQUAL(diffs[3].new_block.name(), "TEST3");
+
+  diffs.clear();
+  stringstream ss7(c2.str()), ss8(fs2);
+  BOOST_CHECK_EQUAL(stream_diff(ss7, ss8, collect), 4);
+  BOOST_CHECK_EQUAL(diffs[0].kind, BlockDifference::modified);
+  BOOST_CHECK_EQUAL(diffs[0].old_block, c1.at("test2"));
+  BOOST_CHECK_EQUAL(diffs[1].old_block.name(), "test5");
+  BOOST_CHECK_EQUAL(diffs[2].old_block.name(), "TEST3");
+  BOOST_CHECK_EQUAL(diffs[3].new_block.name(), "test4");
+
+  vector<BlockDifference> seekable_diffs;
+  seekable_diffs.swap(diffs);
+  UnseekableBuf buf1(c2.str()), buf2(fs2);
+  istream is1(&buf1), is2(&buf2);
+  BOOST_CHECK_EQUAL(stream_diff(is1, is2, collect), 4);
+  BOOST_REQUIRE_EQUAL(diffs.size(), 4);
+  for (size_t i = 0; i < diffs.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(diffs[i].kind, seekable_diffs[i].kind);
+    BOOST_CHECK_EQUAL(diffs[i].old_block, seekable_diffs[i].old_block);
+    BOOST_CHECK_EQUAL(diffs[i].new_block, seekable_diffs[i].new_block);
+  }
+
+  // Blocks that only moved have equal hashes, so their content is
+  // compared and they are not reported.
+  diffs.clear();
+  UnseekableBuf buf3("BLOCK A\n 1 2\n 3 4\nBLOCK B\n 1\n"),
+    buf4("BLOCK B\n 1\nBLOCK A\n 1 2\n 3 4\n");
+  istream is3(&buf3), is4(&buf4);
+  BOOST_CHECK_EQUAL(stream_diff(is3, is4, collect), 0);
+  BOOST_CHECK(diffs.empty());
+
+  // Lines before the first block definition form a nameless Block.
+  const string s9 = "# header\nBLOCK A\n 1 2\n";
+  stringstream ss9(s9), ss10("BLOCK A\n 1 2\n");
+  BOOST_CHECK_EQUAL(stream_diff(ss9, ss10, collect), 1);
+  BOOST_REQUIRE_EQUAL(diffs.size(), 1);
+  BOOST_CHECK_EQUAL(diffs[0].kind, BlockDifference::erased);
+  BOOST_CHECK_EQUAL(diffs[0].old_block, Coll::from_str(s9).front());
+  BOOST_CHECK_EQUAL(diffs[0].old_block.str(), "# header\n");
+
+  // Names and formatting are compared exactly.
+  diffs.clear();
+  stringstream ss11("BLOCK A\n 1 2\n"), ss12("BLOCK a\n 1   2\n");
+  BOOST_CHECK_EQUAL(stream_diff(ss11, ss12, collect), 1);
+  BOOST_CHECK_EQUAL(diffs[0].kind, BlockDifference::modified);
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadProjection, F) {
+  Projection p1;
+  p1.add("TEST2", 1).add("test3", 0);
+
+  stringstream ss1(fs1 + fs2);
+  Coll c1;
+  c1.read(ss1, p1);
+
+  BOOST_CHECK_EQUAL(c1.size(), 6);
+  BOOST_CHECK_EQUAL(c1.front().str(), Coll::from_str(fs1).front().str());
+  BOOST_CHECK_EQUAL(c1.at("test2").front().str(), "Block test2 # 4th comment");
+  BOOST_CHECK_EQUAL(c1.at("test2").size(), 4);
+  BOOST_CHECK_EQUAL(c1.at("test2").begin()[1].size(), 2);
+  BOOST_CHECK_EQUAL(c1.at("test2").begin()[1][0], "");
+  BOOST_CHECK_EQUAL(c1.at("test2").begin()[1][1], "1");
+  BOOST_CHECK_EQUAL(c1.field("test2;(any),1;1"), "1");
+
+  BOOST_CHECK_EQUAL(c1.at("test3").size(), 3);
+  BOOST_CHECK_EQUAL(c1.at("test3").back().size(), 1);
+  BOOST_CHECK_EQUAL(c1.field("test3;3;0"), "3");
+  BOOST_CHECK_EQUAL(c1.at("test4"), Coll::from_str(fs2).at("test4"));
+
+  BOOST_CHECK(Projection().empty());
+  BOOST_CHECK(Projection().find("test2") == 0);
+  BOOST_CHECK(p1.find("Test3") != 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testLookupAfterChanges, F) {
+  Coll c1;
+  c1.str(fs2);
+  const Coll& cc1 = c1;
+
+  BOOST_CHECK_EQUAL(c1.field("test1;1;1"), "1");
+  BOOST_CHECK_EQUAL(cc1.field("test1;1;1"), "1");
+  BOOST_CHECK_EQUAL(cc1.field(string("test1;1;1")), "1");
+  BOOST_CHECK_EQUAL(&c1.field("test1;1;1"), &c1.field(Key("test1;1;1")));
+  BOOST_CHECK_EQUAL(&cc1.line("test2;2;0"), &c1.at("test2").begin()[1]);
+  BOOST_CHECK_EQUAL(&cc1.block(string("test2;2;0")), &c1.at("test2"));
+  BOOST_CHECK_THROW(cc1.field("test1;1"), invalid_argument);
+
+  c1.push_front("BLOCK test1\n 1 0");
+  BOOST_CHECK_EQUAL(c1.field("test1;1;1"), "0");
+  c1.erase(c1.begin());
+  BOOST_CHECK_EQUAL(cc1.field("test1;1;1"), "1");
+
+  Block& b1 = c1.at("test1");
+  BOOST_CHECK_EQUAL(c1.field("test1;1;1"), "1");
+  b1.insert(b1.begin(), Line(" 1 99"));
+  BOOST_CHECK_EQUAL(cc1.field("test1;1;1"), "99");
+  b1.name("test0");
+  BOOST_CHECK_THROW(cc1.field("test1;1;1"), out_of_range);
+  b1.name("test1");
+
+  Line& l1 = c1.at("test2").begin()[1];
+  BOOST_CHECK_EQUAL(cc1.field("test2;(any),2;0"), "2");
+  BOOST_CHECK_EQUAL(cc1.field("test2;(any),2;0"), "2");
+  l1[0] = "5";
+  l1[1] = "2";
+  BOOST_CHECK_EQUAL(cc1.field("test2;(any),2;0"), "5");
+
+  BOOST_CHECK_EQUAL(cc1.field("test3;3,2;0"), "3");
+  c1.field("test3;3;0") = "4";
+  BOOST_CHECK_EQUAL(cc1.field("test3;3;1"), "2");
+  c1.line("test3;4;0") = " 3 1";
+  BOOST_CHECK_EQUAL(cc1.field("test3;3;1"), "1");
+
+  Coll::checkpoint_type cp = c1.checkpoint();
+  c1.field("test4;4,2;1") = "3";
+  BOOST_CHECK_THROW(cc1.field("test4;4,2;1"), out_of_range);
+  c1.rollback(cp);
+  BOOST_CHECK_EQUAL(cc1.field("test4;4,2;1"), "2");
+
+  BOOST_CHECK_THROW(cc1.field("test4;4,2;5"), out_of_range);
+  BOOST_CHECK_THROW(cc1.field("test4;4,2"), invalid_argument);
+  BOOST_CHECK_THROW(cc1.line("test5;1;0"), out_of_range);
+}
+
+BOOST_FIXTURE_TEST_CASE(testHandles, F) {
+  Coll c1;
+  c1.str(fs2);
+  const Coll::handle_type h2 = c1.handle(c1.find("test2"));
+  const Coll::handle_type h3 = c1.handle(c1.find("test3"));
+
+  c1.push_front("BLOCK test0");
+  c1.push_back("BLOCK test5");
+  c1.erase_first("test1");
+  BOOST_CHECK_EQUAL(c1.resolve(h2)->name(), "test2");
+  BOOST_CHECK_EQUAL(c1.resolve(h3)->name(), "test3");
+
+  Coll::checkpoint_type cp = c1.checkpoint();
+  c1.resolve(h3)->push_back(" 3 3");
+  c1.erase_first("test2");
+  BOOST_CHECK(c1.resolve(h2) == 0);
+  BOOST_CHECK_EQUAL(c1.resolve(h3)->size(), 4);
+  c1.rollback(cp);
+  BOOST_CHECK(c1.resolve(h2) == 0);
+  BOOST_CHECK_EQUAL(c1.resolve(h3)->size(), 3);
+
+  const Coll& cc1 = c1;
+  BOOST_CHECK_EQUAL(cc1.resolve(h3)->name(), "test3");
+  c1.clear();
+  BOOST_CHECK(cc1.resolve(h3) == 0);
+}
+
+struct ChangeCounter {
+  explicit ChangeCounter(size_t& count) : count_(count) {}
+  void operator()(const Change&) const { ++count_; }
+  size_t& count_;
+};
+
+BOOST_FIXTURE_TEST_CASE(testJournal, F) {
+  Coll c1;
+  c1.str(fs2);
+  BOOST_CHECK(c1.drain_changes().empty());
+
+  size_t observed = 0;
+  c1.add_observer(ChangeCounter(observed));
+  c1.enable_journal();
+  BOOST_CHECK(c1.journal_enabled());
+
+  c1["test1"]["1"][1] = "11";
+  c1["test1"].push_back(" 1  3");
+  c1.erase_first("test4");
+  c1.push_front("BLOCK test0");
+
+  vector<Change> changes = c1.drain_changes();
+  BOOST_CHECK_EQUAL(changes.size(), 11);
+  BOOST_CHECK_EQUAL(observed, 11);
+
+  BOOST_CHECK_EQUAL(changes[0].kind, Change::erased);
+  BOOST_CHECK_EQUAL(changes[0].block, "test4");
+  BOOST_CHECK_EQUAL(changes[0].old_value, "BlOcK");
+  BOOST_CHECK_EQUAL(changes[0].new_value, "");
+  BOOST_CHECK_EQUAL(changes[5].line, 2);
+  BOOST_CHECK_EQUAL(changes[5].old_value, "2");
+
+  BOOST_CHECK_EQUAL(changes[6].kind, Change::inserted);
+  BOOST_CHECK_EQUAL(changes[6].block, "test0");
+  BOOST_CHECK_EQUAL(changes[7].new_value, "test0");
+
+  BOOST_CHECK_EQUAL(changes[8].kind, Change::modified);
+  BOOST_CHECK_EQUAL(changes[8].block, "test1");
+  BOOST_CHECK_EQUAL(changes[8].line, 1);
+  BOOST_CHECK_EQUAL(changes[8].field, 1);
+  BOOST_CHECK_EQUAL(changes[8].old_value, "1");
+  BOOST_CHECK_EQUAL(changes[8].new_value, "11");
+  BOOST_CHECK_EQUAL(changes[9].kind, Change::inserted);
+  BOOST_CHECK_EQUAL(changes[9].line, 3);
+  BOOST_CHECK_EQUAL(changes[10].new_value, "3");
+
+  BOOST_CHECK(c1.drain_changes().empty());
+
+  c1.reformat();
+  BOOST_CHECK(c1.drain_changes().empty());
+
+  for (Coll::iterator it = c1.begin(); it != c1.end(); ++it) {}
+  c1.at("test3").back()[1] = "x";
+  c1.push_front("BLOCK test5");
+  c1.erase_first("test1");
+  changes = c1.drain_changes();
+  BOOST_CHECK_EQUAL(changes.size(), 11);
+  BOOST_CHECK_EQUAL(changes[0].kind, Change::erased);
+  BOOST_CHECK_EQUAL(changes[0].block, "test1");
+  BOOST_CHECK_EQUAL(changes[8].kind, Change::inserted);
+  BOOST_CHECK_EQUAL(changes[8].block, "test5");
+  changes.erase(changes.begin(), changes.end() - 1);
+  BOOST_CHECK_EQUAL(changes[0].block, "test3");
+  BOOST_CHECK_EQUAL(changes[0].line, 2);
+  BOOST_CHECK_EQUAL(changes[0].old_value, "2");
+  BOOST_CHECK_EQUAL(changes[0].new_value, "x");
+
+  Coll::checkpoint_type cp = c1.checkpoint();
+  c1.field("test2;2,2;1") = "22";
+  c1.erase("test3");
+  BOOST_CHECK_EQUAL(c1.drain_changes().size(), 7);
+  c1.rollback(cp);
+  changes = c1.drain_changes();
+  BOOST_CHECK_EQUAL(changes.size(), 7);
+  BOOST_CHECK_EQUAL(changes[0].block, "test2");
+  BOOST_CHECK_EQUAL(changes[0].old_value, "22");
+  BOOST_CHECK_EQUAL(changes[0].new_value, "2");
+  BOOST_CHECK_EQUAL(changes[1].kind, Change::inserted);
+  BOOST_CHECK_EQUAL(changes[1].block, "test3");
+
+  Coll c2(c1);
+  BOOST_CHECK(!c2.journal_enabled());
+  c2.enable_journal();
+  c2.field("test2;2,2;1") = "22";
+  BOOST_CHECK_EQUAL(c2.drain_changes().size(), 1);
+  c2 = c1;
+  BOOST_CHECK(c2.journal_enabled());
+  BOOST_CHECK_EQUAL(observed, 36);
+
+  c1.field("test2;2,2;1") = "22";
+  c1.disable_journal();
+  BOOST_CHECK(c1.drain_changes().empty());
+
+  Coll c3 = Coll::from_str(fs2);
+  Block& test2 = c3.at("test2");
+  Line& line = test2.back();
+  c3.enable_journal();
+  line[1] = "x";
+  test2.push_back(" 9 9");
+  changes = c3.drain_changes();
+  BOOST_CHECK_EQUAL(changes.size(), 3);
+  BOOST_CHECK_EQUAL(changes[0].kind, Change::modified);
+  BOOST_CHECK_EQUAL(changes[0].new_value, "x");
+  BOOST_CHECK_EQUAL(changes[1].kind, Change::inserted);
+  BOOST_CHECK_EQUAL(changes[2].new_value, "9");
+}
+
+BOOST_FIXTURE_TEST_CASE(testFreeze, F) {
+  Coll c1;
+  for (int i = 0; i < 40; ++i) c1.push_back("BLOCK B" + to_string(i));
+  c1.push_back("BLOCK MASS\n 25 125.0");
+  const Coll& cc1 = c1;
+
+  Block& b1 = c1.at("B3");
+  BOOST_CHECK(cc1.find("SPINFO") == cc1.end());
+  BOOST_CHECK(cc1.find("SPINFO") == cc1.end());
+  b1.name("SPINFO");
+  BOOST_CHECK(cc1.find("SPINFO") == cc1.begin() + 3);
+  BOOST_CHECK_EQUAL(cc1.count("SPINFO"), 1);
+  BOOST_CHECK_EQUAL(&c1.at("SPINFO"), &b1);
+
+  Line& l1 = c1.at("MASS").at("25");
+  BOOST_CHECK_EQUAL(cc1.field("MASS;25;1"), "125.0");
+  BOOST_CHECK_EQUAL(cc1.field("MASS;25;1"), "125.0");
+  l1[0] = "35";
+  BOOST_CHECK_EQUAL(cc1.field("MASS;35;1"), "125.0");
+  BOOST_CHECK_THROW(cc1.field("MASS;25;1"), out_of_range);
+
+  BOOST_CHECK(!cc1.frozen());
+  c1.freeze();
+  BOOST_CHECK(cc1.frozen());
+  BOOST_CHECK(cc1.at("MASS").frozen());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK(cc1.find("spinfo") == cc1.begin() + 3);
+    BOOST_CHECK(cc1.find("B3") == cc1.end());
+    BOOST_CHECK(cc1.find("mass") == cc1.end() - 1);
+    BOOST_CHECK_EQUAL(cc1.count("B7"), 1);
+    BOOST_CHECK_EQUAL(cc1.count("B40"), 0);
+    BOOST_CHECK_EQUAL(cc1.field("MASS;35;1"), "125.0");
+  }
+
+  c1.field("MASS;35;0") = "25";
+  BOOST_CHECK(cc1.frozen());
+  BOOST_CHECK(cc1.at("MASS").frozen());
+  BOOST_CHECK_EQUAL(cc1.field("MASS;25;1"), "125.0");
+
+  c1.at("spinfo").name("B3");
+  BOOST_CHECK(cc1.find("B3") == cc1.begin() + 3);
+  BOOST_CHECK(cc1.find("SPINFO") == cc1.end());
+
+  Coll::checkpoint_type cp = c1.checkpoint();
+  c1.push_back("BLOCK B40");
+  BOOST_CHECK_EQUAL(cc1.count("B40"), 1);
+  BOOST_CHECK(cc1.at("B40").frozen());
+  c1.rollback(cp);
+  BOOST_CHECK(cc1.frozen());
+  BOOST_CHECK(cc1.at("MASS").frozen());
+  BOOST_CHECK_EQUAL(cc1.count("B40"), 0);
+  BOOST_CHECK_THROW(c1.at("B40"), out_of_range);
+
+  const Coll c2(c1);
+  BOOST_CHECK(!c2.frozen());
+  BOOST_CHECK(cc1.frozen());
+
+  c1.thaw();
+  BOOST_CHECK(!cc1.frozen());
+  BOOST_CHECK(!cc1.at("MASS").frozen());
+}
+
+BOOST_FIXTURE_TEST_CASE(testTryAccess, F) {
+  Coll c1;
+  c1.str(fs2);
+  const Coll cc1(c1);
+
+  BOOST_CHECK_EQUAL(c1.try_block(Key("test2;;0")), &c1.at("test2"));
+  BOOST_CHECK_EQUAL(cc1.try_block(Key("TEST3;;0"))->name(), "test3");
+  BOOST_CHECK(c1.try_block(Key("test9;;0")) == 0);
+
+  BOOST_CHECK_EQUAL(c1.try_line(Key("test2;2,2;0")),
+                    &c1.line(Key("test2;2,2;0")));
+  BOOST_CHECK(cc1.try_line(Key("test2;2,3;0")) == 0);
+  BOOST_CHECK(cc1.try_line(Key("test9;2,2;0")) == 0);
+
+  *c1.try_field(Key("test4;4,2;1")) = "42";
+  BOOST_CHECK_EQUAL(c1.field("test4;4,42;1"), "42");
+  BOOST_CHECK_EQUAL(*cc1.try_field(Key("test4;4,1;0")), "4");
+  BOOST_CHECK(cc1.try_field(Key("test4;4,1;2")) == 0);
+  BOOST_CHECK(cc1.try_field(Key("test4;4,3;0")) == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <boost/test/unit_test.hpp>
@@ -116,4 +117,38 @@ BOOST_AUTO_TEST_CASE(testStr)
   BOOST_CHECK(ss.str() == k1.str());
 }
 
+BOOST_AUTO_TEST_CASE(testTryStr)
+{
+  Key k1("A;B;1");
+
+  BOOST_CHECK(k1.try_str("C;D,E;2"));
+  BOOST_CHECK_EQUAL(k1.str(), "C;D,E;2");
+
+  BOOST_CHECK(!k1.try_str("C;D"));
+  BOOST_CHECK(!k1.try_str("C;D;E;2"));
+  BOOST_CHECK(!k1.try_str("C;D;x"));
+  BOOST_CHECK_EQUAL(k1.str(), "C;D,E;2");
+}
+
+BOOST_AUTO_TEST_CASE(testInternedKey)
+{
+  const InternedKey k1("MASS;1000022;1");
+  const InternedKey k2(string("MASS;1000022;1"));
+  const InternedKey k3("MASS;1000023;1");
+
+  BOOST_CHECK(k1 == k2);
+  BOOST_CHECK(k1 != k3);
+  BOOST_CHECK_EQUAL(&k1.get(), &*k2);
+  BOOST_CHECK_EQUAL(k1->block, "MASS");
+  BOOST_CHECK_EQUAL(k3->line[0], "1000023");
+  BOOST_CHECK_EQUAL(k3.get().str(), "MASS;1000023;1");
+  BOOST_CHECK_THROW(InternedKey("MASS;1000022"), invalid_argument);
+
+  Coll c1;
+  c1["MASS"][""] << "BLOCK" << "MASS";
+  c1["MASS"][""] << 1000022 << "91.2";
+  BOOST_CHECK_EQUAL(c1.field(k1), "91.2");
+  BOOST_CHECK_EQUAL(&c1.line(k2), &c1.line(Key("MASS;1000022;0")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
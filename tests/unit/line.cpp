@@ -124,6 +124,39 @@ BOOST_AUTO_TEST_CASE(testAssignmentOperator)
   BOOST_CHECK_EQUAL(l1.data_size(), 4);
 }
 
+BOOST_AUTO_TEST_CASE(testProjectedStr)
+{
+  vector<bool> fields(3, false);
+  fields[0] = true;
+  fields[2] = true;
+
+  Line l1;
+  l1.str(" 1  2  3  4  # comment", fields);
+  BOOST_CHECK_EQUAL(l1.size(), 3);
+  BOOST_CHECK_EQUAL(l1[0],     "1");
+  BOOST_CHECK_EQUAL(l1[1],     "");
+  BOOST_CHECK_EQUAL(l1[2],     "3");
+
+  l1.str(" 1  2#3 4", fields);
+  BOOST_CHECK_EQUAL(l1.size(), 3);
+  BOOST_CHECK_EQUAL(l1[2],     "#3 4");
+
+  l1.str(" 1  2", fields);
+  BOOST_CHECK_EQUAL(l1.size(), 1);
+  BOOST_CHECK_EQUAL(l1[0],     "1");
+
+  l1.str("# comment  \n 2 3", fields);
+  BOOST_CHECK_EQUAL(l1.size(), 1);
+  BOOST_CHECK_EQUAL(l1[0],     "# comment");
+
+  l1.str("Block MASS Q= 100 # comment", vector<bool>(2, false));
+  BOOST_CHECK_EQUAL(l1.size(), 5);
+  BOOST_CHECK(l1.is_block_def());
+
+  l1.str(" 1  2", vector<bool>(2, false));
+  BOOST_CHECK(l1.empty());
+}
+
 BOOST_AUTO_TEST_CASE(testAppending)
 {
   Line l1;
@@ -292,6 +325,9 @@ BOOST_AUTO_TEST_CASE(testAtAccessor)
   BOOST_CHECK_EQUAL(l1.at(2), "3");
   BOOST_CHECK_EQUAL(l1.at(3), "# 2 1");
   BOOST_CHECK_EQUAL(l1.size(), 4);
+
+  BOOST_CHECK_THROW(l1.at(4), out_of_range);
+  BOOST_CHECK_THROW(cl1.at(4), out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE(testGeneralAccessors)
@@ -0,0 +1,146 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+BOOST_AUTO_TEST_SUITE(TestNumericBlock)
+
+BOOST_AUTO_TEST_CASE(testConversion)
+{
+  const Block b1 = Block::from_str(
+    "BLOCK MASS  # mass spectrum\n"
+    "   25     1.25000000E+02   # h0\n"
+    "   1000021  5.6D2\n"
+    "# comment line\n"
+    "   1000022  -9.7E+01  -1\n");
+
+  const NumericBlock nb1(b1);
+  BOOST_CHECK_EQUAL(nb1.name(), "MASS");
+  BOOST_CHECK_EQUAL(nb1.block_def().str(), b1.front().str());
+  BOOST_CHECK_EQUAL(nb1.size(), 4);
+  BOOST_CHECK_EQUAL(nb1.size(0), 2);
+  BOOST_CHECK_EQUAL(nb1.size(2), 0);
+  BOOST_CHECK_EQUAL(nb1.size(3), 3);
+
+  BOOST_CHECK_EQUAL(nb1(0, 0), 25.);
+  BOOST_CHECK_EQUAL(nb1(0, 1), 125.);
+  BOOST_CHECK_EQUAL(nb1.at(1, 1), 560.);
+  BOOST_CHECK_EQUAL(nb1.at(3, 2), -1.);
+  BOOST_CHECK(nb1.is_integral(0, 0));
+  BOOST_CHECK(!nb1.is_integral(0, 1));
+  BOOST_CHECK(nb1.is_integral(3, 2));
+  BOOST_CHECK_THROW(nb1.at(2, 0), out_of_range);
+  BOOST_CHECK_THROW(nb1.at(4, 0), out_of_range);
+
+  BOOST_CHECK_EQUAL(nb1.find(1000021), 1);
+  BOOST_CHECK_EQUAL(nb1.find(1000022, -97.), 3);
+  BOOST_CHECK(nb1.find(1000023) == NumericBlock::npos);
+
+  Block b2;
+  b2[""] << "BLOCK" << "MASS" << "# mass spectrum";
+  b2[""] << 25 << 125. << "# h0";
+  b2[""] << 1000021 << 560.;
+  b2[""] << "# comment line";
+  b2[""] << 1000022 << -97. << -1;
+  BOOST_CHECK_EQUAL(nb1.str(), b2.str());
+  BOOST_CHECK_EQUAL(nb1.block().str(), b2.str());
+  BOOST_CHECK_EQUAL(nb1.block().name(), "MASS");
+
+  BOOST_CHECK_THROW(NumericBlock(Block::from_str("BLOCK A\n 1 x")),
+                    invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testModification)
+{
+  NumericBlock nb1(Block::from_str("DECAY 6 1.4\n 1.0 2 5 24"));
+  BOOST_CHECK_EQUAL(nb1.name(), "6");
+
+  nb1.set(0, 0, 0.5);
+  nb1.set(0, 3, 37L);
+  BOOST_CHECK_EQUAL(nb1(0, 0), .5);
+  BOOST_CHECK_EQUAL(nb1(0, 3), 37.);
+  BOOST_CHECK(nb1.is_integral(0, 3));
+  BOOST_CHECK_THROW(nb1.set(0, 4, 1.), out_of_range);
+
+  Block b1;
+  b1[""] << "DECAY" << 6 << "1.4";
+  b1[""] << .5 << 2 << 5 << 37;
+  BOOST_CHECK_EQUAL(nb1.str(), b1.str());
+
+  nb1.clear();
+  BOOST_CHECK(nb1.empty());
+  BOOST_CHECK_EQUAL(nb1.str(), "");
+}
+
+BOOST_AUTO_TEST_CASE(testRead)
+{
+  const string str =
+    "BLOCK MASS Q= 9.1E+02 # mass spectrum\n"
+    "   25     1.25000000E+02   # h0\n"
+    "\n"
+    "   1000021  5.6D2\n"
+    "# comment line\n"
+    "   1000022  -9.7E+01  -1\n"
+    "DECAY 6 1.4\n"
+    " 1.0 2 5 24\n";
+
+  istringstream is(str);
+  const NumericBlock nb1(is);
+  const NumericBlock nb2(Block::from_str(str));
+  BOOST_CHECK_EQUAL(nb1.str(), nb2.str());
+  BOOST_CHECK_EQUAL(nb1.name(), "MASS");
+  BOOST_CHECK_EQUAL(nb1.size(), 4);
+  BOOST_CHECK_EQUAL(nb1.size(2), 0);
+  BOOST_CHECK_EQUAL(nb1(1, 1), 560.);
+  BOOST_CHECK(nb1.is_integral(3, 2));
+  BOOST_CHECK_EQUAL(nb1.def_value(), 910.);
+
+  NumericBlock nb3(is);
+  BOOST_CHECK_EQUAL(nb3.name(), "6");
+  BOOST_CHECK_EQUAL(nb3.def_value(), 1.4);
+  BOOST_CHECK_EQUAL(nb3.size(), 1);
+  BOOST_CHECK_EQUAL(nb3(0, 3), 24.);
+  BOOST_CHECK(nb3.read(is).empty());
+  BOOST_CHECK(std::isnan(nb3.def_value()));
+
+  istringstream is2("BLOCK A Q=1D3\n 1 2\n");
+  BOOST_CHECK_EQUAL(NumericBlock(is2).def_value(), 1000.);
+  BOOST_CHECK(std::isnan(
+    NumericBlock(Block::from_str("BLOCK A\n 1 2")).def_value()));
+
+  istringstream is3("BLOCK A\n 1 x\n");
+  BOOST_CHECK_THROW(NumericBlock nb4(is3), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testColl)
+{
+  const Coll coll = Coll::from_str(
+    "BLOCK SPINFO\n"
+    "    1   SOFTSUSY\n"
+    "BLOCK MODSEL\n"
+    "    1   1\n"
+    "    2   100000000000000000000\n");
+
+  const NumericBlock nb = coll.numeric("MODSEL");
+  BOOST_CHECK_EQUAL(nb.name(), "MODSEL");
+  BOOST_CHECK_EQUAL(nb.at(1, 1), 1E+20);
+  BOOST_CHECK(nb.is_integral(1, 1));
+  BOOST_CHECK_EQUAL(nb.block().at("2").at(1), "100000000000000000000");
+
+  BOOST_CHECK_THROW(coll.numeric("SPINFO"), invalid_argument);
+  BOOST_CHECK_THROW(coll.numeric("MASS"), out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
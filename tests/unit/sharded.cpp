@@ -0,0 +1,83 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "slhaea_sharded.h"
+
+using namespace std;
+using namespace SLHAea;
+
+BOOST_AUTO_TEST_SUITE(TestShardedColl)
+
+BOOST_AUTO_TEST_CASE(testRead)
+{
+  string input = "# leading comment\n 1 2\n";
+  for (int i = 0; i < 300; ++i)
+  {
+    input += "DECAY " + to_string(1000000 + i) + " 1.5\n"
+             "   0.5  2  1  -1\n"
+             "   0.5  2  3  -3\n\n";
+    if (i % 100 == 0) input += "BLOCK MASS Q= " + to_string(i) + "\n 25 125\n";
+  }
+  const Coll c1 = Coll::from_str(input);
+
+  for (unsigned int threads = 1; threads <= 4; threads += 3)
+  {
+    ShardedColl s1(7);
+    s1.read(input.data(), input.data() + input.size(), threads);
+
+    BOOST_CHECK_EQUAL(s1.size(), c1.size());
+    BOOST_CHECK_EQUAL(s1.shard_count(), 7);
+    BOOST_CHECK(equal(s1.begin(), s1.end(), c1.begin()));
+    BOOST_CHECK_EQUAL(s1.str(), c1.str());
+
+    ShardedColl::size_type total = 0;
+    for (ShardedColl::size_type i = 0; i < s1.shard_count(); ++i)
+    {
+      BOOST_CHECK(!s1.shard_blocks(i).empty());
+      total += s1.shard_blocks(i).size();
+    }
+    BOOST_CHECK_EQUAL(total, c1.size());
+
+    BOOST_CHECK_EQUAL(s1.begin()->name(), "");
+    BOOST_CHECK_EQUAL(&*s1.find("1000123"), &s1.at("1000123"));
+    BOOST_CHECK_EQUAL(s1.find("1000123") - s1.begin(), 126);
+    BOOST_CHECK_EQUAL(s1.at("mass").front()[3], "0");
+    BOOST_CHECK_EQUAL(s1.count("MASS"), 3);
+    BOOST_CHECK_EQUAL(s1.count("1000300"), 0);
+    BOOST_CHECK(s1.find("1000300") == s1.end());
+    BOOST_CHECK_THROW(s1.at("1000300"), out_of_range);
+    BOOST_CHECK_EQUAL(s1.field("1000299;0.5,2,3;3"), "-3");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testModify)
+{
+  ShardedColl s1;
+  BOOST_CHECK(s1.empty());
+  BOOST_CHECK_EQUAL(s1.shard_count(), 16);
+
+  stringstream ss("BLOCK A\n 1 1\nBLOCK B\n 2 2\n");
+  s1.read(ss);
+  s1.push_back(Block::from_str("BLOCK a\n 3 3"));
+  BOOST_CHECK_EQUAL(s1.size(), 3);
+  BOOST_CHECK_EQUAL(s1.count("A"), 2);
+  BOOST_CHECK_EQUAL(s1.at("A").back()[0], "1");
+  BOOST_CHECK_EQUAL((s1.begin() + 2)->back()[0], "3");
+  BOOST_CHECK_EQUAL(s1.str(), "BLOCK A\n 1 1\nBLOCK B\n 2 2\nBLOCK a\n 3 3\n");
+
+  s1.clear();
+  BOOST_CHECK(s1.empty());
+  BOOST_CHECK_EQUAL(s1.count("A"), 0);
+  BOOST_CHECK_EQUAL(ShardedColl(0).shard_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
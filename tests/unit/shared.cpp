@@ -0,0 +1,141 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "slhaea_shared.h"
+
+using namespace std;
+using namespace SLHAea;
+
+#ifdef SLHAEA_HAS_POSIX
+BOOST_AUTO_TEST_SUITE(TestSharedColl)
+
+struct F {
+  F() : name("/slhaea_ut_" + to_string(getpid())) {
+    coll.str("BLOCK MODSEL  # model selection\n"
+             "    1    1    # mSUGRA\n"
+             "Block SMINPUTS\n"
+             "    1   1.27934000E+02   # alpha_em^-1(M_Z)^MSbar\n"
+             "    3   1.17200000E-01\n"
+             "# a comment line\n"
+             "DECAY 1000021 1.5\n"
+             "    0.5  2  1000001  -1\n"
+             "    0.5  2  -1000001  1\n");
+    coll["SMINPUTS"]["3"][1] = "1.172E-01_modified";
+    SharedColl::create(name, coll);
+  }
+
+  ~F() { SharedColl::remove(name); }
+
+  string name;
+  Coll coll;
+};
+
+BOOST_FIXTURE_TEST_CASE(testRoundTrip, F)
+{
+  const SharedColl shared(name);
+
+  BOOST_CHECK_EQUAL(shared.size(), coll.size());
+  BOOST_CHECK_EQUAL(shared.to_coll(), coll);
+
+  ostringstream os;
+  os << shared;
+  BOOST_CHECK_EQUAL(os.str(), coll.str());
+}
+
+BOOST_FIXTURE_TEST_CASE(testLookup, F)
+{
+  const SharedColl shared(name);
+
+  BOOST_CHECK_EQUAL(shared.at("modsel").name(), "MODSEL");
+  BOOST_CHECK_EQUAL(shared.at("MODSEL").size(), 2);
+  BOOST_CHECK_EQUAL(shared.count("sminputs"), 1);
+  BOOST_CHECK_EQUAL(shared.count("foo"), 0);
+  BOOST_CHECK(shared.find("foo") == shared.end());
+  BOOST_CHECK_THROW(shared.at("foo"), out_of_range);
+
+  BOOST_CHECK_EQUAL(shared.field("MODSEL;1;1"), "1");
+  BOOST_CHECK_EQUAL(shared.field("SMINPUTS;1;2"), "# alpha_em^-1(M_Z)^MSbar");
+  BOOST_CHECK_EQUAL(shared.field("SMINPUTS;3;1"), "1.172E-01_modified");
+  BOOST_CHECK_EQUAL(shared.field("1000021;(any),2,-1000001;0"), "0.5");
+  BOOST_CHECK_EQUAL(shared.line("SMINPUTS;3;0").str(),
+                    coll.line("SMINPUTS;3;0").str());
+  BOOST_CHECK_THROW(shared.field("MODSEL;1;5"), out_of_range);
+  BOOST_CHECK_THROW(shared.line("MODSEL;2;0"), out_of_range);
+
+  const SharedBlock sminputs = shared.at("SMINPUTS");
+  BOOST_CHECK(sminputs.find_block_def() == sminputs.begin());
+  BOOST_CHECK(sminputs[0].is_block_def());
+  BOOST_CHECK(sminputs[1].is_data_line());
+  BOOST_CHECK(sminputs[3].is_comment_line());
+  BOOST_CHECK_EQUAL(sminputs.count(Block::key_type(1, "(any)")),
+                    coll.at("SMINPUTS").count(Block::key_type(1, "(any)")));
+}
+
+BOOST_FIXTURE_TEST_CASE(testConcurrentAttach, F)
+{
+  // A second process attaches the segment while it is recreated over
+  // and over. Every successful attach must see the complete content.
+  ostringstream mass;
+  mass << "BLOCK MASS\n";
+  for (int i = 0; i < 100000; ++i) mass << 1000000 + i << " 1.0\n";
+  Coll large = coll;
+  large.push_back(mass.str());
+
+  int done[2];
+  BOOST_REQUIRE_EQUAL(pipe(done), 0);
+  const pid_t child = fork();
+  BOOST_REQUIRE(child != -1);
+  if (child == 0)
+  {
+    close(done[1]);
+    fcntl(done[0], F_SETFL, O_NONBLOCK);
+    int status = 0;
+    char c;
+    while (status == 0 && read(done[0], &c, 1) == -1)
+    {
+      BOOST_TRY
+      {
+        const SharedColl shared(name);
+        const size_t size = shared.size();
+        if (size != coll.size() && size != large.size()) status = 1;
+        else if (shared.at("SMINPUTS").size() != 4) status = 2;
+        else if (size == large.size() &&
+                 shared[size - 1][100000][0] != "1099999") status = 3;
+      }
+      BOOST_CATCH(const runtime_error&) {}
+      BOOST_CATCH(...) { status = 4; }
+      BOOST_CATCH_END
+    }
+    _exit(status);
+  }
+
+  close(done[0]);
+  for (int i = 0; i < 20; ++i)
+  { SharedColl::create(name, i % 2 ? coll : large); }
+  close(done[1]);
+
+  int status = -1;
+  BOOST_REQUIRE_EQUAL(waitpid(child, &status, 0), child);
+  BOOST_CHECK(WIFEXITED(status));
+  BOOST_CHECK_EQUAL(WEXITSTATUS(status), 0);
+  BOOST_CHECK_EQUAL(SharedColl(name).to_coll(), coll);
+}
+
+BOOST_AUTO_TEST_CASE(testAttachFailure)
+{
+  BOOST_CHECK_THROW(SharedColl("/slhaea_ut_does_not_exist"), runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -0,0 +1,204 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+namespace {
+
+bool
+is_decay(const Block& block)
+{ return !block.empty() && block.front()[0] == "DECAY"; }
+
+bool
+is_light(const Line& line)
+{ return line.is_data_line() && to<int>(line[0]) < 100; }
+
+bool
+has_two_fields(const Line& line)
+{ return line.size() == 2; }
+
+const char* const input =
+  "BLOCK MASS\n"
+  "   25  1.25E+02\n"
+  "   1000021  5.6E+02\n"
+  "   6  1.73E+02  # top\n"
+  "DECAY 6 1.4\n"
+  "   1.0  2  5  24\n"
+  "BLOCK MINPAR\n"
+  "   1  1.0E+02\n"
+  "DECAY 25 4.1E-03\n"
+  "   0.6  2  5  -5\n";
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TestView)
+
+BOOST_AUTO_TEST_CASE(testBlockView)
+{
+  const Coll c1 = Coll::from_str(input);
+  const Block& mass = c1.at("MASS");
+
+  const BlockView v1(mass, is_light);
+  BOOST_CHECK_EQUAL(v1.name(), "MASS");
+  BOOST_CHECK_EQUAL(&v1.block(), &mass);
+  BOOST_CHECK_EQUAL(v1.size(), 2);
+  BOOST_CHECK_EQUAL(v1.positions()[1], 3);
+  BOOST_CHECK_EQUAL(&v1.front(), &mass.begin()[1]);
+  BOOST_CHECK_EQUAL(&v1.back(), &mass.begin()[3]);
+  BOOST_CHECK_EQUAL(&v1.at(Block::key_type(1, "6")), &mass.begin()[3]);
+  BOOST_CHECK_THROW(v1.at(Block::key_type(1, "1000021")), out_of_range);
+  BOOST_CHECK(v1.find(Block::key_type(1, "1000021")) == v1.end());
+  BOOST_CHECK_EQUAL(v1.count(Block::key_type(1, "25")), 1);
+  BOOST_CHECK_EQUAL(&v1.at("6"), &mass.begin()[3]);
+  BOOST_CHECK_EQUAL(&v1.at(25), &mass.begin()[1]);
+  BOOST_CHECK_EQUAL(&v1.at(vector<int>(1, 6)), &mass.begin()[3]);
+  BOOST_CHECK_THROW(v1.at(1000021), out_of_range);
+  BOOST_CHECK_THROW(v1.at("25", "1.25E+02", "x"), out_of_range);
+  BOOST_CHECK_EQUAL(v1.str(),
+    mass.begin()[1].str() + "\n" + mass.begin()[3].str() + "\n");
+
+  const BlockView v2 = v1.filter(has_two_fields);
+  BOOST_CHECK_EQUAL(v2.size(), 1);
+  BOOST_CHECK_EQUAL(&v2.front(), &mass.begin()[1]);
+
+  const BlockView v3(mass);
+  BOOST_CHECK_EQUAL(v3.size(), mass.size());
+  BOOST_CHECK_EQUAL(v3.str(), mass.str());
+
+  vector<BlockView::size_type> positions(1, 2);
+  positions.push_back(0);
+  const BlockView v4(mass, positions);
+  BOOST_CHECK_EQUAL(&*v4.begin(), &mass.begin()[2]);
+  BOOST_CHECK_EQUAL(&v4.back(), &mass.front());
+  positions.push_back(4);
+  BOOST_CHECK_THROW(BlockView(mass, positions), out_of_range);
+
+  const BlockView v5;
+  BOOST_CHECK(v5.empty());
+  BOOST_CHECK_EQUAL(v5.name(), "");
+}
+
+BOOST_AUTO_TEST_CASE(testCollView)
+{
+  const Coll c1 = Coll::from_str(input);
+
+  const CollView v1(c1, is_decay);
+  BOOST_CHECK_EQUAL(&v1.coll(), &c1);
+  BOOST_CHECK_EQUAL(v1.size(), 2);
+  BOOST_CHECK_EQUAL(&v1.front(), &c1.at("6"));
+  BOOST_CHECK_EQUAL(&v1.back(), &c1.at("25"));
+  BOOST_CHECK_EQUAL(v1.count("MASS"), 0);
+  BOOST_CHECK(v1.find("MASS") == v1.end());
+  BOOST_CHECK_THROW(v1.at("MASS"), out_of_range);
+  BOOST_CHECK_EQUAL(v1.field("25;0.6;3"), "-5");
+  BOOST_CHECK_THROW(v1.field("MASS;25;1"), out_of_range);
+  BOOST_CHECK_EQUAL(&v1.block("6;1.0;0"), &c1.at("6"));
+  BOOST_CHECK_EQUAL(&v1.line("25;0.6;0"), &c1.at("25").back());
+  BOOST_CHECK_THROW(v1.block("MASS;25;1"), out_of_range);
+  BOOST_CHECK_THROW(v1.line("25;0.7;0"), out_of_range);
+  BOOST_CHECK_EQUAL(v1.str(), c1.at("6").str() + c1.at("25").str());
+
+  const CollView v2 = CollView(c1).filter(Coll::key_matches("minpar"));
+  BOOST_CHECK_EQUAL(v2.size(), 1);
+  BOOST_CHECK_EQUAL(v2.positions()[0], 2);
+
+  const BlockView v3 = CollView(c1).view("MASS", is_light);
+  BOOST_CHECK_EQUAL(v3.size(), 2);
+  BOOST_CHECK_EQUAL(&v3.block(), &c1.at("MASS"));
+
+  vector<CollView::size_type> positions(1, 3);
+  BOOST_CHECK_EQUAL(&CollView(c1, positions).front(), &c1.at("25"));
+  positions.push_back(4);
+  BOOST_CHECK_THROW(CollView(c1, positions), out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(testRange)
+{
+  Coll c1 = Coll::from_str(input);
+  const Coll& cc1 = c1;
+
+  const BlockView v1 = cc1.at("MASS").range(0, 1, 100);
+  BOOST_REQUIRE_EQUAL(v1.size(), 2);
+  BOOST_CHECK_EQUAL(v1.front()[0], "6");
+  BOOST_CHECK_EQUAL(v1.back()[0], "25");
+  BOOST_CHECK_EQUAL(cc1.range("mass", 0, 25, 25).size(), 1);
+  BOOST_CHECK_EQUAL(cc1.range("MASS", 0, 26, 1000020).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range("MASS", 0, 100, 1).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range("MASS", 1, -1000, 1000).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range("6", 2, 5, 5).front()[3], "24");
+  BOOST_CHECK_EQUAL(cc1.range("25", 3, -5, -5).size(), 1);
+  BOOST_CHECK_THROW(cc1.range("SPINFO", 0, 0, 1), out_of_range);
+
+  const CollView v2 = cc1.range(1, 1, 1000);
+  BOOST_REQUIRE_EQUAL(v2.size(), 2);
+  BOOST_CHECK_EQUAL(&v2.front(), &cc1.at("6"));
+  BOOST_CHECK_EQUAL(&v2.back(), &cc1.at("25"));
+  BOOST_CHECK_EQUAL(cc1.range(1, 7, 24).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range(0, 0, 1).size(), 0);
+
+  c1.at("MASS").begin()[2][0] = "24";
+  BOOST_CHECK_EQUAL(cc1.at("MASS").range(0, 1, 100).size(), 3);
+  c1.push_back("BLOCK MASS2\n 10 1.0\n 10 2.0\n 9 3.0");
+  BOOST_CHECK_EQUAL(cc1.range("MASS2", 0, 10, 10).back()[1], "2.0");
+
+  c1.push_back("DECAY 1000021 1.0");
+  BOOST_CHECK_EQUAL(cc1.range(1, 1, 1000).size(), 2);
+  BOOST_CHECK_EQUAL(cc1.range(1, 1, 10000000).back().name(), "1000021");
+  c1.at("1000021").name("1000022");
+  c1.at("1000022").front()[1] = "1000022";
+  BOOST_CHECK_EQUAL(cc1.range(1, 1000022, 1000022).size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testFrozenRange)
+{
+  Coll c1;
+  for (int i = 0; i < 20; ++i)
+  { c1.push_back("DECAY " + to_string(100 + i) + " 1.0"); }
+  const Coll& cc1 = c1;
+
+  Line& def = c1.at("105").front();
+  BOOST_CHECK_EQUAL(cc1.range(1, 105, 105).size(), 1);
+  BOOST_CHECK_EQUAL(cc1.range(1, 105, 105).size(), 1);
+  def[1] = "205";
+  BOOST_CHECK_EQUAL(cc1.range(1, 105, 105).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range(1, 205, 205).size(), 1);
+
+  c1.freeze();
+  BOOST_CHECK_EQUAL(cc1.range(1, 100, 119).size(), 19);
+  BOOST_CHECK_EQUAL(cc1.range(0, 0, 1000).size(), 0);
+  BOOST_CHECK_EQUAL(cc1.range(1, 100, 119).size(), 19);
+  BOOST_CHECK_EQUAL(cc1.range(1, 100, 300).back().name(), "105");
+  c1.at("100").front()[1] = "300";
+  BOOST_CHECK_EQUAL(cc1.range(1, 100, 119).size(), 18);
+
+  Block b1;
+  for (int i = 0; i < 20; ++i) b1.push_back(to_string(i) + " x");
+  const Block& cb1 = b1;
+  b1.freeze();
+  BOOST_CHECK_EQUAL(cb1.range(0, 5, 9).size(), 5);
+  BOOST_CHECK_EQUAL(cb1.range(0, 5, 9).front()[0], "5");
+  b1.at("7")[0] = "70";
+  BOOST_CHECK_EQUAL(cb1.range(0, 5, 9).size(), 4);
+
+  for (int i = 0; i < 20; ++i) b1.at(to_string(i == 7 ? 70 : i))[1] = "y";
+  b1.push_back("8 3");
+  BOOST_CHECK_EQUAL(cb1.range(1, 0, 10).size(), 1);
+  BOOST_CHECK_EQUAL(cb1.range(0, 5, 9).size(), 5);
+  BOOST_CHECK_EQUAL(cb1.range(0, 8, 8).back()[1], "3");
+  b1.back()[1] = "4";
+  BOOST_CHECK_EQUAL(cb1.range(1, 4, 4).size(), 1);
+  BOOST_CHECK_EQUAL(cb1.range(0, 70, 70).size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
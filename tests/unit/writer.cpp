@@ -0,0 +1,297 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2009-2011 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+#include "slhaea_concurrent.h"
+#include "slhaea_json.h"
+
+#ifdef SLHAEA_HAS_POSIX
+#include <dirent.h>
+#endif
+
+using namespace std;
+using namespace SLHAea;
+
+BOOST_AUTO_TEST_SUITE(TestWriter)
+
+BOOST_AUTO_TEST_CASE(testLayout)
+{
+  Block b1;
+  b1[""] << "BLOCK" << "MODSEL" << "# model selection";
+  b1[""] << 1 << 1 << "# mSUGRA";
+  b1[""] << 2 << -12.345678 << "# some double";
+  b1[""] << 11111 << 22222 << 33333 << 44444 << 55555 << 66666;
+  b1[""] << "# comment line";
+
+  string s1;
+  {
+    Writer w(s1);
+    w.begin_block("MODSEL").comment("model selection");
+    w.line(1, 1).comment("mSUGRA");
+    w.line(2, -12.345678).comment("# some double");
+    w.line(11111, 22222, 33333, 44444, 55555) << 66666;
+    w.end_line().comment("comment line");
+  }
+  BOOST_CHECK_EQUAL(s1, b1.str());
+
+  ostringstream os;
+  {
+    Writer w(os);
+    w.begin_block("MODSEL").comment("model selection");
+  }
+  BOOST_CHECK_EQUAL(os.str(), "BLOCK MODSEL    # model selection\n");
+}
+
+BOOST_AUTO_TEST_CASE(testNumbers)
+{
+  Line l1;
+  l1 << 1 << 1.5f << 2.5 << 3.5L << 4u << 5l << 6ul << short(7) << true;
+
+  string s1;
+  Writer(s1).line(1, 1.5f, 2.5, 3.5L, 4u) << 5l << 6ul << short(7) << true;
+  BOOST_CHECK_EQUAL(s1, l1.str() + "\n");
+}
+
+BOOST_AUTO_TEST_CASE(testBlocksAndDecays)
+{
+  Coll c1;
+  c1["MASS"][""] << "BLOCK" << "MASS" << "Q=" << 91.1876;
+  c1["MASS"][""] << 1000021 << 5.6e2 << "# ~g";
+  c1["1000021"][""] << "DECAY" << 1000021 << 1.25;
+  c1["1000021"][""] << 0.5 << 2 << 1000001 << -1;
+  c1["1000021"][""] << 0.25 << 3 << 1000022 << 1 << -1;
+  c1["1000021"][""] << 0.25 << 4 << 1000022 << 1 << -1 << 22;
+
+  string s1;
+  {
+    Writer w(s1);
+    w.begin_block("MASS", 91.1876);
+    w.line(1000021, 5.6e2).comment("~g");
+    w.decay(1000021, 1.25);
+    w.channel(0.5, 1000001, -1);
+    w.channel(0.25, 1000022, 1, -1);
+    w.channel(0.25, 1000022, 1, -1, 22);
+  }
+  BOOST_CHECK_EQUAL(s1, c1.str());
+  BOOST_CHECK_EQUAL(Coll::from_str(s1), c1);
+}
+
+BOOST_AUTO_TEST_CASE(testEndLine)
+{
+  string s1;
+  Writer w(s1);
+  w.end_line();
+  BOOST_CHECK_EQUAL(s1, "");
+
+  w << "  " << "";
+  w.end_line();
+  BOOST_CHECK_EQUAL(s1, "");
+
+  w << " 1 " << "# a" << " b";
+  w.end_line().end_line();
+  BOOST_CHECK_EQUAL(s1, "    1   # a b\n");
+}
+
+BOOST_AUTO_TEST_CASE(testJson)
+{
+  const Coll c1 = Coll::from_str(
+    "BLOCK MASS Q= 9.1E+01  # masses\n"
+    " 25 1.25E+02\n"
+    "# \"quoted\" \\ comment\n"
+    " 6 +173. 1.0D+02 inf x # top\n"
+    "DECAY 6 1.4\n"
+    " 1.0 2 5 24\n");
+
+  BOOST_CHECK_EQUAL(to_json(c1),
+    "[{\"name\": \"MASS\", "
+    "\"def\": [\"BLOCK\", \"MASS\", \"Q=\", \"9.1E+01\"], "
+    "\"def_comment\": \"# masses\", "
+    "\"lines\": [[\"25\", \"1.25E+02\"], [], "
+    "[\"6\", \"+173.\", \"1.0D+02\", \"inf\", \"x\"]], "
+    "\"comments\": [null, \"# \\\"quoted\\\" \\\\ comment\", \"# top\"]},\n"
+    " {\"name\": \"6\", \"def\": [\"DECAY\", \"6\", \"1.4\"], "
+    "\"lines\": [[\"1.0\", \"2\", \"5\", \"24\"]], "
+    "\"comments\": [null]}]\n");
+
+  BOOST_CHECK_EQUAL(to_json(c1, true),
+    "[{\"name\": \"MASS\", \"def\": [\"BLOCK\", \"MASS\", \"Q=\", 9.1E+01], "
+    "\"def_comment\": \"# masses\", "
+    "\"lines\": [[25, 1.25E+02], [], [6, 173.0, 1.0E+02, \"inf\", \"x\"]], "
+    "\"comments\": [null, \"# \\\"quoted\\\" \\\\ comment\", \"# top\"]},\n"
+    " {\"name\": \"6\", \"def\": [\"DECAY\", 6, 1.4], "
+    "\"lines\": [[1.0, 2, 5, 24]], \"comments\": [null]}]\n");
+
+  BOOST_CHECK_EQUAL(to_json(Coll::from_str(" 0x1A .5 -1.E3 007 1e"), true),
+    "[{\"name\": \"\", \"def\": [], "
+    "\"lines\": [[\"0x1A\", 0.5, -1.0E3, 7, \"1e\"]], "
+    "\"comments\": [null]}]\n");
+
+  // Blocks of the same name are separate elements.
+  const Coll c2 = Coll::from_str(
+    "BLOCK Yu Q= 1.0E+03\n 3 3 8.8E-01\n"
+    "BLOCK Yu Q= 2.0E+03\n 3 3 8.5E-01\n");
+  BOOST_CHECK_EQUAL(to_json(c2, true),
+    "[{\"name\": \"Yu\", \"def\": [\"BLOCK\", \"Yu\", \"Q=\", 1.0E+03], "
+    "\"lines\": [[3, 3, 8.8E-01]], \"comments\": [null]},\n"
+    " {\"name\": \"Yu\", \"def\": [\"BLOCK\", \"Yu\", \"Q=\", 2.0E+03], "
+    "\"lines\": [[3, 3, 8.5E-01]], \"comments\": [null]}]\n");
+
+  ostringstream os;
+  {
+    JsonWriter w(os);
+    w.block(Block::from_str("BLOCK A\t1"));
+    Block b1;
+    b1[""] << "1" << "a\x01";
+    w.block(b1);
+    w.close();
+    w.close();
+  }
+  BOOST_CHECK_EQUAL(os.str(),
+    "[{\"name\": \"A\", \"def\": [\"BLOCK\", \"A\", \"1\"], "
+    "\"lines\": [], \"comments\": []},\n"
+    " {\"name\": \"\", \"def\": [], \"lines\": [[\"1\", \"a\\u0001\"]], "
+    "\"comments\": [null]}]\n");
+  BOOST_CHECK_EQUAL(to_json(Coll()), "[]\n");
+}
+
+#ifdef SLHAEA_HAS_CXX11
+BOOST_AUTO_TEST_CASE(testWriteMany)
+{
+  vector<Coll> colls(20);
+  vector<pair<string, const Coll*> > files;
+  for (size_t i = 0; i < colls.size(); ++i)
+  {
+    colls[i]["MASS"][""] << "BLOCK" << "MASS";
+    colls[i]["MASS"][""] << 1000021 << 100.0 * i;
+    files.push_back(make_pair("write_many_" + to_string(i) + ".txt",
+                              &colls[i]));
+  }
+
+  write_many(files.begin(), files.end(), 3, 2);
+
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    ifstream ifs(files[i].first.c_str());
+    BOOST_CHECK_EQUAL(Coll(ifs), colls[i]);
+    remove(files[i].first.c_str());
+  }
+
+  vector<pair<string, Coll> > bad_files(1,
+    make_pair(string("no_such_dir/write_many.txt"), colls[0]));
+  BOOST_CHECK_THROW(write_many(bad_files.begin(), bad_files.end()),
+                    runtime_error);
+
+#ifdef SLHAEA_HAS_POSIX
+  // Several writers of the same file use distinct temporary files,
+  // none of which is left behind, and the file keeps its mode.
+  const string dir = "write_many_dir", path = dir + "/same.txt";
+  BOOST_REQUIRE_EQUAL(mkdir(dir.c_str(), 0755), 0);
+  files.assign(8, make_pair(path, &colls[0]));
+  write_many(files.begin(), files.end(), 4, 4);
+  BOOST_REQUIRE_EQUAL(chmod(path.c_str(), 0640), 0);
+  files.assign(8, make_pair(path, &colls[1]));
+  write_many(files.begin(), files.end(), 4, 4);
+
+  ifstream ifs(path.c_str());
+  BOOST_CHECK_EQUAL(Coll(ifs), colls[1]);
+  struct stat path_stat;
+  BOOST_REQUIRE_EQUAL(stat(path.c_str(), &path_stat), 0);
+  BOOST_CHECK_EQUAL(path_stat.st_mode & 0777, 0640);
+
+  vector<string> entries;
+  DIR* d = opendir(dir.c_str());
+  BOOST_REQUIRE(d != 0);
+  while (dirent* entry = readdir(d))
+  {
+    if (entry->d_name[0] != '.' || string(entry->d_name).size() > 2)
+    { entries.push_back(entry->d_name); }
+  }
+  closedir(d);
+  BOOST_REQUIRE_EQUAL(entries.size(), 1);
+  BOOST_CHECK_EQUAL(entries.front(), "same.txt");
+
+  remove(path.c_str());
+  rmdir(dir.c_str());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentWriter)
+{
+  const int n_threads = 4, n_blocks = 200;
+  vector<string> order;
+  for (int i = 0; i < n_blocks; ++i) order.push_back(to_string(1000 + i));
+
+  for (size_t capacity = 1; capacity <= 1024; capacity *= 32)
+  {
+    ostringstream os;
+    {
+      ConcurrentWriter w(os, order, capacity);
+      vector<thread> producers;
+      for (int t = 0; t < n_threads; ++t)
+      {
+        producers.push_back(thread([&w, t] {
+          for (int i = n_blocks - 1 - t; i >= 0; i -= n_threads)
+          {
+            if (i % 2)
+            {
+              Block b;
+              b[""] << "DECAY" << 1000 + i << 1.0;
+              b[""] << 1.0 << 2 << 1 << -1;
+              w.submit(b);
+            }
+            else
+            {
+              w.submit("DECAY " + to_string(1000 + i) + " 1.0\n"
+                       " 1.0 2 1 -1");
+            }
+          }
+        }));
+      }
+      for (thread& t : producers) t.join();
+      w.submit(string("BLOCK MASS\n 25 125.0\n"));
+      w.close();
+    }
+
+    const Coll c1 = Coll::from_str(os.str());
+    BOOST_REQUIRE_EQUAL(c1.size(), n_blocks + 1);
+    vector<string> names;
+    for (Coll::const_iterator b = c1.begin(); b != c1.end(); ++b)
+    { if (b->name() != "MASS") names.push_back(b->name()); }
+    BOOST_CHECK_EQUAL(c1.count("MASS"), 1);
+
+    if (capacity >= size_t(n_blocks))
+    {
+      BOOST_CHECK(names == order);
+      BOOST_CHECK_EQUAL(c1.back().name(), "MASS");
+    }
+    else
+    {
+      sort(names.begin(), names.end());
+      BOOST_CHECK(names == order);
+    }
+  }
+
+  ostringstream os;
+  ConcurrentWriter w(os);
+  w.submit(Block::from_str("BLOCK A\n 1 1"));
+  w.submit("BLOCK B");
+  w.close();
+  w.close();
+  BOOST_CHECK_EQUAL(os.str(), "BLOCK A\n 1 1\nBLOCK B\n");
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()